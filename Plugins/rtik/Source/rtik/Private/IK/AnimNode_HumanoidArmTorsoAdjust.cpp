@@ -15,6 +15,12 @@
 
 DECLARE_CYCLE_STAT(TEXT("IK Humanoid Arm Torso Adjust"), STAT_HumanoidArmTorsoAdjust_Eval, STATGROUP_Anim);
 
+void FAnimNode_HumanoidArmTorsoAdjust::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	Snapshot.Capture(InAnimInstance);
+	Gate.CaptureCurve(GateSettings, InAnimInstance);
+}
+
 void FAnimNode_HumanoidArmTorsoAdjust::UpdateInternal(const FAnimationUpdateContext & Context)
 {
 	DeltaTime = Context.GetDeltaTime();	
@@ -25,6 +31,19 @@ void FAnimNode_HumanoidArmTorsoAdjust::EvaluateSkeletalControl_AnyThread(FCompon
 {
 	SCOPE_CYCLE_COUNTER(STAT_HumanoidArmTorsoAdjust_Eval);
 
+	if (!Gate.Evaluate(GateSettings, ActualAlpha, Output.AnimInstanceProxy->GetEvaluationCounter(), 
+		!LastRotationOffset.IsIdentity(KINDA_SMALL_NUMBER)))
+	{
+		return;
+	}
+
+	if (Gate.WasReopened())
+	{
+		// Ease back in from the incoming pose
+		LastEffectorOffset = FVector::ZeroVector;
+		LastRotationOffset = FQuat::Identity;
+	}
+
 #if ENABLE_ANIM_DEBUG
 	check(Output.AnimInstanceProxy->GetSkelMeshComponent());
 #endif
@@ -33,7 +52,7 @@ void FAnimNode_HumanoidArmTorsoAdjust::EvaluateSkeletalControl_AnyThread(FCompon
 	// Input pin pointers are checked in IsValid -- don't need to check here
 
 	USkeletalMeshComponent* SkelComp   = Output.AnimInstanceProxy->GetSkelMeshComponent();
-	FMatrix ToCS = SkelComp->GetComponentToWorld().ToMatrixNoScale().Inverse();
+	FMatrix ToCS = Snapshot.ComponentToWorld.ToMatrixNoScale().Inverse();
 
 /*
 	const USkeletalMeshSocket* TorsoPivotSocket = SkelComp->GetSocketByName(TorsoPivotSocketName);
@@ -89,68 +108,101 @@ void FAnimNode_HumanoidArmTorsoAdjust::EvaluateSkeletalControl_AnyThread(FCompon
 		CSTransformsRight.Add(Output.Pose.GetComponentSpaceTransform(Bone.BoneIndex));
 	}
 
-	// Setup constraints
-	TArray<FIKBoneConstraint*> ConstraintsLeft;
-	ConstraintsLeft.Reserve(NumBonesLeft);
-	for (FIKBone& Bone : LeftArm->Chain.BonesRootToEffector)
-	{
-		ConstraintsLeft.Add(Bone.GetConstraint());
-	}
+	bool bIKLeftArm = Mode == EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_BothArms ||
+		Mode == EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_LeftArmOnly;
+	bool bIKRightArm = Mode == EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_BothArms ||
+		Mode == EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_RightArmOnly;
 
-	TArray<FIKBoneConstraint*> ConstraintsRight;
-	ConstraintsRight.Reserve(NumBonesLeft);
-	for (FIKBone& Bone : RightArm->Chain.BonesRootToEffector)
-	{
-		ConstraintsRight.Add(Bone.GetConstraint());
-	}
+	FVector LeftTargetCS  = ToCS.TransformPosition(LeftArmWorldTarget.GetLocation());
+	FVector RightTargetCS = ToCS.TransformPosition(RightArmWorldTarget.GetLocation());
 
-	// First pass: IK each arm, allowing shoulders to drag
 	TArray<FTransform> PostIKTransformsLeft;
-	if (Mode == EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_BothArms ||
-		Mode == EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_LeftArmOnly)
-	{
-		FVector LeftTargetCS = ToCS.TransformPosition(LeftArmWorldTarget.GetLocation());
-		FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
-			CSTransformsLeft,
-			ConstraintsLeft,
-			LeftTargetCS,
-			PostIKTransformsLeft,
-			MaxShoulderDragDistance,
-			ShoulderDragStiffness,
-			Precision,
-			MaxIterations,
-			Cast<ACharacter>(SkelComp->GetOwner())
-		);
-	}
-	else
+	TArray<FTransform> PostIKTransformsRight;
+
+	if (TorsoSolver == EHumanoidArmTorsoSolver::IK_Human_ArmTorso_Solver_Analytic)
 	{
-		for (FTransform& Transform : CSTransformsLeft)
+		// First pass: estimate shoulder displacements directly. Each arm is carried rigidly along with its
+		// shoulder; only the shoulder positions are used below, the rest is for debug drawing.
+		PostIKTransformsLeft  = CSTransformsLeft;
+		PostIKTransformsRight = CSTransformsRight;
+
+		if (bIKLeftArm)
 		{
-			PostIKTransformsLeft.Add(Transform);
+			FVector Displacement = EstimateShoulderDisplacement(CSTransformsLeft, LeftTargetCS);
+			for (FTransform& Transform : PostIKTransformsLeft)
+			{
+				Transform.AddToTranslation(Displacement);
+			}
+		}
+
+		if (bIKRightArm)
+		{
+			FVector Displacement = EstimateShoulderDisplacement(CSTransformsRight, RightTargetCS);
+			for (FTransform& Transform : PostIKTransformsRight)
+			{
+				Transform.AddToTranslation(Displacement);
+			}
 		}
-	}
-	TArray<FTransform> PostIKTransformsRight;
-	if (Mode == EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_BothArms ||
-		Mode == EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_RightArmOnly)
-	{
-		FVector RightTargetCS = ToCS.TransformPosition(RightArmWorldTarget.GetLocation());
-		FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
-			CSTransformsRight,
-			ConstraintsRight,
-			RightTargetCS,
-			PostIKTransformsRight,
-			MaxShoulderDragDistance,
-			ShoulderDragStiffness,
-			Precision,
-			MaxIterations,
-			Cast<ACharacter>(SkelComp->GetOwner())
-		);
 	}
 	else
 	{
-		for (FTransform& Transform : CSTransformsRight)
+		// Setup constraints
+		TArray<FIKBoneConstraint*> ConstraintsLeft;
+		ConstraintsLeft.Reserve(NumBonesLeft);
+		for (FIKBone& Bone : LeftArm->Chain.BonesRootToEffector)
+		{
+			ConstraintsLeft.Add(Bone.GetConstraint());
+		}
+
+		TArray<FIKBoneConstraint*> ConstraintsRight;
+		ConstraintsRight.Reserve(NumBonesLeft);
+		for (FIKBone& Bone : RightArm->Chain.BonesRootToEffector)
+		{
+			ConstraintsRight.Add(Bone.GetConstraint());
+		}
+
+		// First pass: IK each arm, allowing shoulders to drag
+		if (bIKLeftArm)
+		{
+			FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
+				CSTransformsLeft,
+				ConstraintsLeft,
+				LeftTargetCS,
+				PostIKTransformsLeft,
+				MaxShoulderDragDistance,
+				ShoulderDragStiffness,
+				Precision,
+				MaxIterations,
+				Snapshot.Character
+			);
+		}
+		else
+		{
+			for (FTransform& Transform : CSTransformsLeft)
+			{
+				PostIKTransformsLeft.Add(Transform);
+			}
+		}
+		if (bIKRightArm)
+		{
+			FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
+				CSTransformsRight,
+				ConstraintsRight,
+				RightTargetCS,
+				PostIKTransformsRight,
+				MaxShoulderDragDistance,
+				ShoulderDragStiffness,
+				Precision,
+				MaxIterations,
+				Snapshot.Character
+			);
+		}
+		else
 		{
-			PostIKTransformsRight.Add(Transform);
+			for (FTransform& Transform : CSTransformsRight)
+			{
+				PostIKTransformsRight.Add(Transform);
+			}
 		}
 	}
 
@@ -274,20 +326,22 @@ void FAnimNode_HumanoidArmTorsoAdjust::EvaluateSkeletalControl_AnyThread(FCompon
 	);
 	FQuat PitchRotation(RightAxis, PitchRad);
 
-	// Twist needs to be applied first; pitch will modify twist axes and cause a bad rotation
-	FQuat TargetOffset = (PitchRotation * TwistRotation);
+	// Twist needs to be applied first; pitch will modify twist axes and cause a bad rotation. While gated off, the
+	// torso eases back to the incoming pose instead.
+	FQuat TargetOffset = Gate.IsBlendingOut() ? FQuat::Identity : (PitchRotation * TwistRotation);
 	// Interpolate rotation
 	LastRotationOffset = FQuat::Slerp(LastRotationOffset, TargetOffset, FMath::Clamp(TorsoRotationSlerpSpeed * DeltaTime, 0.0f, 1.0f));
 
 	// Apply new transforms	
 	WaistCS.SetRotation((LastRotationOffset * WaistCS.GetRotation()).GetNormalized());
 	OutBoneTransforms.Add(FBoneTransform(WaistBone.BoneIndex, WaistCS));
+	CommitSettings.DiscardUnchangedBones(Output.Pose, OutBoneTransforms);
 
 #if WITH_EDITOR
 	if (bEnableDebugDraw)
 	{
-		UWorld* World = SkelComp->GetWorld();		
-		FMatrix ToWorld = SkelComp->GetComponentToWorld().ToMatrixNoScale();
+		UWorld* World = Snapshot.World;		
+		FMatrix ToWorld = Snapshot.ComponentToWorld.ToMatrixNoScale();
 		FVector WaistLocWorld = ToWorld.TransformPosition(WaistCS.GetLocation());
 		FVector WaistLocWorldPostIK = ToWorld.TransformPosition(WaistCSPostIK.GetLocation());
 		FVector ParentLoc;
@@ -371,6 +425,33 @@ void FAnimNode_HumanoidArmTorsoAdjust::EvaluateSkeletalControl_AnyThread(FCompon
 #endif // WITH_EDITOR
 }
 
+FVector FAnimNode_HumanoidArmTorsoAdjust::EstimateShoulderDisplacement(const TArray<FTransform>& ArmCSTransforms,
+	const FVector& TargetCS) const
+{
+	if (ArmCSTransforms.Num() < 2 || MaxShoulderDragDistance < KINDA_SMALL_NUMBER || ShoulderDragStiffness < KINDA_SMALL_NUMBER)
+	{
+		return FVector::ZeroVector;
+	}
+
+	float Reach = 0.0f;
+	for (int32 i = 1; i < ArmCSTransforms.Num(); ++i)
+	{
+		Reach += FVector::Dist(ArmCSTransforms[i - 1].GetLocation(), ArmCSTransforms[i].GetLocation());
+	}
+
+	// If the target is in reach, the shoulder can stay put
+	FVector ToTarget     = TargetCS - ArmCSTransforms[0].GetLocation();
+	float TargetDistance = ToTarget.Size();
+	if (TargetDistance <= Reach)
+	{
+		return FVector::ZeroVector;
+	}
+
+	// Same scaling and clamping FABRIK applies when dragging the root
+	float DragDistance = FMath::Min((TargetDistance - Reach) / ShoulderDragStiffness, MaxShoulderDragDistance);
+	return ToTarget * (DragDistance / TargetDistance);
+}
+
 bool FAnimNode_HumanoidArmTorsoAdjust::IsValidToEvaluate(const USkeleton * Skeleton, const FBoneContainer & RequiredBones)
 {
 	
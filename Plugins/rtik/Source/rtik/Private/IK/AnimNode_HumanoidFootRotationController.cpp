@@ -13,6 +13,12 @@
 
 DECLARE_CYCLE_STAT(TEXT("IK Humanoid Foot Rotation Controller  Eval"), STAT_HumanoidFootRotationController_Eval, STATGROUP_Anim);
 
+void FAnimNode_HumanoidFootRotationController::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	Snapshot.Capture(InAnimInstance);
+	Gate.CaptureCurve(GateSettings, InAnimInstance);
+}
+
 void FAnimNode_HumanoidFootRotationController::UpdateInternal(const FAnimationUpdateContext & Context)
 {
 	DeltaTime = Context.GetDeltaTime();	
@@ -22,6 +28,18 @@ void FAnimNode_HumanoidFootRotationController::EvaluateSkeletalControl_AnyThread
 {
 	SCOPE_CYCLE_COUNTER(STAT_HumanoidFootRotationController_Eval);
 
+	if (!Gate.Evaluate(GateSettings, ActualAlpha, Output.AnimInstanceProxy->GetEvaluationCounter(), 
+		!LastRotationOffset.IsIdentity(KINDA_SMALL_NUMBER)))
+	{
+		return;
+	}
+
+	if (Gate.WasReopened())
+	{
+		// Ease back in from the incoming pose
+		LastRotationOffset = FQuat::Identity;
+	}
+
 #if ENABLE_ANIM_DEBUG
 	check(Output.AnimInstanceProxy->GetSkelMeshComponent());
 #endif
@@ -30,42 +48,11 @@ void FAnimNode_HumanoidFootRotationController::EvaluateSkeletalControl_AnyThread
 	// Input pin pointers are checked in IsValid -- don't need to check here
 	USkeletalMeshComponent* SkelComp   = Output.AnimInstanceProxy->GetSkelMeshComponent();
 
-	float RequiredRad = 0.0f;
-	bool bTargetRotationWithinLimit = Leg->Chain.FindWithinFootRotationLimit(*SkelComp, TraceData->GetTraceData(), RequiredRad);
-
-	FQuat TargetOffset = FQuat::Identity;		
-
-	if (bTargetRotationWithinLimit)
-	{
-		// Compute required rotation
-		FMatrix ToCS = SkelComp->GetComponentToWorld().ToMatrixNoScale().Inverse();
-		
-		FVector FootFloor     = TraceData->GetTraceData().FootHitResult.ImpactPoint;
-		FVector ToeFloor      = TraceData->GetTraceData().ToeHitResult.ImpactPoint;
-		FVector FloorSlopeVec = ToCS.TransformVector(ToeFloor - FootFloor);
-
-		FVector FloorFlatVec(FloorSlopeVec);
-		FloorFlatVec.Z = 0.0f;
-
-		FVector KneeCS  = FAnimUtil::GetBoneCSLocation(*SkelComp, Output.Pose, Leg->Chain.ThighBone.BoneIndex);
-		FVector FootCS  = FAnimUtil::GetBoneCSLocation(*SkelComp, Output.Pose, Leg->Chain.ShinBone.BoneIndex);
-		FVector ToeCS   = FAnimUtil::GetBoneCSLocation(*SkelComp, Output.Pose, Leg->Chain.FootBone.BoneIndex);
-
-		FVector ShinVec = KneeCS - FootCS;
-		FVector FootVec = ToeCS - FootCS;
-
-		FVector RotationAxis = FVector::CrossProduct(FootVec, ShinVec);
-
-		if (RotationAxis.Normalize())
-		{
-			if (FVector::DotProduct(RotationAxis, FVector::CrossProduct(FloorFlatVec, FloorSlopeVec).GetUnsafeNormal()) < 0.0f)
-			{
-				RotationAxis *= -1.0f;
-			}
-		   
-			TargetOffset = FQuat(RotationAxis, RequiredRad);
-		}
-	}
+	// The trace node already found the floor slope and the rotation needed to match it
+	const FHumanoidLegGroundSolution& Ground = TraceData->GetGroundSolution();
+	float RequiredRad                        = Ground.SlopeAngleRad;
+	bool bTargetRotationWithinLimit          = Ground.bWithinRotationLimit;
+	FQuat TargetOffset                       = Gate.IsBlendingOut() ? FQuat::Identity : Ground.TargetFootRotationCS;
 
 	// Interpolate to target rotation and apply 
 	FTransform FootCSTransform = FAnimUtil::GetBoneCSTransform(*SkelComp, Output.Pose, Leg->Chain.ShinBone.BoneIndex);
@@ -82,18 +69,21 @@ void FAnimNode_HumanoidFootRotationController::EvaluateSkeletalControl_AnyThread
 	FootCSTransform.SetRotation(LastRotationOffset * FootCSTransform.GetRotation());
    
 	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.ShinBone.BoneIndex, FootCSTransform));
+	CommitSettings.DiscardUnchangedBones(Output.Pose, OutBoneTransforms);
    	
 #if WITH_EDITOR
 	if (bEnableDebugDraw)
 	{
-		UWorld* World = SkelComp->GetWorld();
-		ACharacter* Character = Cast<ACharacter>(SkelComp->GetOwner());
-		FMatrix ToWorld = SkelComp->GetComponentToWorld().ToMatrixNoScale();
+		UWorld* World = Snapshot.World;
+		ACharacter* Character = Snapshot.Character;
+		FTransform ToWorld = Snapshot.ComponentToWorld;
+		FVector FootFloor  = ToWorld.TransformPosition(TraceData->GetTraceData().FootSample.Location);
+		FVector ToeFloor   = ToWorld.TransformPosition(TraceData->GetTraceData().ToeSample.Location);
 		if (bTargetRotationWithinLimit)
 		{
 			FDebugDrawUtil::DrawLine(World,
-				TraceData->GetTraceData().FootHitResult.ImpactPoint,
-				TraceData->GetTraceData().ToeHitResult.ImpactPoint,
+				FootFloor,
+				ToeFloor,
 				FColor(0, 255, 0));
 
 			FVector TextOffset(0.0f, 0.0f, 100.0f);
@@ -103,8 +93,8 @@ void FAnimNode_HumanoidFootRotationController::EvaluateSkeletalControl_AnyThread
 		else
 		{
 			FDebugDrawUtil::DrawLine(World,
-				TraceData->GetTraceData().FootHitResult.ImpactPoint,
-				TraceData->GetTraceData().ToeHitResult.ImpactPoint,
+				FootFloor,
+				ToeFloor,
 				FColor(255, 0, 0));
 
 			FVector TextOffset(0.0f, 0.0f, 100.0f);
@@ -3,6 +3,7 @@
 #include "rtik.h"
 #include "AnimNode_HumanoidLegIK.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Animation/AnimInstanceProxy.h"
 #include "TwoBoneIK.h"
 #include "RangeLimitedFABRIK.h"
 #include "Utility/AnimUtil.h"
@@ -12,6 +13,12 @@
 #endif
 
 DECLARE_CYCLE_STAT(TEXT("IK Humanoid Leg IK Eval"), STAT_HumanoidLegIK_Eval, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Plant-Locked Leg Solves"), STAT_HumanoidLegIK_NumPlantLocked, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Baked Foot Height Reads"), STAT_HumanoidLegIK_NumBakedFootHeight, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Crowd Solver Misses"), STAT_HumanoidLegIK_CrowdSolverMisses, STATGROUP_Anim);
+
+// The baked foot height is trusted while its weight curve is within this of 1
+static const float HumanoidLegIKBakedWeightTolerance = 0.01f;
 
 void FAnimNode_HumanoidLegIK::Initialize_AnyThread(const FAnimationInitializeContext & Context)
 {
@@ -25,16 +32,154 @@ void FAnimNode_HumanoidLegIK::CacheBones_AnyThread(const FAnimationCacheBonesCon
 	BaseComponentPose.CacheBones(Context);
 }
 
+void FAnimNode_HumanoidLegIK::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	Snapshot.Capture(InAnimInstance);
+	Gate.CaptureCurve(GateSettings, InAnimInstance);
+
+	if (PlantLock.bEnable && PlantLock.CurveName != NAME_None && InAnimInstance != nullptr)
+	{
+		// GetCurveValue only reads, but isn't const
+		PlantCurveValue = const_cast<UAnimInstance*>(InAnimInstance)->GetCurveValue(PlantLock.CurveName);
+	}
+
+	// Animations without the baked curves fall back to evaluating the base pose, as do blends with them, where the 
+	// height is scaled down by the baked animations' weight. GetCurveValue only reads, but isn't const.
+	float BakedWeight   = 0.0f;
+	bHasBakedFootHeight = FootHeightCurveName != NAME_None && FootHeightWeightCurveName != NAME_None && 
+		InAnimInstance != nullptr &&
+		const_cast<UAnimInstance*>(InAnimInstance)->GetCurveValue(FootHeightCurveName, BakedFootHeight) &&
+		const_cast<UAnimInstance*>(InAnimInstance)->GetCurveValue(FootHeightWeightCurveName, BakedWeight) &&
+		BakedWeight >= 1.0f - HumanoidLegIKBakedWeightTolerance;
+
+	if (bHasBakedFootHeight)
+	{
+		BakedFootHeight /= BakedWeight;
+	}
+
+	// The crowd solver writes last frame's solves from a task; wait for it before evaluating
+	if (bUseCrowdSolver && Snapshot.World != nullptr)
+	{
+		FIKCrowdSolver::Get(Snapshot.World)->WaitForFlush();
+	}
+
+	if (SolverRecording != nullptr && Leg != nullptr)
+	{
+		TArray<UIKBoneConstraintWrapper*> ChainConstraints({
+			Leg->Chain.HipBone.GetConstraintWrapper(),
+			Leg->Chain.ThighBone.GetConstraintWrapper(),
+			Leg->Chain.ShinBone.GetConstraintWrapper()
+		});
+		SolverRecorder.Flush(SolverRecording, ChainConstraints);
+	}
+}
+
 void FAnimNode_HumanoidLegIK::UpdateInternal(const FAnimationUpdateContext & Context)
 {
 	BaseComponentPose.Update(Context);
 	DeltaTime = Context.GetDeltaTime();	
+	LODLevel  = Context.AnimInstanceProxy->GetLODLevel();
+	PlantDeltaTime += DeltaTime;
+}
+
+void FAnimNode_HumanoidLegIK::ApplySolvedDeltas(FCSPose<FCompactPose>& Pose, const FTransform& HipCSTransform, 
+	const FTransform& KneeCSTransform, const FTransform& FootCSTransform, TArray<FBoneTransform>& OutBoneTransforms)
+{
+	float Alpha      = ReducedRateCounter.GetInterpolationAlpha();
+	CurrentHipDelta  = FQuat::Slerp(CurrentHipDelta, TargetHipDelta, Alpha);
+	CurrentKneeDelta = FQuat::Slerp(CurrentKneeDelta, TargetKneeDelta, Alpha);
+
+	TArray<FTransform> DeltaCSTransforms;
+	FHumanoidIK::ApplyLegDeltaRotations(HipCSTransform, KneeCSTransform, FootCSTransform,
+		CurrentHipDelta, CurrentKneeDelta, DeltaCSTransforms);
+
+	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.HipBone.BoneIndex, DeltaCSTransforms[0]));
+	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.ThighBone.BoneIndex, DeltaCSTransforms[1]));
+	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.ShinBone.BoneIndex, DeltaCSTransforms[2]));
+	CommitSettings.DiscardUnchangedBones(Pose, OutBoneTransforms);
+
+	// Back at the animated pose; nothing left to re-apply
+	if (CurrentHipDelta.IsIdentity(KINDA_SMALL_NUMBER) && CurrentKneeDelta.IsIdentity(KINDA_SMALL_NUMBER))
+	{
+		bHasSolvedDeltas = false;
+	}
+}
+
+bool FAnimNode_HumanoidLegIK::UpdatePlantLock(const FVector& FootWS)
+{
+	float TimeStep = PlantDeltaTime;
+	PlantDeltaTime = 0.0f;
+
+	bool bHadLastFootWS = bHasLastFootWS;
+	FVector FootMoveWS  = FootWS - LastFootWS;
+	LastFootWS          = FootWS;
+	bHasLastFootWS      = true;
+
+	bool bPlanted;
+	if (PlantLock.CurveName != NAME_None)
+	{
+		bPlanted = PlantCurveValue > PlantLock.CurveThreshold;
+	}
+	else if (!bHadLastFootWS || TimeStep < KINDA_SMALL_NUMBER)
+	{
+		bPlanted = false;
+	}
+	else
+	{
+		// Only horizontal movement counts; the foot may be moved up and down by pelvis adjustment
+		FVector UpVector = Snapshot.ComponentToWorld.GetUnitAxis(EAxis::Z);
+		FootMoveWS      -= FVector::DotProduct(FootMoveWS, UpVector) * UpVector;
+		bPlanted         = FootMoveWS.SizeSquared() < FMath::Square(PlantLock.PlantSpeedThreshold * TimeStep);
+	}
+
+	if (bPlantLocked)
+	{
+		FVector UpVector = Snapshot.ComponentToWorld.GetUnitAxis(EAxis::Z);
+		FVector DriftWS  = FootWS - LockedFootTargetWS;
+		DriftWS         -= FVector::DotProduct(DriftWS, UpVector) * UpVector;
+
+		if (!bPlanted || DriftWS.SizeSquared() > FMath::Square(PlantLock.MaxLockDistance))
+		{
+			ReleasePlantLock();
+		}
+	}
+
+	return bPlanted;
+}
+
+void FAnimNode_HumanoidLegIK::ReleasePlantLock()
+{
+	bPlantLocked    = false;
+	bHasPlantDeltas = false;
+
+	if (TraceData != nullptr)
+	{
+		TraceData->ReleasePlantLock();
+	}
 }
 
 void FAnimNode_HumanoidLegIK::EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext & Output, TArray<FBoneTransform>& OutBoneTransforms)
 {
 	SCOPE_CYCLE_COUNTER(STAT_HumanoidLegIK_Eval);
 
+	if (!Gate.Evaluate(GateSettings, ActualAlpha, Output.AnimInstanceProxy->GetEvaluationCounter(), 
+		!LastEffectorOffset.IsNearlyZero()))
+	{
+		return;
+	}
+
+	if (Gate.WasReopened())
+	{
+		// Ease back in from the incoming pose, starting with a full solve
+		LastEffectorOffset = FVector::ZeroVector;
+		CurrentHipDelta    = FQuat::Identity;
+		CurrentKneeDelta   = FQuat::Identity;
+		bHasSolvedDeltas   = false;
+		bHasLastFootWS     = false;
+		ReducedRateCounter.Reset();
+		ReleasePlantLock();
+	}
+
 #if ENABLE_ANIM_DEBUG
 	check(Output.AnimInstanceProxy->GetSkelMeshComponent());
 #endif
@@ -44,7 +189,7 @@ void FAnimNode_HumanoidLegIK::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 
 	USkeletalMeshComponent* SkelComp   = Output.AnimInstanceProxy->GetSkelMeshComponent();
 	
-	FMatrix ToCS               = SkelComp->GetComponentToWorld().ToMatrixNoScale().Inverse();
+	FMatrix ToCS               = Snapshot.ComponentToWorld.ToMatrixNoScale().Inverse();
 	FTransform HipCSTransform  = FAnimUtil::GetBoneCSTransform(*SkelComp, Output.Pose, Leg->Chain.HipBone.BoneIndex);
 	FTransform KneeCSTransform = FAnimUtil::GetBoneCSTransform(*SkelComp, Output.Pose, Leg->Chain.ThighBone.BoneIndex);
 	FTransform FootCSTransform = FAnimUtil::GetBoneCSTransform(*SkelComp, Output.Pose, Leg->Chain.ShinBone.BoneIndex);
@@ -52,33 +197,96 @@ void FAnimNode_HumanoidLegIK::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 	FVector KneeCS             = KneeCSTransform.GetLocation();
 	FVector FootCS             = FootCSTransform.GetLocation();
 
+	// On reduced-rate frames, skip traces and solving; just move toward the last solved leg rotations. While blending
+	// out after the gate closed, solve every frame, so the foot keeps moving back at EffectorVelocity.
+	bool bFullSolve = ReducedRateCounter.Tick(ReducedRate, LODLevel) || Gate.IsBlendingOut();
+	if (!bFullSolve)
+	{
+		if (bHasSolvedDeltas)
+		{
+			ApplySolvedDeltas(Output.Pose, HipCSTransform, KneeCSTransform, FootCSTransform, OutBoneTransforms);
+		}
+		return;
+	}
+
 	FVector FootTargetCS;
 	FVector FloorCS;
+
+	bool bFootPlanted = false;
+	if (Mode == EHumanoidLegIKMode::IK_Human_Leg_Locomotion && PlantLock.bEnable && !Gate.IsBlendingOut())
+	{
+		bFootPlanted = UpdatePlantLock(Snapshot.ComponentToWorld.TransformPosition(FootCS));
+	}
+	else if (bPlantLocked)
+	{
+		ReleasePlantLock();
+	}
 			
-	if (Mode == EHumanoidLegIKMode::IK_Human_Leg_Locomotion)
+	if (Gate.IsBlendingOut())
+	{
+		// Gated off: ease the foot back to the incoming pose
+		FootTargetCS = FootCS;
+		FloorCS      = FootCS;
+	}
+	else if (bPlantLocked)
+	{
+		// The foot stays where it planted; the ground and base pose aren't needed
+		INC_DWORD_STAT(STAT_HumanoidLegIK_NumPlantLocked);
+		TraceData->RenewPlantLock(Snapshot.ComponentToWorld);
+
+		FootTargetCS = ToCS.TransformPosition(LockedFootTargetWS);
+		FloorCS      = FootTargetCS;
+	}
+	else if (Mode == EHumanoidLegIKMode::IK_Human_Leg_Locomotion)
 	{		
 		// Check that we have some valid trace data
-		if (TraceData->GetTraceData().FootHitResult.GetActor() == nullptr &&
-			TraceData->GetTraceData().ToeHitResult.GetActor() == nullptr)
+		const FHumanoidLegGroundSolution& Ground = TraceData->GetGroundSolution();
+		if (!Ground.bValid)
 		{
 #if ENABLE_IK_DEBUG_VERBOSE
 			UE_LOG(LogRTIK, Warning, TEXT("Leg IK trace did not hit a valid actor"));
 #endif
+			// Ease the leg back to the animated pose, on this frame and the reduced-rate frames after it, instead of
+			// alternating between the animated pose and the last solve
+			TargetHipDelta  = FQuat::Identity;
+			TargetKneeDelta = FQuat::Identity;
+			if (bHasSolvedDeltas)
+			{
+				ApplySolvedDeltas(Output.Pose, HipCSTransform, KneeCSTransform, FootCSTransform, OutBoneTransforms);
+			}
 			return;
 		}
 
-		// Use trace data to figure out where the foot should go.
-		FComponentSpacePoseContext BasePose(Output);
-		BaseComponentPose.EvaluateComponentSpace(BasePose);
+		// How high the foot should be above the root, from the baked curve or the base pose. If below this, IK turns on.
+		float FootHeightAboveRoot;
+		if (bHasBakedFootHeight)
+		{
+			INC_DWORD_STAT(STAT_HumanoidLegIK_NumBakedFootHeight);
+			FootHeightAboveRoot = BakedFootHeight;
+		}
+		else if (BasePoseCache != nullptr)
+		{
+			FIKBasePoseCache::FBoneList Bones;
+			Bones.Add(FCompactPoseBoneIndex(0));
+			Bones.Add(Leg->Chain.ShinBone.BoneIndex);
+			BasePoseCache->Cache.Evaluate(BaseComponentPose, Output, Bones);
+
+			FVector BaseRootCS  = BasePoseCache->Cache.GetBoneCSTransform(FCompactPoseBoneIndex(0)).GetLocation();
+			FVector BaseFootCS  = BasePoseCache->Cache.GetBoneCSTransform(Leg->Chain.ShinBone.BoneIndex).GetLocation();
+			FootHeightAboveRoot = BaseFootCS.Z - BaseRootCS.Z;
+		}
+		else
+		{
+			FComponentSpacePoseContext BasePose(Output);
+			BaseComponentPose.EvaluateComponentSpace(BasePose);
 
-		// If within foot rotation limit, use the low point. Otherwise, use the higher point and the foot shouldn't rotate.
-		bool bWithinRotationLimit = Leg->Chain.GetIKFloorPointCS(*SkelComp, TraceData->GetTraceData(), FloorCS);
+			FVector BaseRootCS  = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, FCompactPoseBoneIndex(0));
+			FVector BaseFootCS  = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.ShinBone.BoneIndex);
+			FootHeightAboveRoot = BaseFootCS.Z - BaseRootCS.Z;
+		}
 
-		FVector BaseRootCS = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, FCompactPoseBoneIndex(0));
-		FVector BaseFootCS = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.ShinBone.BoneIndex);
-		
-		// How high the foot should be above the root. If below this, IK turns on.
-		float FootHeightAboveRoot = BaseFootCS.Z - BaseRootCS.Z;
+		// If within foot rotation limit, use the low point. Otherwise, use the higher point and the foot shouldn't rotate.
+		FloorCS = Ground.FloorPointCS;
 
 		// Old method included FootRadius -- could cause IK to cut in suddenly during level movement. Leaving in for historical interest
 		// float MinimumHeight = FloorCS.Z + HeightAboveRoot + Leg->Chain.FootRadius;		
@@ -97,6 +305,13 @@ void FAnimNode_HumanoidLegIK::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 			FootTargetCS = FootCS;
 		}
 
+		// Hold the foot here until it lifts off
+		if (bFootPlanted)
+		{
+			bPlantLocked       = true;
+			LockedFootTargetWS = Snapshot.ComponentToWorld.TransformPosition(FootTargetCS);
+			TraceData->RenewPlantLock(Snapshot.ComponentToWorld);
+		}
 	}
 	else
 	{
@@ -140,17 +355,65 @@ void FAnimNode_HumanoidLegIK::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 			Leg->Chain.ShinBone.GetConstraint()
 		});
 
-		bool bBoneLocationUpdated = FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
-			SourceCSTransforms,
-			Constraints,
-			FootTargetCS,
-			DestCSTransforms,
-			0.0f,
-			1.0f,
-			Precision,
-			MaxIterations,
-			Cast<ACharacter>(SkelComp->GetOwner())
-		);
+		SolverRecorder.Capture(SolverRecording, SourceCSTransforms, FootTargetCS);
+
+		if (bUseCrowdSolver && Snapshot.World != nullptr)
+		{
+			if (!CrowdSolveSlot.IsValid())
+			{
+				CrowdSolveSlot = MakeShared<FIKCrowdSolveSlot, ESPMode::ThreadSafe>();
+			}
+
+			// Pose the leg with last frame's solve. Solve synchronously if there isn't one (e.g., on the first frame).
+			TArray<FTransform> CrowdSourceCSTransforms;
+			TArray<FTransform> CrowdSolvedCSTransforms;
+			if (CrowdSolveSlot->GetRecentResult(CrowdSourceCSTransforms, CrowdSolvedCSTransforms))
+			{
+				FQuat HipDelta;
+				FQuat KneeDelta;
+				FHumanoidIK::ComputeLegDeltaRotations(CrowdSourceCSTransforms[0], CrowdSourceCSTransforms[1],
+					CrowdSolvedCSTransforms[0], CrowdSolvedCSTransforms[1], HipDelta, KneeDelta);
+				FHumanoidIK::ApplyLegDeltaRotations(HipCSTransform, KneeCSTransform, FootCSTransform,
+					HipDelta, KneeDelta, DestCSTransforms);
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_HumanoidLegIK_CrowdSolverMisses);
+				FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(SourceCSTransforms, Constraints, FootTargetCS, DestCSTransforms,
+					0.0f, 1.0f, Precision, MaxIterations, Snapshot.Character);
+			}
+
+			FIKCrowdSolver::Get(Snapshot.World)->Enqueue(CrowdSolveSlot.ToSharedRef(), SourceCSTransforms, Constraints,
+				FootTargetCS, Precision, MaxIterations);
+		}
+		else
+		{
+			// The target of a locked foot barely moves, so start from the last solve
+			if (bPlantLocked && bHasPlantDeltas)
+			{
+				FHumanoidIK::ApplyLegDeltaRotations(HipCSTransform, KneeCSTransform, FootCSTransform,
+					PlantHipDelta, PlantKneeDelta, SourceCSTransforms);
+			}
+
+			bool bBoneLocationUpdated = FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
+				SourceCSTransforms,
+				Constraints,
+				FootTargetCS,
+				DestCSTransforms,
+				0.0f,
+				1.0f,
+				Precision,
+				MaxIterations,
+				Snapshot.Character
+			);
+
+			if (bPlantLocked)
+			{
+				FHumanoidIK::ComputeLegDeltaRotations(HipCSTransform, KneeCSTransform,
+					DestCSTransforms[0], DestCSTransforms[1], PlantHipDelta, PlantKneeDelta);
+				bHasPlantDeltas = true;
+			}
+		}
 	}
 	else if (Solver == EHumanoidLegIKSolver::IK_Human_Leg_Solver_TwoBone)
 	{
@@ -170,22 +433,44 @@ void FAnimNode_HumanoidLegIK::EvaluateSkeletalControl_AnyThread(FComponentSpaceP
 			1.0f
 		);
 	}
+	else if (Solver == EHumanoidLegIKSolver::IK_Human_Leg_Solver_TwoBoneKneeAware)
+	{
+		FHumanoidIK::SolveLegTwoBoneKneeAware(HipCSTransform, KneeCSTransform, FootCSTransform, 
+			FootTargetCS, DestCSTransforms);
+	}
+
+	// Store the solved rotations, so they can be re-applied on frames that skip solving. If a solve bails out 
+	// early (e.g., no valid ground), the leg eases from them back to the animated pose.
+	if (ReducedRate.bEnable)
+	{
+		FHumanoidIK::ComputeLegDeltaRotations(HipCSTransform, KneeCSTransform,
+			DestCSTransforms[0], DestCSTransforms[1], TargetHipDelta, TargetKneeDelta);
+
+		float Alpha      = ReducedRateCounter.GetInterpolationAlpha();
+		CurrentHipDelta  = FQuat::Slerp(CurrentHipDelta, TargetHipDelta, Alpha);
+		CurrentKneeDelta = FQuat::Slerp(CurrentKneeDelta, TargetKneeDelta, Alpha);
+		bHasSolvedDeltas = true;
+
+		FHumanoidIK::ApplyLegDeltaRotations(HipCSTransform, KneeCSTransform, FootCSTransform,
+			CurrentHipDelta, CurrentKneeDelta, DestCSTransforms);
+	}
 
 	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.HipBone.BoneIndex, DestCSTransforms[0]));
 	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.ThighBone.BoneIndex, DestCSTransforms[1]));
 	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.ShinBone.BoneIndex, DestCSTransforms[2]));
+	CommitSettings.DiscardUnchangedBones(Output.Pose, OutBoneTransforms);
 
 #if WITH_EDITOR
 	if (bEnableDebugDraw)
 	{
-		UWorld* World = SkelComp->GetWorld();		
-		FMatrix ToWorld = SkelComp->GetComponentToWorld().ToMatrixNoScale();
+		UWorld* World = Snapshot.World;		
+		FMatrix ToWorld = Snapshot.ComponentToWorld.ToMatrixNoScale();
 		FVector EffectorWorld = ToWorld.TransformPosition(FootTargetCS);
 
 		FDebugDrawUtil::DrawSphere(World, EffectorWorld, FColor(255, 0, 255));
 		FDebugDrawUtil::DrawSphere(World, ToWorld.TransformPosition(FloorCS), FColor(255, 0, 0));
-		FDebugDrawUtil::DrawSphere(World, TraceData->GetTraceData().FootHitResult.ImpactPoint, FColor(255, 255, 0), 10.0f);
-		FDebugDrawUtil::DrawSphere(World, TraceData->GetTraceData().ToeHitResult.ImpactPoint, FColor(255, 255, 0), 10.0f);
+		FDebugDrawUtil::DrawSphere(World, ToWorld.TransformPosition(TraceData->GetTraceData().FootSample.Location), FColor(255, 255, 0), 10.0f);
+		FDebugDrawUtil::DrawSphere(World, ToWorld.TransformPosition(TraceData->GetTraceData().ToeSample.Location), FColor(255, 255, 0), 10.0f);
 
 		// Leg before IK, in yellow:
 		FDebugDrawUtil::DrawLine(World,
@@ -25,6 +25,12 @@ void FAnimNode_HumanoidLegIKKneeCorrection::CacheBones_AnyThread(const FAnimatio
 	BaseComponentPose.CacheBones(Context);
 }
 
+void FAnimNode_HumanoidLegIKKneeCorrection::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	Snapshot.Capture(InAnimInstance);
+	Gate.CaptureCurve(GateSettings, InAnimInstance);
+}
+
 void FAnimNode_HumanoidLegIKKneeCorrection::UpdateInternal(const FAnimationUpdateContext & Context)
 {
 	BaseComponentPose.Update(Context);
@@ -35,6 +41,11 @@ void FAnimNode_HumanoidLegIKKneeCorrection::EvaluateSkeletalControl_AnyThread(FC
 {
 	SCOPE_CYCLE_COUNTER(STAT_HumanoidLegIKKneeCorrection_Eval);
 
+	if (!Gate.Evaluate(GateSettings, ActualAlpha, Output.AnimInstanceProxy->GetEvaluationCounter()))
+	{
+		return;
+	}
+
 #if ENABLE_ANIM_DEBUG
 	check(Output.AnimInstanceProxy->GetSkelMeshComponent());
 #endif
@@ -42,14 +53,35 @@ void FAnimNode_HumanoidLegIKKneeCorrection::EvaluateSkeletalControl_AnyThread(FC
 
 	USkeletalMeshComponent* SkelComp = Output.AnimInstanceProxy->GetSkelMeshComponent();
 
-	FComponentSpacePoseContext BasePose(Output);
-	BaseComponentPose.EvaluateComponentSpace(BasePose);
-
 	// Pre-IK positions
-	FVector HipCSPre      = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.HipBone.BoneIndex);
-	FVector KneeCSPre     = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.ThighBone.BoneIndex);
-	FVector FootCSPre     = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.ShinBone.BoneIndex);
-	FVector ToeCSPre      = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.FootBone.BoneIndex);
+	FVector HipCSPre;
+	FVector KneeCSPre;
+	FVector FootCSPre;
+	FVector ToeCSPre;
+	if (BasePoseCache != nullptr)
+	{
+		FIKBasePoseCache::FBoneList Bones;
+		Bones.Add(Leg->Chain.HipBone.BoneIndex);
+		Bones.Add(Leg->Chain.ThighBone.BoneIndex);
+		Bones.Add(Leg->Chain.ShinBone.BoneIndex);
+		Bones.Add(Leg->Chain.FootBone.BoneIndex);
+		BasePoseCache->Cache.Evaluate(BaseComponentPose, Output, Bones);
+
+		HipCSPre  = BasePoseCache->Cache.GetBoneCSTransform(Leg->Chain.HipBone.BoneIndex).GetLocation();
+		KneeCSPre = BasePoseCache->Cache.GetBoneCSTransform(Leg->Chain.ThighBone.BoneIndex).GetLocation();
+		FootCSPre = BasePoseCache->Cache.GetBoneCSTransform(Leg->Chain.ShinBone.BoneIndex).GetLocation();
+		ToeCSPre  = BasePoseCache->Cache.GetBoneCSTransform(Leg->Chain.FootBone.BoneIndex).GetLocation();
+	}
+	else
+	{
+		FComponentSpacePoseContext BasePose(Output);
+		BaseComponentPose.EvaluateComponentSpace(BasePose);
+
+		HipCSPre  = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.HipBone.BoneIndex);
+		KneeCSPre = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.ThighBone.BoneIndex);
+		FootCSPre = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.ShinBone.BoneIndex);
+		ToeCSPre  = FAnimUtil::GetBoneCSLocation(*SkelComp, BasePose.Pose, Leg->Chain.FootBone.BoneIndex);
+	}
 
 	// Post-IK positions
 	FVector HipCSPost     = FAnimUtil::GetBoneCSLocation(*SkelComp, Output.Pose, Leg->Chain.HipBone.BoneIndex);
@@ -150,7 +182,7 @@ void FAnimNode_HumanoidLegIKKneeCorrection::EvaluateSkeletalControl_AnyThread(FC
 		{
 			// Knee and foot point in opposite directions
 			RotationAxis  = HipFootAxisPost;
-			FootKneeRad = 180.0f;
+			FootKneeRad = PI;
 		}
 		else
 		{
@@ -186,17 +218,18 @@ void FAnimNode_HumanoidLegIKKneeCorrection::EvaluateSkeletalControl_AnyThread(FC
 	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.HipBone.BoneIndex, NewHipTransform));
 	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.ThighBone.BoneIndex, NewThighTransform));
 	OutBoneTransforms.Add(FBoneTransform(Leg->Chain.ShinBone.BoneIndex, NewShinTransform));
+	CommitSettings.DiscardUnchangedBones(Output.Pose, OutBoneTransforms);
 
 #if WITH_EDITOR
 	if (bEnableDebugDraw)
 	{
-		UWorld* World = SkelComp->GetWorld();
-		FMatrix ToWorld = SkelComp->GetComponentToWorld().ToMatrixNoScale();
+		UWorld* World = Snapshot.World;
+		FMatrix ToWorld = Snapshot.ComponentToWorld.ToMatrixNoScale();
 
 		// Draw the pre-IK leg, in red
-		FDebugDrawUtil::DrawBoneChain(World, *SkelComp, BasePose.Pose, 
-			Leg->Chain.FootBone.BoneIndex, Leg->Chain.HipBone.BoneIndex,
-			FColor(255, 0, 0));
+		FDebugDrawUtil::DrawLine(World, ToWorld.TransformPosition(HipCSPre), ToWorld.TransformPosition(KneeCSPre), FColor(255, 0, 0));
+		FDebugDrawUtil::DrawLine(World, ToWorld.TransformPosition(KneeCSPre), ToWorld.TransformPosition(FootCSPre), FColor(255, 0, 0));
+		FDebugDrawUtil::DrawLine(World, ToWorld.TransformPosition(FootCSPre), ToWorld.TransformPosition(ToeCSPre), FColor(255, 0, 0));
 
 		FVector PrePlaneBase = ToWorld.TransformPosition(CenterPre);
 		FVector PrePlaneNormal = ToWorld.TransformVector(HipFootAxisPre);
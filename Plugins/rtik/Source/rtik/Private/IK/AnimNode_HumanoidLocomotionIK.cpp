@@ -0,0 +1,409 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "AnimNode_HumanoidLocomotionIK.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "TwoBoneIK.h"
+#include "RangeLimitedFABRIK.h"
+
+#if WITH_EDITOR
+#include "Utility/DebugDrawUtil.h"
+#endif
+
+DECLARE_CYCLE_STAT(TEXT("IK Humanoid Locomotion IK Eval"), STAT_HumanoidLocomotionIK_Eval, STATGROUP_Anim);
+
+// Same correction as FAnimNode_HumanoidLegIKKneeCorrection: rotates the knee around the hip-foot axis so it keeps the
+// angle to the foot it had in the base pose. The foot doesn't move. Updates the hip and knee transforms in place.
+static void CorrectKnee(const FVector& HipCSPre,
+	const FVector& KneeCSPre,
+	const FVector& FootCSPre,
+	const FVector& ToeCSPre,
+	const FVector& ToeCSPost,
+	FTransform& HipCSTransform,
+	FTransform& KneeCSTransform,
+	const FTransform& FootCSTransform)
+{
+	FVector HipCSPost  = HipCSTransform.GetLocation();
+	FVector KneeCSPost = KneeCSTransform.GetLocation();
+	FVector FootCSPost = FootCSTransform.GetLocation();
+
+	FVector OldThighVec = (KneeCSPost - HipCSPost).GetUnsafeNormal();
+	FVector OldShinVec  = (FootCSPost - KneeCSPost).GetUnsafeNormal();
+
+	// If the leg is fully extended or fully folded, correction is never needed
+	if (FMath::IsNearlyEqual(FMath::Abs(FVector::DotProduct(OldThighVec, OldShinVec)), 1.0f))
+	{
+		return;
+	}
+
+	FVector HipFootAxisPre = FootCSPre - HipCSPre;
+	if (!HipFootAxisPre.Normalize())
+	{
+		HipFootAxisPre = FVector(0.0f, 0.0f, 1.0f);
+	}
+	FVector CenterPre = HipCSPre + (KneeCSPre - HipCSPre).ProjectOnToNormal(HipFootAxisPre);
+
+	FVector HipFootAxisPost = FootCSPost - HipCSPost;
+	if (!HipFootAxisPost.Normalize())
+	{
+		HipFootAxisPost = FVector(0.0f, 0.0f, 1.0f);
+	}
+	FVector CenterPost        = HipCSPost + (KneeCSPost - HipCSPost).ProjectOnToNormal(HipFootAxisPost);
+	FVector KneeDirectionPost = (KneeCSPost - CenterPost).GetUnsafeNormal();
+	FVector KneePre           = (KneeCSPre - CenterPre).GetUnsafeNormal();
+
+	FVector FootToePre = FVector::VectorPlaneProject((ToeCSPre - FootCSPre), HipFootAxisPre);
+	if (!FootToePre.Normalize())
+	{
+		FootToePre = KneePre;
+	}
+
+	// Rotate the foot according to how the hip-foot axis changed, so its direction isn't reversed by the projection
+	float HipAxisRad            = FMath::Acos(FVector::DotProduct(HipFootAxisPre, HipFootAxisPost));
+	FVector FootToeRotationAxis = FVector::CrossProduct(HipFootAxisPre, HipFootAxisPost);
+	FVector FootCSPostRotated   = FootCSPost;
+	FVector ToeCSPostRotated    = ToeCSPost;
+	if (FootToeRotationAxis.Normalize())
+	{
+		FQuat FootToeRotation(FootToeRotationAxis, HipAxisRad);
+		FootCSPostRotated = HipCSPost + FootToeRotation.RotateVector(FootCSPost - HipCSPost);
+		ToeCSPostRotated  = HipCSPost + FootToeRotation.RotateVector(ToeCSPost - HipCSPost);
+	}
+
+	FVector FootToePost = FVector::VectorPlaneProject((ToeCSPostRotated - FootCSPostRotated), HipFootAxisPost);
+	if (!FootToePost.Normalize())
+	{
+		FootToePost = KneeDirectionPost;
+	}
+
+	float FootKneeRad    = FMath::Acos(FVector::DotProduct(FootToePre, KneePre));
+	FVector RotationAxis = FVector::CrossProduct(FootToePre, KneePre);
+	if (!RotationAxis.Normalize())
+	{
+		// Knee and foot point in the same or opposite directions, as in the knee correction node
+		RotationAxis = HipFootAxisPost;
+		FootKneeRad  = FVector::DotProduct(FootToePre, KneePre) < 0.0f ? PI : 0.0f;
+	}
+
+	FVector NewKneeDirection = FQuat(RotationAxis, FootKneeRad).RotateVector(FootToePost);
+	FVector NewKneeCS        = CenterPost + (NewKneeDirection * (KneeCSPost - CenterPost).Size());
+
+	FVector NewThighVec = (NewKneeCS - HipCSPost).GetUnsafeNormal();
+	FVector NewShinVec  = (FootCSPost - NewKneeCS).GetUnsafeNormal();
+
+	HipCSTransform.SetRotation(FQuat::FindBetweenNormals(OldThighVec, NewThighVec) * HipCSTransform.GetRotation());
+	KneeCSTransform.SetRotation(FQuat::FindBetweenNormals(OldShinVec, NewShinVec) * KneeCSTransform.GetRotation());
+	KneeCSTransform.SetLocation(NewKneeCS);
+}
+
+void FAnimNode_HumanoidLocomotionIK::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	Snapshot.Capture(InAnimInstance);
+	Gate.CaptureCurve(GateSettings, InAnimInstance);
+
+	// Don't query for a node that's gated off
+	if (Snapshot.World == nullptr || Snapshot.Character == nullptr || !Gate.IsCurveOpen(GateSettings))
+	{
+		return;
+	}
+
+	QueryGround(LeftLeg, LeftLegTraceData, LeftLegState);
+	QueryGround(RightLeg, RightLegTraceData, RightLegState);
+}
+
+void FAnimNode_HumanoidLocomotionIK::UpdateInternal(const FAnimationUpdateContext& Context)
+{
+	DeltaTime = Context.GetDeltaTime();
+	LODLevel  = Context.AnimInstanceProxy->GetLODLevel();
+}
+
+void FAnimNode_HumanoidLocomotionIK::QueryGround(UHumanoidLegChain_Wrapper* Leg,
+	UHumanoidIKTraceData_Wrapper* TraceDataWrapper,
+	FHumanoidLocomotionLegState& State)
+{
+	if (Leg == nullptr || TraceDataWrapper != nullptr || !State.bRequestQuery)
+	{
+		return;
+	}
+
+	// Query from where the feet were last frame, relative to where the component is now
+	State.bRequestQuery = false;
+
+	const FTransform& ComponentToWorld = Snapshot.ComponentToWorld;
+	FHumanoidLegGroundHits Hits;
+	FHumanoidIK::ProbeLegEndpoints(Snapshot.World, Snapshot.Character, Leg->Chain, State.QueryEndpointsCS.TransformBy(ComponentToWorld),
+		QueryQuality.GetQuality(LODLevel), Hits, false);
+	Hits.ToTraceData(ComponentToWorld, State.TraceData);
+}
+
+void FAnimNode_HumanoidLocomotionIK::FindGround(FCSPose<FCompactPose>& Pose,
+	UHumanoidLegChain_Wrapper& Leg,
+	UHumanoidIKTraceData_Wrapper* TraceDataWrapper,
+	FHumanoidLocomotionLegState& State)
+{
+	if (TraceDataWrapper != nullptr)
+	{
+		State.TraceData = TraceDataWrapper->GetTraceData();
+		State.Ground    = TraceDataWrapper->GetGroundSolution();
+		return;
+	}
+
+	// Traces can't run here, since evaluation may be on a worker thread. Ask PreUpdate to query from where the feet
+	// are now, and use what it found last time; the trace data stays invalid until the first query.
+	FHumanoidIK::ComputeLegTraceEndpointsCS(Pose, Leg.Chain, PelvisBone->Bone, MaxPelvisAdjustSize, State.QueryEndpointsCS);
+	State.bRequestQuery = true;
+
+	Leg.Chain.SolveGround(State.TraceData, State.Ground);
+}
+
+void FAnimNode_HumanoidLocomotionIK::SolveLeg(ACharacter* Character,
+	FCSPose<FCompactPose>& Pose,
+	UHumanoidLegChain_Wrapper& Leg,
+	const FVector& PelvisOffsetCS,
+	FHumanoidLocomotionLegState& State,
+	TArray<FBoneTransform>& OutBoneTransforms)
+{
+	FHumanoidLegChain& Chain = Leg.Chain;
+
+	// The input pose is the base pose. Bones below the pelvis move with it.
+	FTransform HipCSTransform  = Pose.GetComponentSpaceTransform(Chain.HipBone.BoneIndex);
+	FTransform KneeCSTransform = Pose.GetComponentSpaceTransform(Chain.ThighBone.BoneIndex);
+	FTransform FootCSTransform = Pose.GetComponentSpaceTransform(Chain.ShinBone.BoneIndex);
+	FTransform ToeCSTransform  = Pose.GetComponentSpaceTransform(Chain.FootBone.BoneIndex);
+	FVector BaseRootCS         = Pose.GetComponentSpaceTransform(FCompactPoseBoneIndex(0)).GetLocation();
+
+	FVector HipCSPre  = HipCSTransform.GetLocation();
+	FVector KneeCSPre = KneeCSTransform.GetLocation();
+	FVector FootCSPre = FootCSTransform.GetLocation();
+	FVector ToeCSPre  = ToeCSTransform.GetLocation();
+	FTransform ToeRelativeToFoot = ToeCSTransform.GetRelativeTransform(FootCSTransform);
+
+	HipCSTransform.AddToTranslation(PelvisOffsetCS);
+	KneeCSTransform.AddToTranslation(PelvisOffsetCS);
+	FootCSTransform.AddToTranslation(PelvisOffsetCS);
+
+	// Leg IK, as in FAnimNode_HumanoidLegIK. Skipped if there's no ground, as the leg IK node does. While gated off,
+	// the foot eases back to the incoming pose.
+	if (State.Ground.bValid || Gate.IsBlendingOut())
+	{
+		FVector FootCS            = FootCSTransform.GetLocation();
+		float MinimumFootHeight   = State.Ground.FloorPointCS.Z + (FootCSPre.Z - BaseRootCS.Z);
+		FVector FootTargetCS      = (FootCS.Z < MinimumFootHeight && !Gate.IsBlendingOut()) ?
+			FVector(FootCS.X, FootCS.Y, MinimumFootHeight) : FootCS;
+
+		if (bEffectorMovesInstantly)
+		{
+			State.LastEffectorOffset = FVector(0.0f, 0.0f, 0.0f);
+		}
+		else
+		{
+			FVector OffsetFootPos    = FootCS + State.LastEffectorOffset;
+			FVector RequiredDelta    = (FootTargetCS - OffsetFootPos).GetClampedToMaxSize(EffectorVelocity * DeltaTime);
+			FootTargetCS             = OffsetFootPos + RequiredDelta;
+			State.LastEffectorOffset = State.LastEffectorOffset + RequiredDelta;
+		}
+
+		TArray<FTransform> DestCSTransforms;
+		if (Solver == EHumanoidLegIKSolver::IK_Human_Leg_Solver_FABRIK)
+		{
+			TArray<FTransform> SourceCSTransforms({
+				HipCSTransform,
+				KneeCSTransform,
+				FootCSTransform
+			});
+
+			TArray<FIKBoneConstraint*> Constraints({
+				Chain.HipBone.GetConstraint(),
+				Chain.ThighBone.GetConstraint(),
+				Chain.ShinBone.GetConstraint()
+			});
+
+			FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(SourceCSTransforms, Constraints, FootTargetCS, DestCSTransforms,
+				0.0f, 1.0f, Precision, MaxIterations, Character);
+		}
+		else if (Solver == EHumanoidLegIKSolver::IK_Human_Leg_Solver_TwoBoneKneeAware)
+		{
+			FHumanoidIK::SolveLegTwoBoneKneeAware(HipCSTransform, KneeCSTransform, FootCSTransform, FootTargetCS, 
+				DestCSTransforms);
+		}
+		else
+		{
+			DestCSTransforms.Add(HipCSTransform);
+			DestCSTransforms.Add(KneeCSTransform);
+			DestCSTransforms.Add(FootCSTransform);
+
+			AnimationCore::SolveTwoBoneIK(DestCSTransforms[0], DestCSTransforms[1], DestCSTransforms[2],
+				FVector(1.0f, 0.0f, 0.0f), FootTargetCS, false, 1.0f, 1.0f);
+		}
+
+		HipCSTransform  = DestCSTransforms[0];
+		KneeCSTransform = DestCSTransforms[1];
+		FootCSTransform = DestCSTransforms[2];
+
+		// The knee-aware solver has already put the knee where correction would
+		if (bEnableKneeCorrection && Solver != EHumanoidLegIKSolver::IK_Human_Leg_Solver_TwoBoneKneeAware)
+		{
+			FVector ToeCSPost = (ToeRelativeToFoot * FootCSTransform).GetLocation();
+			CorrectKnee(HipCSPre, KneeCSPre, FootCSPre, ToeCSPre, ToeCSPost, HipCSTransform, KneeCSTransform, FootCSTransform);
+		}
+	}
+
+	// Foot rotation, as in FAnimNode_HumanoidFootRotationController
+	if (bEnableFootRotation)
+	{
+		const FQuat& TargetOffset = Gate.IsBlendingOut() ? FQuat::Identity : State.Ground.TargetFootRotationCS;
+		State.LastRotationOffset  = bInterpolateRotation ?
+			FQuat::Slerp(State.LastRotationOffset, TargetOffset, FMath::Clamp(RotationSlerpSpeed * DeltaTime, 0.0f, 1.0f)) :
+			TargetOffset;
+
+		FootCSTransform.SetRotation(State.LastRotationOffset * FootCSTransform.GetRotation());
+	}
+
+	OutBoneTransforms.Add(FBoneTransform(Chain.HipBone.BoneIndex, HipCSTransform));
+	OutBoneTransforms.Add(FBoneTransform(Chain.ThighBone.BoneIndex, KneeCSTransform));
+	OutBoneTransforms.Add(FBoneTransform(Chain.ShinBone.BoneIndex, FootCSTransform));
+}
+
+void FAnimNode_HumanoidLocomotionIK::EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output,
+	TArray<FBoneTransform>& OutBoneTransforms)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HumanoidLocomotionIK_Eval);
+
+	bool bHasOffsets = !LastPelvisOffset.IsNearlyZero() ||
+		!LeftLegState.LastEffectorOffset.IsNearlyZero() || !LeftLegState.LastRotationOffset.IsIdentity(KINDA_SMALL_NUMBER) ||
+		!RightLegState.LastEffectorOffset.IsNearlyZero() || !RightLegState.LastRotationOffset.IsIdentity(KINDA_SMALL_NUMBER);
+
+	if (!Gate.Evaluate(GateSettings, ActualAlpha, Output.AnimInstanceProxy->GetEvaluationCounter(), bHasOffsets))
+	{
+		return;
+	}
+
+	if (Gate.WasReopened())
+	{
+		// Ease back in from the incoming pose
+		LastPelvisOffset = FVector::ZeroVector;
+		LeftLegState.LastEffectorOffset  = FVector::ZeroVector;
+		LeftLegState.LastRotationOffset  = FQuat::Identity;
+		RightLegState.LastEffectorOffset = FVector::ZeroVector;
+		RightLegState.LastRotationOffset = FQuat::Identity;
+	}
+
+#if ENABLE_ANIM_DEBUG
+	check(Output.AnimInstanceProxy->GetSkelMeshComponent());
+#endif
+	check(OutBoneTransforms.Num() == 0);
+
+	// Input pin pointers are checked in IsValid -- don't need to check here
+	ACharacter* Character = Snapshot.Character;
+	if (Character == nullptr)
+	{
+#if ENABLE_IK_DEBUG_VERBOSE
+		UE_LOG(LogRTIK, Warning, TEXT("FAnimNode_HumanoidLocomotionIK -- evaluation failed, skeletal mesh component owner could not be cast to ACharacter"));
+#endif // ENABLE_IK_DEBUG_VERBOSE
+		return;
+	}
+
+	// While gated off, the offsets ease back to the incoming pose; the ground isn't needed
+	if (!Gate.IsBlendingOut())
+	{
+		FindGround(Output.Pose, *LeftLeg, LeftLegTraceData, LeftLegState);
+		FindGround(Output.Pose, *RightLeg, RightLegTraceData, RightLegState);
+	}
+
+	// Pelvis adjustment, as in FAnimNode_HumanoidPelvisHeightAdjustment: move so the lowest floor point is in reach
+	FTransform PelvisCSTransform = Output.Pose.GetComponentSpaceTransform(PelvisBone->Bone.BoneIndex);
+	FVector RootCS               = Output.Pose.GetComponentSpaceTransform(FCompactPoseBoneIndex(0)).GetLocation();
+
+	float TargetPelvisDelta = 0.0f;
+	if (!Gate.IsBlendingOut() && (LeftLegState.TraceData.FootSample.bValid || RightLegState.TraceData.FootSample.bValid))
+	{
+		TargetPelvisDelta = FMath::Min(LeftLegState.Ground.FloorPointCS.Z, RightLegState.Ground.FloorPointCS.Z) - RootCS.Z;
+		if (FMath::Abs(TargetPelvisDelta) > MaxPelvisAdjustSize)
+		{
+			TargetPelvisDelta = 0.0f;
+		}
+	}
+
+	FVector PelvisTargetCS    = PelvisCSTransform.GetLocation() + FVector(0.0f, 0.0f, TargetPelvisDelta);
+	FVector PreviousPelvisLoc = PelvisCSTransform.GetLocation() + LastPelvisOffset;
+	LastPelvisOffset          = LastPelvisOffset + (PelvisTargetCS - PreviousPelvisLoc).GetClampedToMaxSize(PelvisAdjustVelocity * DeltaTime);
+
+	PelvisCSTransform.AddToTranslation(LastPelvisOffset);
+	OutBoneTransforms.Add(FBoneTransform(PelvisBone->Bone.BoneIndex, PelvisCSTransform));
+
+	SolveLeg(Character, Output.Pose, *LeftLeg, LastPelvisOffset, LeftLegState, OutBoneTransforms);
+	SolveLeg(Character, Output.Pose, *RightLeg, LastPelvisOffset, RightLegState, OutBoneTransforms);
+
+	// Bone transforms must be applied parents first
+	OutBoneTransforms.Sort(FCompareBoneTransformIndex());
+	CommitSettings.DiscardUnchangedBones(Output.Pose, OutBoneTransforms);
+
+#if WITH_EDITOR
+	if (bEnableDebugDraw)
+	{
+		UWorld* World                      = Snapshot.World;
+		const FTransform& ComponentToWorld = Snapshot.ComponentToWorld;
+
+		FDebugDrawUtil::DrawSphere(World, ComponentToWorld.TransformPosition(PelvisCSTransform.GetLocation()), FColor(0, 0, 255), 20.0f);
+		FDebugDrawUtil::DrawSphere(World, ComponentToWorld.TransformPosition(LeftLegState.Ground.FloorPointCS), FColor(0, 255, 0), 10.0f);
+		FDebugDrawUtil::DrawSphere(World, ComponentToWorld.TransformPosition(RightLegState.Ground.FloorPointCS), FColor(255, 0, 0), 10.0f);
+	}
+#endif // WITH_EDITOR
+}
+
+bool FAnimNode_HumanoidLocomotionIK::IsValidToEvaluate(const USkeleton* Skeleton, const FBoneContainer& RequiredBones)
+{
+	if (LeftLeg == nullptr || RightLeg == nullptr || PelvisBone == nullptr)
+	{
+#if ENABLE_IK_DEBUG_VERBOSE
+		UE_LOG(LogRTIK, Warning, TEXT("IK Node Humanoid Locomotion IK was not valid -- one of the bone wrappers was null"));
+#endif // ENABLE_IK_DEBUG_VERBOSE
+		return false;
+	}
+
+	bool bValid = LeftLeg->InitIfInvalid(RequiredBones)
+		&& RightLeg->InitIfInvalid(RequiredBones)
+		&& PelvisBone->InitIfInvalid(RequiredBones);
+
+#if ENABLE_IK_DEBUG_VERBOSE
+	if (!bValid)
+	{
+		UE_LOG(LogRTIK, Warning, TEXT("IK Node Humanoid Locomotion IK was not valid to evaluate"));
+	}
+#endif // ENABLE_IK_DEBUG_VERBOSE
+
+	return bValid;
+}
+
+void FAnimNode_HumanoidLocomotionIK::InitializeBoneReferences(const FBoneContainer& RequiredBones)
+{
+	if (LeftLeg == nullptr || RightLeg == nullptr || PelvisBone == nullptr)
+	{
+#if ENABLE_IK_DEBUG
+		UE_LOG(LogRTIK, Warning, TEXT("Could not initialize Humanoid Locomotion IK -- one of the bone wrappers was null"));
+#endif // ENABLE_IK_DEBUG
+		return;
+	}
+
+	if (!LeftLeg->InitBoneReferences(RequiredBones))
+	{
+#if ENABLE_IK_DEBUG
+		UE_LOG(LogRTIK, Warning, TEXT("Could not initialize left leg for Humanoid Locomotion IK"));
+#endif // ENABLE_IK_DEBUG
+	}
+
+	if (!RightLeg->InitBoneReferences(RequiredBones))
+	{
+#if ENABLE_IK_DEBUG
+		UE_LOG(LogRTIK, Warning, TEXT("Could not initialize right leg for Humanoid Locomotion IK"));
+#endif // ENABLE_IK_DEBUG
+	}
+
+	if (!PelvisBone->Init(RequiredBones))
+	{
+#if ENABLE_IK_DEBUG
+		UE_LOG(LogRTIK, Warning, TEXT("Could not initialize pelvis bone for Humanoid Locomotion IK"));
+#endif // ENABLE_IK_DEBUG
+	}
+}
@@ -15,9 +15,16 @@
 
 DECLARE_CYCLE_STAT(TEXT("IK Humanoid Pelvis Height Adjust Eval"), STAT_HumanoidPelvisHeightAdjust_Eval, STATGROUP_Anim);
 
+void FAnimNode_HumanoidPelvisHeightAdjustment::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	Snapshot.Capture(InAnimInstance);
+	Gate.CaptureCurve(GateSettings, InAnimInstance);
+}
+
 void FAnimNode_HumanoidPelvisHeightAdjustment::UpdateInternal(const FAnimationUpdateContext & Context)
 {
 	DeltaTime = Context.GetDeltaTime();
+	LODLevel  = Context.AnimInstanceProxy->GetLODLevel();
 }
 
 void FAnimNode_HumanoidPelvisHeightAdjustment::EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext & Output, 
@@ -25,6 +32,19 @@ void FAnimNode_HumanoidPelvisHeightAdjustment::EvaluateSkeletalControl_AnyThread
 {
 	SCOPE_CYCLE_COUNTER(STAT_HumanoidPelvisHeightAdjust_Eval);
 
+	if (!Gate.Evaluate(GateSettings, ActualAlpha, Output.AnimInstanceProxy->GetEvaluationCounter(), 
+		!LastPelvisOffset.IsNearlyZero()))
+	{
+		return;
+	}
+
+	if (Gate.WasReopened())
+	{
+		// Ease back in from the incoming pose, starting with a full solve
+		LastPelvisOffset = FVector::ZeroVector;
+		ReducedRateCounter.Reset();
+	}
+
 #if ENABLE_ANIM_DEBUG
 	check(Output.AnimInstanceProxy->GetSkelMeshComponent());
 #endif
@@ -48,7 +68,7 @@ void FAnimNode_HumanoidPelvisHeightAdjustment::EvaluateSkeletalControl_AnyThread
 	
 
 	USkeletalMeshComponent* SkelComp = Output.AnimInstanceProxy->GetSkelMeshComponent();
-	ACharacter* Character = Cast<ACharacter>(SkelComp->GetOwner());
+	ACharacter* Character = Snapshot.Character;
 	if(Character == nullptr)
 	{
 #if ENABLE_IK_DEBUG_VERBOSE
@@ -57,7 +77,7 @@ void FAnimNode_HumanoidPelvisHeightAdjustment::EvaluateSkeletalControl_AnyThread
 		return;
 	}
 
-	UWorld* World = Character->GetWorld();
+	UWorld* World = Snapshot.World;
 
 	// Find the foot that's farthest from the ground. Transition the hips downward so it's the height
 	// is where it would be, over flat ground.
@@ -65,25 +85,34 @@ void FAnimNode_HumanoidPelvisHeightAdjustment::EvaluateSkeletalControl_AnyThread
 	bool bReturnToCenter = false;
 	float TargetPelvisDelta = 0.0f;
 
-	if (LeftLegTraceData->GetTraceData().FootHitResult.GetActor()  == nullptr && 
-		RightLegTraceData->GetTraceData().FootHitResult.GetActor() == nullptr) 
+	// On reduced-rate frames, keep moving toward the last target instead of finding a new one
+	bool bFullSolve = ReducedRateCounter.Tick(ReducedRate, LODLevel);
+
+	if (Gate.IsBlendingOut())
+	{
+		// Gated off: ease the pelvis back to the incoming pose
+		bReturnToCenter = true;
+	}
+	else if (!bFullSolve)
+	{
+		bReturnToCenter   = bLastReturnToCenter;
+		TargetPelvisDelta = LastTargetPelvisDelta;
+	}
+	else if (!LeftLegTraceData->GetTraceData().FootSample.bValid && 
+		!RightLegTraceData->GetTraceData().FootSample.bValid) 
 	{
 		bReturnToCenter = true;
 	}
 	else	
 	{
 		// Check in component space; this way character rotation doesn't matter
-		FVector ToCS = -1 * SkelComp->GetComponentLocation();
-		FVector LeftFootFloorCS;
-		FVector RightFootFloorCS;
+		FVector LeftFootFloorCS  = LeftLegTraceData->GetGroundSolution().FloorPointCS;
+		FVector RightFootFloorCS = RightLegTraceData->GetGroundSolution().FloorPointCS;
 
 		FVector LeftFootCS       = FAnimUtil::GetBoneCSLocation(*SkelComp, Output.Pose, LeftLeg->Chain.ShinBone.BoneIndex);
 		FVector RightFootCS      = FAnimUtil::GetBoneCSLocation(*SkelComp, Output.Pose, RightLeg->Chain.ShinBone.BoneIndex);		
 		FVector RootCS           = FAnimUtil::GetBoneCSLocation(*SkelComp, Output.Pose, FCompactPoseBoneIndex(0));
 		
-		LeftLeg->Chain.GetIKFloorPointCS(*SkelComp, LeftLegTraceData->GetTraceData(), LeftFootFloorCS);
-		RightLeg->Chain.GetIKFloorPointCS(*SkelComp, RightLegTraceData->GetTraceData(), RightFootFloorCS);	
-		
 /*		
 		// The animroot, assumed to rest on the floor. The original animation assumed the floor was this high.
 		// The adjusted animation should maintain a similar relationship to the (possibly uneven) floor.
@@ -111,6 +140,9 @@ void FAnimNode_HumanoidPelvisHeightAdjustment::EvaluateSkeletalControl_AnyThread
 		}
 		
 	}
+
+	LastTargetPelvisDelta = TargetPelvisDelta;
+	bLastReturnToCenter   = bReturnToCenter;
    
 	
 	FVector TargetPelvisDeltaVec(0.0f, 0.0f, TargetPelvisDelta);
@@ -127,13 +159,14 @@ void FAnimNode_HumanoidPelvisHeightAdjustment::EvaluateSkeletalControl_AnyThread
 	PelvisTransformCS.SetLocation(NewPelvisLoc);
 
 	OutBoneTransforms.Add(FBoneTransform(PelvisBone->Bone.BoneIndex, PelvisTransformCS));
+	CommitSettings.DiscardUnchangedBones(Output.Pose, OutBoneTransforms);
 
 #if WITH_EDITOR
 	if (bEnableDebugDraw)
 	{
-		FVector PelvisLocWorld = FAnimUtil::GetBoneWorldLocation(*SkelComp, Output.Pose, PelvisBone->Bone.BoneIndex);
+		FVector PelvisLocWorld = FAnimUtil::GetBoneWorldLocation(Snapshot.ComponentToWorld, Output.Pose, PelvisBone->Bone.BoneIndex);
 		FTransform PelvisTarget(PelvisTransformCS);
-		FAnimationRuntime::ConvertCSTransformToBoneSpace(SkelComp->GetComponentTransform(), Output.Pose,
+		FAnimationRuntime::ConvertCSTransformToBoneSpace(Snapshot.ComponentToWorld, Output.Pose,
 			PelvisTarget, PelvisBone->Bone.BoneIndex, BCS_WorldSpace);
 		
 		FDebugDrawUtil::DrawSphere(World, PelvisLocWorld, FColor(255, 0, 0), 20.0f);
@@ -157,10 +190,10 @@ void FAnimNode_HumanoidPelvisHeightAdjustment::EvaluateSkeletalControl_AnyThread
 			FDebugDrawUtil::DrawString(World, TextOffset, AdjustStr, Character, FColor(0, 0, 255));
 		}		
 
-		FVector LeftTraceWorld = LeftLegTraceData->GetTraceData().FootHitResult.ImpactPoint; 
+		FVector LeftTraceWorld = Snapshot.ComponentToWorld.TransformPosition(LeftLegTraceData->GetTraceData().FootSample.Location); 
 		FDebugDrawUtil::DrawSphere(World, LeftTraceWorld, FColor(0, 255, 0), 20.0f); 
 
-		FVector RightTraceWorld = RightLegTraceData->GetTraceData().FootHitResult.ImpactPoint; 
+		FVector RightTraceWorld = Snapshot.ComponentToWorld.TransformPosition(RightLegTraceData->GetTraceData().FootSample.Location); 
 		FDebugDrawUtil::DrawSphere(World, RightTraceWorld, FColor(255, 0, 0), 20.0f); 
 
 	}
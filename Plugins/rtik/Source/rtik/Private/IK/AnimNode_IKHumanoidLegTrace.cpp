@@ -3,20 +3,359 @@
 #include "rtik.h"
 #include "AnimNode_IKHumanoidLegTrace.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Animation/AnimInstance.h"
 #include "Animation/AnimInstanceProxy.h"
 #include "Runtime/AnimationCore/Public/TwoBoneIK.h"
 #include "Utility/AnimUtil.h" 
+#include "Utility/TraceUtil.h"
+#include "GroundQueryService.h"
+#include "GroundSampleHash.h"
+#include "GroundProvider.h"
 
 #if WITH_EDITOR
 #include "Utility/DebugDrawUtil.h"
 #endif
 
 DECLARE_CYCLE_STAT(TEXT("IK Humanoid Leg IK Trace"), STAT_IKHumanoidLegTrace_Eval, STATGROUP_Anim);
+DECLARE_CYCLE_STAT(TEXT("IK Humanoid Leg IK Trace PreUpdate"), STAT_IKHumanoidLegTrace_PreUpdate, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Cache Hits"), STAT_IKHumanoidLegTrace_GroundCacheHits, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Cache Misses"), STAT_IKHumanoidLegTrace_GroundCacheMisses, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Footfall Plant Probes"), STAT_IKHumanoidLegTrace_PlantProbes, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Plant-Locked Trace Skips"), STAT_IKHumanoidLegTrace_PlantLockedSkips, STATGROUP_Anim);
+
+void FAnimNode_IKHumanoidLegTrace::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKHumanoidLegTrace_PreUpdate);
+
+	Snapshot.Capture(InAnimInstance);
+	Gate.CaptureCurve(GateSettings, InAnimInstance);
+
+	if (TraceData == nullptr)
+	{
+		return;
+	}
+
+	USkeletalMeshComponent* SkelComp = InAnimInstance->GetSkelMeshComponent();
+	UWorld* World                    = Snapshot.World;
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	if (FootfallPrediction.bEnable)
+	{
+		AActor* Owner  = SkelComp->GetOwner();
+		RootVelocityWS = Owner != nullptr ? Owner->GetVelocity() : FVector::ZeroVector;
+	}
+
+	// The height field is traced from here, so evaluation only reads it
+	if (HeightField != nullptr && Snapshot.Character != nullptr && Gate.IsCurveOpen(GateSettings))
+	{
+		HeightField->HeightField.Update(World, Snapshot.Character, Snapshot.ComponentToWorld.GetLocation(),
+			HeightField->Settings, QueryQuality.GetQuality(LODLevel));
+	}
+
+	if (bUseAsyncTrace)
+	{
+		CollectAsyncTraces(World);
+	}
+
+	// On reduced-rate frames, evaluation deliberately reuses the previous results, so there's nothing to query
+	bQueryFrame = ReducedRateCounter.Tick(ReducedRate, LODLevel);
+
+	// Don't query for a node that's gated off
+	if (!bQueryFrame || !bRequestQuery || !Gate.IsCurveOpen(GateSettings))
+	{
+		return;
+	}
+	
+	// Query from where the feet were last frame, relative to where the component is now
+	bRequestQuery = false;
+
+	const FTransform& ComponentToWorld     = Snapshot.ComponentToWorld;
+	FHumanoidLegTraceEndpoints EndpointsWS = QueryEndpointsCS.TransformBy(ComponentToWorld);
+
+	if (HeightField != nullptr && Snapshot.Character != nullptr && QueryHeightField(EndpointsWS))
+	{
+		bHasQueryResults = true;
+	}
+	else if (bUseAsyncTrace && bHasQueryResults)
+	{
+		RequestAsyncTraces(World, SkelComp->GetOwner(), EndpointsWS);
+	}
+	else
+	{
+		QueryGround(EndpointsWS);
+	}
+}
+
+bool FAnimNode_IKHumanoidLegTrace::QueryHeightField(const FHumanoidLegTraceEndpoints& EndpointsWS)
+{
+	FHumanoidLegGroundHits FieldHits;
+	if (HeightField->HeightField.GetHit(EndpointsWS.FootTraceStart, EndpointsWS.FootTraceEnd, FieldHits.FootHitResult) &&
+		HeightField->HeightField.GetHit(EndpointsWS.ToeTraceStart, EndpointsWS.ToeTraceEnd, FieldHits.ToeHitResult))
+	{
+		FieldHits.ToTraceData(Snapshot.ComponentToWorld, TraceData->TraceData);
+		return true;
+	}
+
+	return false;
+}
+
+void FAnimNode_IKHumanoidLegTrace::CollectAsyncTraces(UWorld* World)
+{
+	const FTransform& ComponentToWorld = Snapshot.ComponentToWorld;
+
+	// Batched traces are written into the trace data wrapper by the service, in world space
+	int32 NumQueryResults = TraceData->GetNumQueryResultsReceived();
+	bool bReceivedResults = NumQueryResults != LastNumQueryResults;
+	LastNumQueryResults   = NumQueryResults;
+
+	if (bReceivedResults)
+	{
+		TraceData->TraceData = TraceData->QueryResultsWS.InverseTransformBy(ComponentToWorld);
+	}
+
+	// Collect the traces requested last frame. If they aren't available (e.g., the anim instance 
+	// skipped a frame), the previous results are kept.
+	if (FootTraceHandle.IsValid() && ToeTraceHandle.IsValid())
+	{
+		FHumanoidLegGroundHits Hits;
+		if (UTraceUtil::QueryAsyncLineTrace(World, FootTraceHandle, Hits.FootHitResult) &&
+			UTraceUtil::QueryAsyncLineTrace(World, ToeTraceHandle, Hits.ToeHitResult))
+		{
+			Hits.ToTraceData(ComponentToWorld, TraceData->TraceData);
+			bReceivedResults = true;
+		}
+	}
+
+	FootTraceHandle = FTraceHandle();
+	ToeTraceHandle  = FTraceHandle();
+
+	if (bReceivedResults)
+	{
+		bHasQueryResults = true;
+		if (GroundCacheSettings.bEnable)
+		{
+			GroundCache.Store(PendingTraceEndpointsWS, TraceData->TraceData, ComponentToWorld);
+		}
+	}
+}
+
+void FAnimNode_IKHumanoidLegTrace::RequestAsyncTraces(UWorld* World, 
+	AActor* Owner, 
+	const FHumanoidLegTraceEndpoints& EndpointsWS)
+{
+	const FTransform& ComponentToWorld = Snapshot.ComponentToWorld;
+
+	if (GroundCacheSettings.bEnable)
+	{
+		bool bCacheHit = GroundCache.TryProject(EndpointsWS, GroundCacheSettings, ComponentToWorld, TraceData->TraceData);
+		RecordGroundCacheResult(bCacheHit);
+
+		if (bCacheHit)
+		{
+			bHasQueryResults = true;
+			return;
+		}
+	}
+
+	PendingTraceEndpointsWS = EndpointsWS;
+
+	if (bBatchTraces)
+	{
+		FIKGroundQueryService::Get(World).RequestLegTrace(Owner, TraceData, EndpointsWS, QueryQuality.GetQuality(LODLevel));
+		return;
+	}
+
+	const FIKGroundQueryQuality& Quality = QueryQuality.GetQuality(LODLevel);
+
+	FootTraceHandle = UTraceUtil::AsyncLineTrace(World, Owner, EndpointsWS.FootTraceStart, EndpointsWS.FootTraceEnd,
+		ECC_Pawn, Quality.bReturnPhysicalMaterial, Quality.bTraceComplex, Quality.bReturnFaceIndex);
+	ToeTraceHandle  = UTraceUtil::AsyncLineTrace(World, Owner, EndpointsWS.ToeTraceStart, EndpointsWS.ToeTraceEnd,
+		ECC_Pawn, Quality.bReturnPhysicalMaterial, Quality.bTraceComplex, Quality.bReturnFaceIndex);
+}
+
+void FAnimNode_IKHumanoidLegTrace::QueryGround(const FHumanoidLegTraceEndpoints& EndpointsWS)
+{
+	ACharacter* Character              = Snapshot.Character;
+	const FTransform& ComponentToWorld = Snapshot.ComponentToWorld;
+	bHasQueryResults                   = true;
+
+	if (FootfallPrediction.bEnable && Character != nullptr && !bUseAsyncTrace && UpdateFootfallPrediction(QueryEndpointsCS, EndpointsWS))
+	{
+		return;
+	}
+
+	bool bUseGroundCache = GroundCacheSettings.bEnable && Character != nullptr;
+	if (bUseGroundCache || ((bUseSharedGroundSamples || bUseLandscapeGroundProvider || bUseBakedGround) && Character != nullptr))
+	{
+		bool bCacheHit = false;
+		if (bUseGroundCache)
+		{
+			bCacheHit = GroundCache.TryProject(EndpointsWS, GroundCacheSettings, ComponentToWorld, TraceData->TraceData);
+			RecordGroundCacheResult(bCacheHit);
+		}
+
+		if (!bCacheHit)
+		{
+			ProbeGround(ComponentToWorld, EndpointsWS, TraceData->TraceData);
+
+			if (bUseGroundCache)
+			{
+				GroundCache.Store(EndpointsWS, TraceData->TraceData, ComponentToWorld);
+			}
+		}
+	}
+	else
+	{
+		FHumanoidLegGroundHits Hits;
+		FHumanoidIK::ProbeLegEndpoints(Snapshot.World, Character, Leg->Chain, EndpointsWS, QueryQuality.GetQuality(LODLevel),
+			Hits, false);
+		Hits.ToTraceData(ComponentToWorld, TraceData->TraceData);
+	}
+}
+
+void FAnimNode_IKHumanoidLegTrace::ProbeGround(const FTransform& ComponentToWorld,
+	const FHumanoidLegTraceEndpoints& EndpointsWS,
+	FHumanoidIKTraceData& OutTraceData)
+{
+	UWorld* World = Snapshot.World;
+
+	// Providers are kept alive by these pointers until probing is done
+	TSharedPtr<FIKBakedGroundProvider, ESPMode::ThreadSafe> BakedProvider;
+	TSharedPtr<FIKLandscapeGroundProvider, ESPMode::ThreadSafe> LandscapeProvider;
+	FIKGroundProviderList Providers;
+
+	if (bUseBakedGround)
+	{
+		BakedProvider = FIKBakedGroundProvider::Get(World);
+		Providers.Add(BakedProvider.Get());
+	}
+
+	if (bUseLandscapeGroundProvider)
+	{
+		LandscapeProvider = FIKLandscapeGroundProvider::Get(World);
+		Providers.Add(LandscapeProvider.Get());
+	}
+
+	FIKGroundProvider* GroundProvider = Providers.IsEmpty() ? nullptr : &Providers;
+	FHumanoidLegGroundHits Hits;
+
+	const FIKGroundQueryQuality& Quality = QueryQuality.GetQuality(LODLevel);
+
+	if (!bUseSharedGroundSamples)
+	{
+		FHumanoidIK::ProbeLegEndpoints(World, Snapshot.Character, Leg->Chain, EndpointsWS, Quality, 
+			Hits, false, GroundProvider);
+		Hits.ToTraceData(ComponentToWorld, OutTraceData);
+		return;
+	}
+
+	// Try hits shared by other characters first; share ours if there weren't any
+	TSharedRef<FIKGroundSampleHash, ESPMode::ThreadSafe> SampleHash = FIKGroundSampleHash::Get(World);
+
+	if (SampleHash->FindHit(EndpointsWS.FootTraceStart, EndpointsWS.FootTraceEnd, Quality, Hits.FootHitResult) &&
+		SampleHash->FindHit(EndpointsWS.ToeTraceStart, EndpointsWS.ToeTraceEnd, Quality, Hits.ToeHitResult))
+	{
+		Hits.ToTraceData(ComponentToWorld, OutTraceData);
+		return;
+	}
+
+	FHumanoidIK::ProbeLegEndpoints(World, Snapshot.Character, Leg->Chain, EndpointsWS, Quality, 
+		Hits, false, GroundProvider);
+	SampleHash->AddHit(Hits.FootHitResult, Quality);
+	SampleHash->AddHit(Hits.ToeHitResult, Quality);
+	Hits.ToTraceData(ComponentToWorld, OutTraceData);
+}
+
+bool FAnimNode_IKHumanoidLegTrace::UpdateFootfallPrediction(const FHumanoidLegTraceEndpoints& EndpointsCS,
+	const FHumanoidLegTraceEndpoints& EndpointsWS)
+{
+	// Foot trace endpoints are directly below / above the foot
+	FVector FootLocationCS(EndpointsCS.FootTraceStart.X, EndpointsCS.FootTraceStart.Y, 0.0f);
+	float DeltaTime     = PredictionDeltaTime;
+	PredictionDeltaTime = 0.0f;
+
+	if (!bHasLastFootLocation || DeltaTime < KINDA_SMALL_NUMBER)
+	{
+		LastFootLocationCS   = FootLocationCS;
+		bHasLastFootLocation = true;
+		return false;
+	}
+
+	FVector FootVelocityCS = (FootLocationCS - LastFootLocationCS) / DeltaTime;
+	LastFootLocationCS     = FootLocationCS;
+
+	// World-space foot velocity is root velocity plus animated velocity. A planted foot moves 
+	// backward in component space about as fast as the root moves forward.
+	const FTransform& ComponentToWorld = Snapshot.ComponentToWorld;
+	FVector UpVector                   = ComponentToWorld.GetUnitAxis(EAxis::Z);
+	FVector FootVelocityWS             = RootVelocityWS + ComponentToWorld.TransformVector(FootVelocityCS);
+	FootVelocityWS                    -= FVector::DotProduct(FootVelocityWS, UpVector) * UpVector;
+
+	if (FootVelocityWS.SizeSquared() < FootfallPrediction.PlantSpeedThreshold * FootfallPrediction.PlantSpeedThreshold)
+	{
+		bInSwing = false;
+		return false;
+	}
+
+	// Foot just lifted off; probe where it will land, once for the whole step
+	if (!bInSwing)
+	{
+		bInSwing = true;
+
+		FVector PlantOffset = FootVelocityWS * FootfallPrediction.LookAheadTime;
+		FHumanoidLegTraceEndpoints PlantEndpointsWS;
+		PlantEndpointsWS.FootTraceStart = EndpointsWS.FootTraceStart + PlantOffset;
+		PlantEndpointsWS.FootTraceEnd   = EndpointsWS.FootTraceEnd + PlantOffset;
+		PlantEndpointsWS.ToeTraceStart  = EndpointsWS.ToeTraceStart + PlantOffset;
+		PlantEndpointsWS.ToeTraceEnd    = EndpointsWS.ToeTraceEnd + PlantOffset;
+
+		FHumanoidIKTraceData PlantTraceData;
+		ProbeGround(ComponentToWorld, PlantEndpointsWS, PlantTraceData);
+		PlantProbe.Store(PlantEndpointsWS, PlantTraceData, ComponentToWorld);
+		PlantProbeDistance = PlantOffset.Size();
+
+		INC_DWORD_STAT(STAT_IKHumanoidLegTrace_PlantProbes);
+	}
+
+	// Answer from the plant probe while the foot travels toward the predicted plant location
+	FHumanoidLegGroundCacheSettings PlantProbeSettings;
+	PlantProbeSettings.bEnable                    = true;
+	PlantProbeSettings.RetraceDistance            = PlantProbeDistance + FootfallPrediction.PlantProbeTolerance;
+	PlantProbeSettings.RevalidationIntervalFrames = MAX_int32;
+
+	return PlantProbe.TryProject(EndpointsWS, PlantProbeSettings, ComponentToWorld, TraceData->TraceData);
+}
+
+void FAnimNode_IKHumanoidLegTrace::RecordGroundCacheResult(bool bHit)
+{
+	if (bHit)
+	{
+		INC_DWORD_STAT(STAT_IKHumanoidLegTrace_GroundCacheHits);
+		++TraceData->GroundCacheHits;
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_IKHumanoidLegTrace_GroundCacheMisses);
+		++TraceData->GroundCacheMisses;
+	}
+}
+
+void FAnimNode_IKHumanoidLegTrace::FinishTraceDataUpdate()
+{
+	Leg->Chain.SolveGround(TraceData->TraceData, TraceData->GroundSolution);
+	TraceData->bUpdatedThisTick = true;
+	TraceDataComponentToWorld   = Snapshot.ComponentToWorld;
+}
 
 void FAnimNode_IKHumanoidLegTrace::UpdateInternal(const FAnimationUpdateContext & Context)
 {
 	// Mark trace data as stale
 	TraceData->bUpdatedThisTick = false;
+	LODLevel = Context.AnimInstanceProxy->GetLODLevel();
+	PredictionDeltaTime += Context.GetDeltaTime();
 }
 
 void FAnimNode_IKHumanoidLegTrace::EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, 
@@ -24,19 +363,81 @@ void FAnimNode_IKHumanoidLegTrace::EvaluateSkeletalControl_AnyThread(FComponentS
 {
 	SCOPE_CYCLE_COUNTER(STAT_IKHumanoidLegTrace_Eval);
 
+	if (!Gate.Evaluate(GateSettings, ActualAlpha, Output.AnimInstanceProxy->GetEvaluationCounter()))
+	{
+		// Hold the last trace data where it was in the world, so nodes reading it this tick get a deliberate 
+		// reuse instead of stale data
+		if (Leg != nullptr)
+		{
+			TraceData->TraceData = TraceData->TraceData.TransformBy(TraceDataComponentToWorld)
+				.InverseTransformBy(Snapshot.ComponentToWorld);
+			FinishTraceDataUpdate();
+		}
+		return;
+	}
+
+	if (Gate.WasReopened())
+	{
+		// Query on the next PreUpdate; the last foot location is too old to predict from
+		ReducedRateCounter.Reset();
+		bHasLastFootLocation = false;
+	}
+
 	if (Leg == nullptr || PelvisBone == nullptr) 
 	{
 		return;
 	}
 
-	USkeletalMeshComponent* SkelComp    = Output.AnimInstanceProxy->GetSkelMeshComponent();
-	ACharacter* Character               = Cast<ACharacter>(SkelComp->GetOwner());
-	const FBoneContainer& RequiredBones = Output.AnimInstanceProxy->GetRequiredBones();
+	// While the leg IK node holds the foot plant-locked, the ground latched at plant time is reused until lift-off
+	if (TraceData->IsPlantLocked())
+	{
+		INC_DWORD_STAT(STAT_IKHumanoidLegTrace_PlantLockedSkips);
+		TraceData->TraceData = TraceData->PlantTraceDataWS.InverseTransformBy(Snapshot.ComponentToWorld);
+		bWasPlantLocked      = true;
+		FinishTraceDataUpdate();
+		return;
+	}
+
+	// The foot just lifted off. Anything queried before the plant is out of date, so the next PreUpdate queries
+	// synchronously instead of waiting a frame for async results.
+	if (bWasPlantLocked)
+	{
+		bWasPlantLocked  = false;
+		bHasQueryResults = false;
+		FootTraceHandle  = FTraceHandle();
+		ToeTraceHandle   = FTraceHandle();
+		ReducedRateCounter.Reset();
+	}
+
+	// Only state captured in PreUpdate is used from here on; this may be running on a worker thread
+	ACharacter* Character              = Snapshot.Character;
+	const FTransform& ComponentToWorld = Snapshot.ComponentToWorld;
+
+	// Scene queries are left to the next PreUpdate, on the game thread, from where the feet are now. Results 
+	// queried there are already in the trace data; until the first ones arrive, the trace data stays invalid 
+	// and leg IK leaves the leg alone.
+	FHumanoidLegTraceEndpoints EndpointsCS;
+	FHumanoidIK::ComputeLegTraceEndpointsCS(Output.Pose, Leg->Chain, PelvisBone->Bone, MaxPelvisAdjustSize, EndpointsCS);
+	QueryEndpointsCS = EndpointsCS;
+	bRequestQuery    = true;
+
+	// On reduced-rate frames, the previous results are deliberately reused. Async results may still have 
+	// arrived in PreUpdate, so the ground is solved anyway.
+	if (!bQueryFrame)
+	{
+		FinishTraceDataUpdate();
+		return;
+	}
 
-	FHumanoidIK::HumanoidIKLegTrace(Character, Output.Pose, Leg->Chain,
-		PelvisBone->Bone, MaxPelvisAdjustSize, TraceData->TraceData, false);
+	// Answer from the height field if it covers both trace points. It was updated in PreUpdate.
+	FHumanoidLegTraceEndpoints EndpointsWS = EndpointsCS.TransformBy(ComponentToWorld);
+	if (HeightField != nullptr && Character != nullptr && 
+		QueryHeightField(EndpointsWS))
+	{
+		bRequestQuery = false;
+	}
 	
-	TraceData->bUpdatedThisTick = true;
+	FinishTraceDataUpdate();
 }
 
 
@@ -6,13 +6,36 @@
 #include "Animation/AnimInstanceProxy.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "IK/RangeLimitedFABRIK.h"
+#include "IK/Constraints.h"
 #include "Utility/DebugDrawUtil.h"
 
 DECLARE_CYCLE_STAT(TEXT("IK Range Limited FABRIK"), STAT_RangeLimitedFabrik_Eval, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Range Limited FABRIK Analytic Solves"), STAT_RangeLimitedFabrik_NumAnalytic, STATGROUP_Anim);
+
+void FAnimNode_RangeLimitedFabrik::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	Snapshot.Capture(InAnimInstance);
+	Gate.CaptureCurve(GateSettings, InAnimInstance);
+
+	if (SolverRecording != nullptr && IKChain != nullptr)
+	{
+		TArray<UIKBoneConstraintWrapper*> ChainConstraints;
+		for (const FIKBone& Link : IKChain->Chain)
+		{
+			ChainConstraints.Add(Link.GetConstraintWrapper());
+		}
+		SolverRecorder.Flush(SolverRecording, ChainConstraints);
+	}
+}
 
 void FAnimNode_RangeLimitedFabrik::EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, TArray<FBoneTransform>& OutBoneTransforms)
 {
 	SCOPE_CYCLE_COUNTER(STAT_RangeLimitedFabrik_Eval);
+
+	if (!Gate.Evaluate(GateSettings, ActualAlpha, Output.AnimInstanceProxy->GetEvaluationCounter()))
+	{
+		return;
+	}
 	
 	const FBoneContainer& BoneContainer = Output.Pose.GetPose().GetBoneContainer();
 
@@ -51,11 +74,51 @@ void FAnimNode_RangeLimitedFabrik::EvaluateSkeletalControl_AnyThread(FComponentS
 
 	TArray<FTransform> DestCSTransforms;
 
-	ACharacter* Character = Cast<ACharacter>(Output.AnimInstanceProxy->GetSkelMeshComponent()->GetOwner());
+	ACharacter* Character = Snapshot.Character;
 	bool bBoneLocationUpdated = false;
 
-	if (SolverMode == ERangeLimitedFABRIKSolverMode::RLF_Normal)
+	// Chains with a closed-form solution skip FABRIK, if allowed. Root dragging isn't supported by the analytic solver.
+	FPlanarRotation* Hinge = nullptr;
+	int32 HingeBoneIndex   = INDEX_NONE;
+	bool bUseAnalyticSolver = bUseAnalyticTwoBoneSolver &&
+		SolverMode == ERangeLimitedFABRIKSolverMode::RLF_Normal &&
+		MaxRootDragDistance <= 0.0f &&
+		ClassifyChain(Hinge, HingeBoneIndex) != ERangeLimitedFABRIKChainType::General;
+
+	if (bUseAnalyticSolver)
+	{
+		INC_DWORD_STAT(STAT_RangeLimitedFabrik_NumAnalytic);
+
+		// Give the hinge the same chance to set itself up as FABRIK would
+		TArray<FTransform> AnalyticCSTransforms(SourceCSTransforms);
+		if (Hinge != nullptr && Hinge->bEnabled)
+		{
+			Hinge->SetupFn(
+				HingeBoneIndex,
+				SourceCSTransforms,
+				Constraints,
+				AnalyticCSTransforms
+			);
+		}
+		else
+		{
+			Hinge = nullptr;
+		}
+
+		bBoneLocationUpdated = FRangeLimitedFABRIK::SolveTwoBoneAnalytic(
+			AnalyticCSTransforms,
+			Hinge,
+			HingeBoneIndex,
+			CSEffectorTransform.GetLocation(),
+			DestCSTransforms,
+			Precision
+		);
+	}
+	else if (SolverMode == ERangeLimitedFABRIKSolverMode::RLF_Normal)
 	{
+		SolverRecorder.Capture(SolverRecording, SourceCSTransforms, CSEffectorTransform.GetLocation(),
+			MaxRootDragDistance, RootDragStiffness);
+
 		bBoneLocationUpdated = FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
 			SourceCSTransforms,
 			Constraints,
@@ -113,6 +176,8 @@ void FAnimNode_RangeLimitedFabrik::EvaluateSkeletalControl_AnyThread(FComponentS
 		{
 			OutBoneTransforms.Add(FBoneTransform(IKChain->Chain[i].BoneIndex, DestCSTransforms[i]));
 		}
+
+		CommitSettings.DiscardUnchangedBones(Output.Pose, OutBoneTransforms);
 	}
 
 
@@ -120,9 +185,8 @@ void FAnimNode_RangeLimitedFabrik::EvaluateSkeletalControl_AnyThread(FComponentS
 
 	if (bEnableDebugDraw)
 	{
-		USkeletalMeshComponent* SkelComp = Output.AnimInstanceProxy->GetSkelMeshComponent();
-		UWorld* World = SkelComp->GetWorld();
-		FMatrix ToWorld = SkelComp->GetComponentToWorld().ToMatrixNoScale();
+		UWorld* World = Snapshot.World;
+		FMatrix ToWorld = Snapshot.ComponentToWorld.ToMatrixNoScale();
 
 		if (SolverMode == ERangeLimitedFABRIKSolverMode::RLF_Normal)
 		{
@@ -269,6 +333,43 @@ void FAnimNode_RangeLimitedFabrik::InitializeBoneReferences(const FBoneContainer
 	EffectorTransformBone.Initialize(RequiredBones);
 }
 
+ERangeLimitedFABRIKChainType FAnimNode_RangeLimitedFabrik::ClassifyChain(FPlanarRotation*& OutHinge, 
+	int32& OutHingeBoneIndex) const
+{
+	OutHinge          = nullptr;
+	OutHingeBoneIndex = INDEX_NONE;
+
+	if (IKChain == nullptr || IKChain->Chain.Num() != 3)
+	{
+		return ERangeLimitedFABRIKChainType::General;
+	}
+
+	// The effector's constraint is never enforced, so only the two bones matter. Each may be unconstrained,
+	// and at most one may have a planar constraint. Anything else needs FABRIK.
+	for (int32 i = 0; i < 2; ++i)
+	{
+		UIKBoneConstraintWrapper* Wrapper = IKChain->Chain[i].GetConstraintWrapper();
+		if (Wrapper == nullptr || Wrapper->GetConstraint() == nullptr || Cast<UNoBoneConstraintWrapper>(Wrapper) != nullptr)
+		{
+			continue;
+		}
+
+		UPlanarConstraintWrapper* PlanarWrapper = Cast<UPlanarConstraintWrapper>(Wrapper);
+		if (PlanarWrapper != nullptr && OutHinge == nullptr)
+		{
+			OutHinge          = &PlanarWrapper->Constraint;
+			OutHingeBoneIndex = i;
+			continue;
+		}
+
+		OutHinge          = nullptr;
+		OutHingeBoneIndex = INDEX_NONE;
+		return ERangeLimitedFABRIKChainType::General;
+	}
+
+	return (OutHinge == nullptr) ? ERangeLimitedFABRIKChainType::TwoBone : ERangeLimitedFABRIKChainType::TwoBoneHinge;
+}
+
 void FAnimNode_RangeLimitedFabrik::GatherDebugData(FNodeDebugData& DebugData)
 {
 	FString DebugLine = DebugData.GetNodeName(this);
@@ -0,0 +1,282 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "BakedGround.h"
+#include "GroundProvider.h"
+#include "Utility/TraceUtil.h"
+#include "Components/BoxComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("IK Baked Ground Bake"), STAT_IKBakedGround_Bake, STATGROUP_Anim);
+
+const int32 UIKBakedGroundData::TileSize  = 32;
+const uint16 UIKBakedGroundData::NoGround = MAX_uint16;
+
+// Finest height quantization used, in cm. Coarser steps are used if the baked area spans more than 65534 steps.
+static const float MinBakedGroundHeightQuantum = 0.1f;
+
+#pragma region UIKBakedGroundData
+
+UIKBakedGroundData::UIKBakedGroundData()
+	:
+	Origin(ForceInitToZero),
+	CellSize(25.0f),
+	NumTilesX(0),
+	NumTilesY(0),
+	MinHeight(0.0f),
+	HeightQuantum(MinBakedGroundHeightQuantum),
+	MaxInterpolationHeightDelta(5.0f),
+	NumWalkableSamples(0)
+{ }
+
+void UIKBakedGroundData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+	Ar << Tiles;
+}
+
+bool UIKBakedGroundData::GetSample(int32 X, int32 Y, float& OutHeight, FVector& OutNormal) const
+{
+	if (X < 0 || Y < 0 || X >= NumTilesX * TileSize || Y >= NumTilesY * TileSize)
+	{
+		return false;
+	}
+
+	const FIKBakedGroundTile& Tile = Tiles[(Y / TileSize) * NumTilesX + X / TileSize];
+	if (Tile.Heights.Num() == 0)
+	{
+		return false;
+	}
+
+	int32 Index   = (Y % TileSize) * TileSize + X % TileSize;
+	uint16 Height = Tile.Heights[Index];
+	if (Height == NoGround)
+	{
+		return false;
+	}
+
+	uint16 PackedNormal = Tile.Normals[Index];
+	float NormalX       = static_cast<int8>(PackedNormal & 0xFF) / 127.0f;
+	float NormalY       = static_cast<int8>(PackedNormal >> 8) / 127.0f;
+
+	OutHeight = MinHeight + Height * HeightQuantum;
+	OutNormal = FVector(NormalX, NormalY, FMath::Sqrt(FMath::Max(0.0f, 1.0f - NormalX * NormalX - NormalY * NormalY)));
+	return true;
+}
+
+bool UIKBakedGroundData::Sample(const FVector2D& LocationWS, float& OutHeight, FVector& OutNormal) const
+{
+	if (Tiles.Num() == 0)
+	{
+		return false;
+	}
+
+	float GridX = (LocationWS.X - Origin.X) / CellSize;
+	float GridY = (LocationWS.Y - Origin.Y) / CellSize;
+	int32 X     = FMath::FloorToInt(GridX);
+	int32 Y     = FMath::FloorToInt(GridY);
+
+	float H00, H10, H01, H11;
+	FVector N00, N10, N01, N11;
+	if (!GetSample(X, Y, H00, N00) ||
+		!GetSample(X + 1, Y, H10, N10) ||
+		!GetSample(X, Y + 1, H01, N01) ||
+		!GetSample(X + 1, Y + 1, H11, N11))
+	{
+		return false;
+	}
+
+	// Don't smooth over step edges
+	if (FMath::Max3(H00, H10, FMath::Max(H01, H11)) - FMath::Min3(H00, H10, FMath::Min(H01, H11)) > MaxInterpolationHeightDelta)
+	{
+		return false;
+	}
+
+	float Alpha = GridX - X;
+	float Beta  = GridY - Y;
+	OutHeight   = FMath::BiLerp(H00, H10, H01, H11, Alpha, Beta);
+	OutNormal   = FMath::BiLerp(N00, N10, N01, N11, Alpha, Beta).GetSafeNormal();
+	return true;
+}
+
+void UIKBakedGroundData::Bake(UWorld* World,
+	const FBox& Bounds,
+	float InCellSize,
+	float WalkableFloorAngle,
+	float InMaxInterpolationHeightDelta)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKBakedGround_Bake);
+
+	Tiles.Empty();
+	NumTilesX          = 0;
+	NumTilesY          = 0;
+	NumWalkableSamples = 0;
+
+	if (World == nullptr || !Bounds.IsValid || InCellSize <= 0.0f)
+	{
+		UE_LOG(LogRTIK, Warning, TEXT("Could not bake ground for %s -- world, bounds, or cell size was invalid"), *GetPathName());
+		return;
+	}
+
+	Origin                      = FVector2D(Bounds.Min);
+	CellSize                    = InCellSize;
+	MaxInterpolationHeightDelta = InMaxInterpolationHeightDelta;
+
+	FVector BoundsSize = Bounds.GetSize();
+	int32 NumSamplesX  = FMath::FloorToInt(BoundsSize.X / CellSize) + 1;
+	int32 NumSamplesY  = FMath::FloorToInt(BoundsSize.Y / CellSize) + 1;
+	NumTilesX          = FMath::DivideAndRoundUp(NumSamplesX, TileSize);
+	NumTilesY          = FMath::DivideAndRoundUp(NumSamplesY, TileSize);
+
+	// Trace every sample first, so the height range is known before quantizing
+	int32 Stride = NumTilesX * TileSize;
+	TArray<float> Heights;
+	TArray<FVector> Normals;
+	Heights.Init(MAX_flt, Stride * NumTilesY * TileSize);
+	Normals.Init(FVector::UpVector, Stride * NumTilesY * TileSize);
+
+	float WalkableFloorZ = FMath::Cos(FMath::DegreesToRadians(WalkableFloorAngle));
+	float LowestHeight   = MAX_flt;
+	float HighestHeight  = -MAX_flt;
+
+	for (int32 Y = 0; Y < NumSamplesY; ++Y)
+	{
+		for (int32 X = 0; X < NumSamplesX; ++X)
+		{
+			FVector2D Location = Origin + FVector2D(X, Y) * CellSize;
+
+			FHitResult Hit;
+			if (!UTraceUtil::LineTrace(World, nullptr, FVector(Location, Bounds.Max.Z), FVector(Location, Bounds.Min.Z), Hit))
+			{
+				continue;
+			}
+
+			UPrimitiveComponent* HitComponent = Hit.GetComponent();
+			if (HitComponent == nullptr ||
+				HitComponent->Mobility != EComponentMobility::Static ||
+				Hit.ImpactNormal.Z < WalkableFloorZ)
+			{
+				continue;
+			}
+
+			int32 Index    = Y * Stride + X;
+			Heights[Index] = Hit.ImpactPoint.Z;
+			Normals[Index] = Hit.ImpactNormal;
+			LowestHeight   = FMath::Min(LowestHeight, Hit.ImpactPoint.Z);
+			HighestHeight  = FMath::Max(HighestHeight, Hit.ImpactPoint.Z);
+			++NumWalkableSamples;
+		}
+	}
+
+	Tiles.SetNum(NumTilesX * NumTilesY);
+	if (NumWalkableSamples == 0)
+	{
+		return;
+	}
+
+	MinHeight     = LowestHeight;
+	HeightQuantum = FMath::Max(MinBakedGroundHeightQuantum, (HighestHeight - LowestHeight) / (NoGround - 1));
+
+	for (int32 TileY = 0; TileY < NumTilesY; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < NumTilesX; ++TileX)
+		{
+			FIKBakedGroundTile& Tile = Tiles[TileY * NumTilesX + TileX];
+
+			for (int32 Y = 0; Y < TileSize; ++Y)
+			{
+				for (int32 X = 0; X < TileSize; ++X)
+				{
+					int32 Index = (TileY * TileSize + Y) * Stride + TileX * TileSize + X;
+					if (Heights[Index] == MAX_flt)
+					{
+						continue;
+					}
+
+					// Only allocate tiles which have walkable ground
+					if (Tile.Heights.Num() == 0)
+					{
+						Tile.Heights.Init(NoGround, TileSize * TileSize);
+						Tile.Normals.Init(0, TileSize * TileSize);
+					}
+
+					int8 NormalX = static_cast<int8>(FMath::Clamp(FMath::RoundToInt(Normals[Index].X * 127.0f), -127, 127));
+					int8 NormalY = static_cast<int8>(FMath::Clamp(FMath::RoundToInt(Normals[Index].Y * 127.0f), -127, 127));
+
+					int32 TileIndex         = Y * TileSize + X;
+					Tile.Heights[TileIndex] = static_cast<uint16>(FMath::Min(
+						FMath::RoundToInt((Heights[Index] - MinHeight) / HeightQuantum), NoGround - 1));
+					Tile.Normals[TileIndex] = static_cast<uint16>(static_cast<uint8>(NormalX)) |
+						(static_cast<uint16>(static_cast<uint8>(NormalY)) << 8);
+				}
+			}
+		}
+	}
+}
+
+#pragma endregion UIKBakedGroundData
+
+#pragma region AIKBakedGroundVolume
+
+AIKBakedGroundVolume::AIKBakedGroundVolume()
+	:
+	CellSize(25.0f),
+	WalkableFloorAngle(50.0f),
+	MaxInterpolationHeightDelta(5.0f),
+	GroundData(nullptr)
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	Bounds = CreateDefaultSubobject<UBoxComponent>(TEXT("Bounds"));
+	Bounds->SetBoxExtent(FVector(1000.0f, 1000.0f, 500.0f));
+	Bounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Bounds->SetCanEverAffectNavigation(false);
+	RootComponent = Bounds;
+}
+
+void AIKBakedGroundVolume::BakeGround()
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	// Baked data is outered to this actor, so it is saved and streamed with the level
+	Modify();
+	if (GroundData == nullptr)
+	{
+		GroundData = NewObject<UIKBakedGroundData>(this, NAME_None, RF_Transactional);
+	}
+	else
+	{
+		GroundData->Modify();
+	}
+
+	GroundData->Bake(World, Bounds->Bounds.GetBox(), CellSize, WalkableFloorAngle, MaxInterpolationHeightDelta);
+
+	UE_LOG(LogRTIK, Log, TEXT("Baked %d walkable ground samples for %s"), GroundData->NumWalkableSamples, *GetName());
+}
+
+void AIKBakedGroundVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GroundData != nullptr)
+	{
+		FIKBakedGroundProvider::Get(GetWorld())->AddData(GroundData);
+	}
+}
+
+void AIKBakedGroundVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (GroundData != nullptr)
+	{
+		FIKBakedGroundProvider::Get(GetWorld())->RemoveData(GroundData);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+#pragma endregion AIKBakedGroundVolume
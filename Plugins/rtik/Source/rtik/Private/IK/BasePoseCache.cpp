@@ -0,0 +1,71 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "BasePoseCache.h"
+#include "Animation/AnimInstanceProxy.h"
+
+DECLARE_CYCLE_STAT(TEXT("IK Base Pose Cache Evaluate"), STAT_IKBasePoseCache_Evaluate, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Base Pose Evaluations"), STAT_IKBasePoseCache_NumEvaluations, STATGROUP_Anim);
+
+bool FIKBasePoseCache::HasBones(const FBoneList& Bones) const
+{
+	for (const FCompactPoseBoneIndex& BoneIndex : Bones)
+	{
+		int32 Index = BoneIndex.GetInt();
+		if (!CachedBones.IsValidIndex(Index) || !CachedBones[Index])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FIKBasePoseCache::Evaluate(FComponentSpacePoseLink& BasePoseLink, FComponentSpacePoseContext& Output, const FBoneList& Bones)
+{
+	FAnimInstanceProxy* Proxy = Output.AnimInstanceProxy;
+
+	// Bone indices are only meaningful for the required bones they were made with
+	if (!CachedBonesCounter.IsSynchronizedWith(Proxy->GetCachedBonesCounter()))
+	{
+		CachedBonesCounter.SynchronizeWith(Proxy->GetCachedBonesCounter());
+		RequiredBones.Reset();
+		CachedBones.Init(false, CachedBones.Num());
+	}
+
+	bool bNewEvaluation = !EvaluationCounter.IsSynchronizedWith(Proxy->GetEvaluationCounter());
+	if (!bNewEvaluation && HasBones(Bones))
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_IKBasePoseCache_Evaluate);
+	INC_DWORD_STAT(STAT_IKBasePoseCache_NumEvaluations);
+
+	EvaluationCounter.SynchronizeWith(Proxy->GetEvaluationCounter());
+
+	for (const FCompactPoseBoneIndex& BoneIndex : Bones)
+	{
+		RequiredBones.AddUnique(BoneIndex);
+	}
+
+	FComponentSpacePoseContext BasePose(Output);
+	BasePoseLink.EvaluateComponentSpace(BasePose);
+
+	int32 NumBones = BasePose.Pose.GetPose().GetNumBones();
+	BoneCSTransforms.SetNum(NumBones);
+	if (bNewEvaluation || CachedBones.Num() != NumBones)
+	{
+		CachedBones.Init(false, NumBones);
+	}
+
+	for (const FCompactPoseBoneIndex& BoneIndex : RequiredBones)
+	{
+		int32 Index = BoneIndex.GetInt();
+		if (Index >= 0 && Index < NumBones)
+		{
+			BoneCSTransforms[Index] = BasePose.Pose.GetComponentSpaceTransform(BoneIndex);
+			CachedBones[Index]      = true;
+		}
+	}
+}
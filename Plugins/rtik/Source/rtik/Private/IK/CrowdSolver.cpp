@@ -0,0 +1,209 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "CrowdSolver.h"
+#include "RangeLimitedFABRIK.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/UObjectGlobals.h"
+
+DECLARE_CYCLE_STAT(TEXT("IK Crowd Solver Flush"), STAT_IKCrowdSolver_Flush, STATGROUP_Anim);
+DECLARE_CYCLE_STAT(TEXT("IK Crowd Solver Wait"), STAT_IKCrowdSolver_Wait, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Crowd Solves"), STAT_IKCrowdSolver_NumSolves, STATGROUP_Anim);
+
+const int32 FIKCrowdSolver::ChunkSize = 16;
+
+FCriticalSection FIKCrowdSolver::SolversLock;
+TMap<TWeakObjectPtr<UWorld>, TSharedRef<FIKCrowdSolver, ESPMode::ThreadSafe>> FIKCrowdSolver::Solvers;
+
+#pragma region FIKCrowdSolveSlot
+bool FIKCrowdSolveSlot::GetRecentResult(TArray<FTransform>& OutSourceCSTransforms, TArray<FTransform>& OutSolvedCSTransforms) const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (SolvedFrame == 0 || GFrameCounter - SolvedFrame > 1 || SolvedCSTransforms.Num() != SourceCSTransforms.Num())
+	{
+		return false;
+	}
+
+	OutSourceCSTransforms = SourceCSTransforms;
+	OutSolvedCSTransforms = SolvedCSTransforms;
+	return true;
+}
+
+void FIKCrowdSolveSlot::SetResult(TArray<FTransform>&& InSourceCSTransforms, 
+	TArray<FTransform>&& InSolvedCSTransforms, 
+	uint64 RequestFrame)
+{
+	FScopeLock ScopeLock(&Lock);
+	SourceCSTransforms = MoveTemp(InSourceCSTransforms);
+	SolvedCSTransforms = MoveTemp(InSolvedCSTransforms);
+	SolvedFrame        = RequestFrame;
+}
+#pragma endregion FIKCrowdSolveSlot
+
+#pragma region FIKCrowdSolver
+TSharedRef<FIKCrowdSolver, ESPMode::ThreadSafe> FIKCrowdSolver::Get(UWorld* World)
+{
+	FScopeLock ScopeLock(&SolversLock);
+
+	TSharedRef<FIKCrowdSolver, ESPMode::ThreadSafe>* Solver = Solvers.Find(World);
+	if (Solver == nullptr)
+	{
+		Solver = &Solvers.Add(World, MakeShared<FIKCrowdSolver, ESPMode::ThreadSafe>());
+	}
+
+	return *Solver;
+}
+
+void FIKCrowdSolver::RegisterDelegates()
+{
+	check(IsInGameThread());
+
+	FWorldDelegates::OnWorldPostActorTick.AddStatic(&FIKCrowdSolver::OnWorldPostActorTick);
+	FWorldDelegates::OnWorldCleanup.AddStatic(&FIKCrowdSolver::OnWorldCleanup);
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddStatic(&FIKCrowdSolver::OnPreGarbageCollect);
+}
+
+void FIKCrowdSolver::Enqueue(const TSharedRef<FIKCrowdSolveSlot, ESPMode::ThreadSafe>& Slot,
+	const TArray<FTransform>& CSTransforms,
+	const TArray<FIKBoneConstraint*>& Constraints,
+	const FVector& EffectorTargetCS,
+	float Precision,
+	int32 MaxIterations)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	// A node evaluated more than once this frame replaces its earlier request
+	if (Slot->PendingRequestIndex == INDEX_NONE)
+	{
+		Slot->PendingRequestIndex = PendingRequests.AddDefaulted();
+	}
+
+	FSolveRequest& Request   = PendingRequests[Slot->PendingRequestIndex];
+	Request.Slot             = Slot;
+	Request.CSTransforms     = CSTransforms;
+	Request.Constraints      = Constraints;
+	Request.EffectorTargetCS = EffectorTargetCS;
+	Request.Precision        = Precision;
+	Request.MaxIterations    = MaxIterations;
+}
+
+int32 FIKCrowdSolver::GetNumPendingRequests()
+{
+	FScopeLock ScopeLock(&Lock);
+	return PendingRequests.Num();
+}
+
+void FIKCrowdSolver::WaitForFlush()
+{
+	check(IsInGameThread());
+
+	if (FlushTask.IsValid())
+	{
+		SCOPE_CYCLE_COUNTER(STAT_IKCrowdSolver_Wait);
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(FlushTask, ENamedThreads::GameThread);
+		FlushTask = nullptr;
+	}
+}
+
+void FIKCrowdSolver::Flush()
+{
+	check(IsInGameThread());
+
+	// Normally long done; only one flush is in flight at a time
+	WaitForFlush();
+
+	TSharedRef<TArray<FSolveRequest>, ESPMode::ThreadSafe> Requests = MakeShared<TArray<FSolveRequest>, ESPMode::ThreadSafe>();
+	{
+		FScopeLock ScopeLock(&Lock);
+		Swap(*Requests, PendingRequests);
+
+		for (FSolveRequest& Request : *Requests)
+		{
+			Request.Slot->PendingRequestIndex = INDEX_NONE;
+		}
+	}
+
+	if (Requests->Num() == 0)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT_BY(STAT_IKCrowdSolver_NumSolves, Requests->Num());
+
+	const uint64 Frame = GFrameCounter;
+
+	FlushTask = FFunctionGraphTask::CreateAndDispatchWhenReady([Requests, Frame]()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_IKCrowdSolver_Flush);
+
+		int32 NumChunks = FMath::DivideAndRoundUp(Requests->Num(), ChunkSize);
+		ParallelFor(NumChunks, [&Requests, Frame](int32 ChunkIndex)
+		{
+			int32 Begin = ChunkIndex * ChunkSize;
+			int32 End   = FMath::Min(Begin + ChunkSize, Requests->Num());
+
+			for (int32 i = Begin; i < End; ++i)
+			{
+				FSolveRequest& Request = (*Requests)[i];
+
+				TArray<FTransform> SolvedCSTransforms;
+				FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
+					Request.CSTransforms,
+					Request.Constraints,
+					Request.EffectorTargetCS,
+					SolvedCSTransforms,
+					0.0f,
+					1.0f,
+					Request.Precision,
+					Request.MaxIterations
+				);
+
+				Request.Slot->SetResult(MoveTemp(Request.CSTransforms), MoveTemp(SolvedCSTransforms), Frame);
+			}
+		}, NumChunks < 2);
+	}, TStatId(), nullptr, ENamedThreads::AnyThread);
+}
+
+void FIKCrowdSolver::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	TSharedPtr<FIKCrowdSolver, ESPMode::ThreadSafe> Solver;
+	{
+		FScopeLock ScopeLock(&SolversLock);
+		TSharedRef<FIKCrowdSolver, ESPMode::ThreadSafe>* Found = Solvers.Find(World);
+		if (Found != nullptr)
+		{
+			Solver = *Found;
+		}
+	}
+
+	if (Solver.IsValid())
+	{
+		Solver->Flush();
+	}
+}
+
+void FIKCrowdSolver::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	FScopeLock ScopeLock(&SolversLock);
+
+	TSharedRef<FIKCrowdSolver, ESPMode::ThreadSafe>* Solver = Solvers.Find(World);
+	if (Solver != nullptr)
+	{
+		(*Solver)->WaitForFlush();
+		Solvers.Remove(World);
+	}
+}
+
+void FIKCrowdSolver::OnPreGarbageCollect()
+{
+	// Flush tasks read constraints owned by UObjects
+	FScopeLock ScopeLock(&SolversLock);
+	for (auto& Pair : Solvers)
+	{
+		Pair.Value->WaitForFlush();
+	}
+}
+#pragma endregion FIKCrowdSolver
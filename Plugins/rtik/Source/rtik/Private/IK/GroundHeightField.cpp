@@ -0,0 +1,335 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "GroundHeightField.h"
+#include "Utility/TraceUtil.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+DECLARE_CYCLE_STAT(TEXT("IK Ground Height Field Update"), STAT_IKGroundHeightField_Update, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Height Field Traces"), STAT_IKGroundHeightField_NumTraces, STATGROUP_Anim);
+
+static const FName HeightFieldOverlapTag(TEXT("IKGroundHeightFieldOverlap"));
+
+// Incremented whenever a level is added or removed; height fields discard their samples when this changes
+static FThreadSafeCounter GLevelGeneration;
+
+static void OnLevelsChanged(ULevel* Level, UWorld* World)
+{
+	GLevelGeneration.Increment();
+}
+
+#pragma region FIKGroundHeightField
+
+FIKGroundHeightField::FIKGroundHeightField()
+	:
+	GridSize(0),
+	CellSize(0.0f),
+	CenterKey(0, 0),
+	CenterHeight(0.0f),
+	CachedTraceHalfHeight(0.0f),
+	LastUpdateFrame(0),
+	LevelGeneration(0),
+	bTraceComplex(true),
+	bReturnPhysicalMaterial(false),
+	bReturnFaceIndex(false)
+{ }
+
+void FIKGroundHeightField::RegisterLevelDelegates()
+{
+	check(IsInGameThread());
+
+	static bool bRegistered = false;
+	if (!bRegistered)
+	{
+		FWorldDelegates::LevelAddedToWorld.AddStatic(&OnLevelsChanged);
+		FWorldDelegates::LevelRemovedFromWorld.AddStatic(&OnLevelsChanged);
+		bRegistered = true;
+	}
+}
+
+void FIKGroundHeightField::Reset(const FIKGroundHeightFieldSettings& Settings)
+{
+	GridSize = Settings.GridSize;
+	CellSize = Settings.CellSize;
+
+	Cells.SetNumZeroed(GridSize * GridSize);
+	Invalidate();
+
+	// Fill order covers the whole grid around the center cell, nearest first
+	int32 HalfSize = GridSize / 2;
+	FillOrder.Empty(GridSize * GridSize);
+	for (int32 Y = -HalfSize; Y < GridSize - HalfSize; ++Y)
+	{
+		for (int32 X = -HalfSize; X < GridSize - HalfSize; ++X)
+		{
+			FillOrder.Add(FIntPoint(X, Y));
+		}
+	}
+
+	FillOrder.Sort([](const FIntPoint& A, const FIntPoint& B) {
+		return A.SizeSquared() < B.SizeSquared();
+	});
+}
+
+void FIKGroundHeightField::Invalidate()
+{
+	for (FCell& Cell : Cells)
+	{
+		Cell.bTraced = false;
+		Cell.bUsable = false;
+	}
+
+	PendingTraces.Reset();
+}
+
+int32 FIKGroundHeightField::GetCellIndex(const FIntPoint& Key) const
+{
+	int32 X = Key.X % GridSize;
+	int32 Y = Key.Y % GridSize;
+	X = X < 0 ? X + GridSize : X;
+	Y = Y < 0 ? Y + GridSize : Y;
+	return Y * GridSize + X;
+}
+
+const FIKGroundHeightField::FCell* FIKGroundHeightField::FindCell(const FIntPoint& Key) const
+{
+	if (GridSize == 0)
+	{
+		return nullptr;
+	}
+
+	const FCell& Cell = Cells[GetCellIndex(Key)];
+	return (Cell.bTraced && Cell.Key == Key) ? &Cell : nullptr;
+}
+
+bool FIKGroundHeightField::IsInGrid(const FIntPoint& Key) const
+{
+	int32 HalfSize   = GridSize / 2;
+	FIntPoint Offset = Key - CenterKey;
+	return Offset.X >= -HalfSize && Offset.X < GridSize - HalfSize &&
+		Offset.Y >= -HalfSize && Offset.Y < GridSize - HalfSize;
+}
+
+void FIKGroundHeightField::CollectTraces(UWorld* World)
+{
+	for (const FPendingTrace& Pending : PendingTraces)
+	{
+		// Results are dropped if the grid has since moved off the cell, or the anim instance skipped a frame
+		FHitResult Hit;
+		if (!IsInGrid(Pending.Key) || !UTraceUtil::QueryAsyncLineTrace(World, Pending.Handle, Hit))
+		{
+			continue;
+		}
+
+		bool bHit                         = Hit.bBlockingHit;
+		UPrimitiveComponent* HitComponent = Hit.GetComponent();
+		FCell& Cell                       = Cells[GetCellIndex(Pending.Key)];
+
+		Cell.Key          = Pending.Key;
+		Cell.TraceFrame   = GFrameCounter;
+		Cell.bTraced      = true;
+		Cell.bUsable      = bHit && (HitComponent == nullptr || HitComponent->Mobility != EComponentMobility::Movable);
+		Cell.Height       = Hit.ImpactPoint.Z;
+		Cell.Normal       = Hit.ImpactNormal;
+		Cell.Actor        = Hit.Actor;
+		Cell.Component    = Hit.Component;
+		Cell.PhysMaterial = Hit.PhysMaterial;
+		Cell.FaceIndex    = Hit.FaceIndex;
+	}
+
+	PendingTraces.Reset();
+}
+
+void FIKGroundHeightField::CollectMovableOverlaps(UWorld* World, AActor* ActorToIgnore)
+{
+	// Overlap results only live for one frame; if they were missed, the last bounds are kept for another frame
+	FOverlapDatum OverlapData;
+	if (MovableOverlapHandle.IsValid() && World->QueryOverlapData(MovableOverlapHandle, OverlapData))
+	{
+		MovableBoundsWS.Reset();
+		for (const FOverlapResult& Overlap : OverlapData.OutOverlaps)
+		{
+			UPrimitiveComponent* Component = Overlap.GetComponent();
+			if (Component != nullptr && Component->Mobility == EComponentMobility::Movable)
+			{
+				MovableBoundsWS.Add(Component->Bounds.GetBox().ExpandBy(CellSize));
+			}
+		}
+	}
+
+	// Look for movable components anywhere in the volume the samples are traced through
+	FVector HalfExtent(GridSize * CellSize * 0.5f, GridSize * CellSize * 0.5f, CachedTraceHalfHeight);
+	FVector CenterWS(CenterKey.X * CellSize, CenterKey.Y * CellSize, CenterHeight);
+
+	FCollisionQueryParams Params = UTraceUtil::MakeQueryParams(HeightFieldOverlapTag, ActorToIgnore, false, false, false);
+	MovableOverlapHandle         = World->AsyncOverlapByChannel(CenterWS, FQuat::Identity, ECC_Pawn,
+		FCollisionShape::MakeBox(HalfExtent), Params);
+}
+
+void FIKGroundHeightField::Update(UWorld* World,
+	AActor* ActorToIgnore,
+	const FVector& CenterWS,
+	const FIKGroundHeightFieldSettings& Settings,
+	const FIKGroundQueryQuality& Quality)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKGroundHeightField_Update);
+	check(IsInGameThread());
+
+	if (World == nullptr || LastUpdateFrame == GFrameCounter)
+	{
+		return;
+	}
+	LastUpdateFrame = GFrameCounter;
+
+	if (GridSize != Settings.GridSize || CellSize != Settings.CellSize)
+	{
+		Reset(Settings);
+	}
+
+	int32 CurrentLevelGeneration = GLevelGeneration.GetValue();
+	bool bQualityChanged         = bTraceComplex != Quality.bTraceComplex ||
+		bReturnPhysicalMaterial != Quality.bReturnPhysicalMaterial ||
+		bReturnFaceIndex != Quality.bReturnFaceIndex;
+
+	if (LevelGeneration != CurrentLevelGeneration || bQualityChanged)
+	{
+		Invalidate();
+		LevelGeneration         = CurrentLevelGeneration;
+		bTraceComplex           = Quality.bTraceComplex;
+		bReturnPhysicalMaterial = Quality.bReturnPhysicalMaterial;
+		bReturnFaceIndex        = Quality.bReturnFaceIndex;
+	}
+
+	CenterKey             = FIntPoint(FMath::FloorToInt(CenterWS.X / CellSize), FMath::FloorToInt(CenterWS.Y / CellSize));
+	CenterHeight          = CenterWS.Z;
+	CachedTraceHalfHeight = Settings.TraceHalfHeight;
+
+	CollectTraces(World);
+	CollectMovableOverlaps(World, ActorToIgnore);
+
+	for (const FIntPoint& Offset : FillOrder)
+	{
+		if (PendingTraces.Num() >= Settings.TracesPerFrame)
+		{
+			break;
+		}
+
+		FIntPoint Key = CenterKey + Offset;
+		FCell& Cell   = Cells[GetCellIndex(Key)];
+
+		// Also retrace if the character has moved far enough vertically that the old trace may not cover the ground
+		bool bFresh = Cell.bTraced &&
+			Cell.Key == Key &&
+			GFrameCounter - Cell.TraceFrame < static_cast<uint64>(Settings.MaxCellAgeFrames) &&
+			(!Cell.bUsable || FMath::Abs(Cell.Height - CenterHeight) < Settings.TraceHalfHeight);
+
+		if (bFresh)
+		{
+			continue;
+		}
+
+		FVector SampleLocation(Key.X * CellSize, Key.Y * CellSize, CenterHeight);
+		FPendingTrace Pending;
+		Pending.Key    = Key;
+		Pending.Handle = UTraceUtil::AsyncLineTrace(World,
+			ActorToIgnore,
+			SampleLocation + FVector(0.0f, 0.0f, Settings.TraceHalfHeight),
+			SampleLocation - FVector(0.0f, 0.0f, Settings.TraceHalfHeight),
+			ECC_Pawn,
+			Quality.bReturnPhysicalMaterial,
+			Quality.bTraceComplex,
+			Quality.bReturnFaceIndex);
+		PendingTraces.Add(Pending);
+	}
+
+	INC_DWORD_STAT_BY(STAT_IKGroundHeightField_NumTraces, PendingTraces.Num());
+}
+
+bool FIKGroundHeightField::SampleHeight(const FVector2D& LocationWS, float& OutHeight, FVector& OutNormal) const
+{
+	if (GridSize == 0)
+	{
+		return false;
+	}
+
+	// Movable components may have moved over the samples since they were traced
+	for (const FBox& Bounds : MovableBoundsWS)
+	{
+		if (LocationWS.X >= Bounds.Min.X && LocationWS.X <= Bounds.Max.X &&
+			LocationWS.Y >= Bounds.Min.Y && LocationWS.Y <= Bounds.Max.Y)
+		{
+			return false;
+		}
+	}
+
+	float GridX = LocationWS.X / CellSize;
+	float GridY = LocationWS.Y / CellSize;
+	FIntPoint Key00(FMath::FloorToInt(GridX), FMath::FloorToInt(GridY));
+	float Alpha = GridX - Key00.X;
+	float Beta  = GridY - Key00.Y;
+
+	const FCell* Cell00 = FindCell(Key00);
+	const FCell* Cell10 = FindCell(Key00 + FIntPoint(1, 0));
+	const FCell* Cell01 = FindCell(Key00 + FIntPoint(0, 1));
+	const FCell* Cell11 = FindCell(Key00 + FIntPoint(1, 1));
+
+	if (Cell00 == nullptr || Cell10 == nullptr || Cell01 == nullptr || Cell11 == nullptr ||
+		!Cell00->bUsable || !Cell10->bUsable || !Cell01->bUsable || !Cell11->bUsable)
+	{
+		return false;
+	}
+
+	OutHeight = FMath::BiLerp(Cell00->Height, Cell10->Height, Cell01->Height, Cell11->Height, Alpha, Beta);
+	OutNormal = FMath::BiLerp(Cell00->Normal, Cell10->Normal, Cell01->Normal, Cell11->Normal, Alpha, Beta).GetSafeNormal();
+	return true;
+}
+
+bool FIKGroundHeightField::GetHit(const FVector& Start, const FVector& End, FHitResult& OutHit) const
+{
+	FVector TraceVec  = End - Start;
+	float TraceLength = TraceVec.Size();
+
+	// The grid only stores heights along world Z
+	if (TraceLength < KINDA_SMALL_NUMBER || TraceVec.Z > -TraceLength * (1.0f - KINDA_SMALL_NUMBER))
+	{
+		return false;
+	}
+
+	float Height;
+	FVector Normal;
+	if (!SampleHeight(FVector2D(Start), Height, Normal) || Height > Start.Z || Height < End.Z)
+	{
+		return false;
+	}
+
+	// Report the hit object of the nearest sample
+	FIntPoint NearestKey(FMath::RoundToInt(Start.X / CellSize), FMath::RoundToInt(Start.Y / CellSize));
+	const FCell* NearestCell = FindCell(NearestKey);
+	if (NearestCell == nullptr)
+	{
+		return false;
+	}
+
+	FVector ImpactPoint(Start.X, Start.Y, Height);
+
+	OutHit                   = FHitResult(ForceInit);
+	OutHit.bBlockingHit      = true;
+	OutHit.ImpactPoint       = ImpactPoint;
+	OutHit.Location          = ImpactPoint;
+	OutHit.ImpactNormal      = Normal;
+	OutHit.Normal            = Normal;
+	OutHit.TraceStart        = Start;
+	OutHit.TraceEnd          = End;
+	OutHit.Distance          = Start.Z - Height;
+	OutHit.Time              = OutHit.Distance / TraceLength;
+	OutHit.Actor             = NearestCell->Actor;
+	OutHit.Component         = NearestCell->Component;
+	OutHit.PhysMaterial      = NearestCell->PhysMaterial;
+	OutHit.FaceIndex         = NearestCell->FaceIndex;
+	return true;
+}
+
+#pragma endregion FIKGroundHeightField
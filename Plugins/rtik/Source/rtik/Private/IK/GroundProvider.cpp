@@ -0,0 +1,451 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "GroundProvider.h"
+#include "BakedGround.h"
+#include "LandscapeHeightfieldCollisionComponent.h"
+#include "Engine/World.h"
+#include "Misc/ScopeLock.h"
+
+DECLARE_CYCLE_STAT(TEXT("IK Landscape Ground Provider Bake"), STAT_IKLandscapeGroundProvider_Bake, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Landscape Ground Provider Hits"), STAT_IKLandscapeGroundProvider_Hits, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Landscape Ground Provider Misses"), STAT_IKLandscapeGroundProvider_Misses, STATGROUP_Anim);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Baked Ground Provider Hits"), STAT_IKBakedGroundProvider_Hits, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Baked Ground Provider Misses"), STAT_IKBakedGroundProvider_Misses, STATGROUP_Anim);
+
+// Fills in a hit for a vertical trace from Start to End, which found the ground at Height
+static void MakeProviderHit(const FVector& Start, const FVector& End, float Height, const FVector& Normal, FHitResult& OutHit)
+{
+	FVector ImpactPoint(Start.X, Start.Y, Height);
+
+	OutHit              = FHitResult(ForceInit);
+	OutHit.bBlockingHit = true;
+	OutHit.ImpactPoint  = ImpactPoint;
+	OutHit.Location     = ImpactPoint;
+	OutHit.ImpactNormal = Normal;
+	OutHit.Normal       = Normal;
+	OutHit.TraceStart   = Start;
+	OutHit.TraceEnd     = End;
+	OutHit.Distance     = Start.Z - Height;
+	OutHit.Time         = OutHit.Distance / (End - Start).Size();
+}
+
+// Grids and baked data store heights along world Z, so only vertical, downward traces can be answered
+static bool IsVerticalDownwardTrace(const FVector& Start, const FVector& End)
+{
+	FVector TraceVec  = End - Start;
+	float TraceLength = TraceVec.Size();
+	return TraceLength > KINDA_SMALL_NUMBER && TraceVec.Z <= -TraceLength * (1.0f - KINDA_SMALL_NUMBER);
+}
+
+#pragma region FIKGroundProviderList
+
+bool FIKGroundProviderList::FindGround(const FVector& Start, const FVector& End, FHitResult& OutHit)
+{
+	for (FIKGroundProvider* Provider : Providers)
+	{
+		if (Provider->FindGround(Start, End, OutHit))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FIKGroundProviderList::OnPhysicsTrace(const FHitResult& Hit)
+{
+	for (FIKGroundProvider* Provider : Providers)
+	{
+		Provider->OnPhysicsTrace(Hit);
+	}
+}
+
+#pragma endregion FIKGroundProviderList
+
+#pragma region FIKLandscapeGroundProvider
+
+// Marks a grid sample where the landscape has a hole, or isn't the first surface hit
+static const float LandscapeGridHole = MAX_flt;
+
+// Landscape bake traces done per world per frame
+static const int32 LandscapeBakeTracesPerFrame = 256;
+
+const float FIKLandscapeGroundProvider::HashCellSize = 1000.0f;
+
+FCriticalSection FIKLandscapeGroundProvider::ProvidersLock;
+TMap<TWeakObjectPtr<UWorld>, TSharedRef<FIKLandscapeGroundProvider, ESPMode::ThreadSafe>> FIKLandscapeGroundProvider::Providers;
+
+TSharedRef<FIKLandscapeGroundProvider, ESPMode::ThreadSafe> FIKLandscapeGroundProvider::Get(UWorld* World)
+{
+	FScopeLock ScopeLock(&ProvidersLock);
+
+	TSharedRef<FIKLandscapeGroundProvider, ESPMode::ThreadSafe>* Provider = Providers.Find(World);
+	if (Provider == nullptr)
+	{
+		Provider = &Providers.Add(World, MakeShared<FIKLandscapeGroundProvider, ESPMode::ThreadSafe>());
+	}
+
+	return *Provider;
+}
+
+void FIKLandscapeGroundProvider::RegisterDelegates()
+{
+	check(IsInGameThread());
+
+	FWorldDelegates::LevelRemovedFromWorld.AddStatic(&FIKLandscapeGroundProvider::OnLevelRemoved);
+	FWorldDelegates::OnWorldPostActorTick.AddStatic(&FIKLandscapeGroundProvider::OnWorldPostActorTick);
+	FWorldDelegates::OnWorldCleanup.AddStatic(&FIKLandscapeGroundProvider::OnWorldCleanup);
+}
+
+void FIKLandscapeGroundProvider::OnLevelRemoved(ULevel* Level, UWorld* World)
+{
+	FScopeLock ScopeLock(&ProvidersLock);
+
+	TSharedRef<FIKLandscapeGroundProvider, ESPMode::ThreadSafe>* Provider = Providers.Find(World);
+	if (Provider != nullptr)
+	{
+		(*Provider)->Empty();
+	}
+}
+
+void FIKLandscapeGroundProvider::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	TSharedPtr<FIKLandscapeGroundProvider, ESPMode::ThreadSafe> Provider;
+	{
+		FScopeLock ScopeLock(&ProvidersLock);
+		TSharedRef<FIKLandscapeGroundProvider, ESPMode::ThreadSafe>* Found = Providers.Find(World);
+		if (Found != nullptr)
+		{
+			Provider = *Found;
+		}
+	}
+
+	if (Provider.IsValid())
+	{
+		Provider->TickBake(World);
+	}
+}
+
+void FIKLandscapeGroundProvider::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	FScopeLock ScopeLock(&ProvidersLock);
+	Providers.Remove(World);
+}
+
+void FIKLandscapeGroundProvider::Empty()
+{
+	check(IsInGameThread());
+
+	FScopeLock ScopeLock(&Lock);
+	Grids.Empty();
+	GridsPerHashCell.Empty();
+	KnownComponents.Empty();
+	BakeQueue.Empty();
+	BakingGrid.Reset();
+}
+
+FIntPoint FIKLandscapeGroundProvider::GetHashKey(const FVector& Location)
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / HashCellSize), FMath::FloorToInt(Location.Y / HashCellSize));
+}
+
+bool FIKLandscapeGroundProvider::FindGround(const FVector& Start, const FVector& End, FHitResult& OutHit)
+{
+	if (!IsVerticalDownwardTrace(Start, End))
+	{
+		return false;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+
+	const TArray<int32>* GridIndices = GridsPerHashCell.Find(GetHashKey(Start));
+	if (GridIndices != nullptr)
+	{
+		for (int32 GridIndex : *GridIndices)
+		{
+			const FHeightGrid& Grid = *Grids[GridIndex];
+
+			float Height;
+			FVector Normal;
+			if (!Grid.Sample(Start, Height, Normal) || Height > Start.Z || Height < End.Z)
+			{
+				continue;
+			}
+
+			MakeProviderHit(Start, End, Height, Normal, OutHit);
+			OutHit.Actor     = Grid.Actor;
+			OutHit.Component = Grid.Component;
+
+			INC_DWORD_STAT(STAT_IKLandscapeGroundProvider_Hits);
+			return true;
+		}
+	}
+
+	INC_DWORD_STAT(STAT_IKLandscapeGroundProvider_Misses);
+	return false;
+}
+
+void FIKLandscapeGroundProvider::OnPhysicsTrace(const FHitResult& Hit)
+{
+	ULandscapeHeightfieldCollisionComponent* Component = Cast<ULandscapeHeightfieldCollisionComponent>(Hit.GetComponent());
+	if (Component == nullptr)
+	{
+		return;
+	}
+
+	// May be called during evaluation; the bake itself is left to the game thread
+	FScopeLock ScopeLock(&Lock);
+	if (!KnownComponents.Contains(Component))
+	{
+		KnownComponents.Add(Component);
+		BakeQueue.Add(Component);
+	}
+}
+
+void FIKLandscapeGroundProvider::TickBake(UWorld* World)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKLandscapeGroundProvider_Bake);
+	check(IsInGameThread());
+
+	int32 TraceBudget = LandscapeBakeTracesPerFrame;
+	while (TraceBudget > 0)
+	{
+		if (!BakingGrid.IsValid())
+		{
+			ULandscapeHeightfieldCollisionComponent* NextComponent = nullptr;
+			{
+				FScopeLock ScopeLock(&Lock);
+				while (NextComponent == nullptr && BakeQueue.Num() > 0)
+				{
+					NextComponent = BakeQueue[0].Get();
+					BakeQueue.RemoveAt(0, 1, false);
+				}
+			}
+
+			if (NextComponent == nullptr)
+			{
+				return;
+			}
+
+			BakingGrid = BeginBake(NextComponent);
+			continue;
+		}
+
+		// Component may have been destroyed while baking
+		ULandscapeHeightfieldCollisionComponent* Component = BakingGrid->Component.Get();
+		if (Component == nullptr)
+		{
+			BakingGrid.Reset();
+			continue;
+		}
+
+		if (!ContinueBake(World, Component, *BakingGrid, TraceBudget))
+		{
+			return;
+		}
+
+		FHeightGridPtr Grid = BakingGrid;
+		BakingGrid.Reset();
+
+		FBox Bounds      = Component->Bounds.GetBox();
+		FIntPoint MinKey = GetHashKey(Bounds.Min);
+		FIntPoint MaxKey = GetHashKey(Bounds.Max);
+
+		FScopeLock ScopeLock(&Lock);
+		int32 GridIndex = Grids.Add(Grid);
+		for (int32 Y = MinKey.Y; Y <= MaxKey.Y; ++Y)
+		{
+			for (int32 X = MinKey.X; X <= MaxKey.X; ++X)
+			{
+				GridsPerHashCell.FindOrAdd(FIntPoint(X, Y)).Add(GridIndex);
+			}
+		}
+	}
+}
+
+FIKLandscapeGroundProvider::FHeightGridPtr FIKLandscapeGroundProvider::BeginBake(ULandscapeHeightfieldCollisionComponent* Component)
+{
+	const FTransform& ComponentToWorld = Component->GetComponentTransform();
+
+	// Heights are stored along world Z
+	if (ComponentToWorld.GetUnitAxis(EAxis::Z).Z < 1.0f - KINDA_SMALL_NUMBER)
+	{
+#if ENABLE_IK_DEBUG
+		UE_LOG(LogRTIK, Warning, TEXT("Landscape ground provider can't use pitched or rolled landscape component %s"), *Component->GetName());
+#endif // ENABLE_IK_DEBUG
+		return nullptr;
+	}
+
+	FHeightGridPtr Grid        = MakeShared<FHeightGrid, ESPMode::ThreadSafe>();
+	Grid->Component            = Component;
+	Grid->Actor                = Component->GetOwner();
+	Grid->ComponentToWorld     = ComponentToWorld;
+	Grid->NumVertsPerSide      = Component->CollisionSizeQuads + 1;
+	Grid->VertexSpacing        = Component->CollisionScale;
+	Grid->Heights.Reserve(Grid->NumVertsPerSide * Grid->NumVertsPerSide);
+
+	return Grid;
+}
+
+bool FIKLandscapeGroundProvider::ContinueBake(UWorld* World,
+	ULandscapeHeightfieldCollisionComponent* Component,
+	FHeightGrid& Grid,
+	int32& InOutTraceBudget)
+{
+	FBox Bounds    = Component->Bounds.GetBox();
+	float TraceTop = Bounds.Max.Z + 100.0f;
+	float TraceEnd = Bounds.Min.Z - 100.0f;
+
+	// Characters aren't in these channels, so they don't hide the landscape from the bake
+	static const FName LandscapeBakeTag(TEXT("IK Landscape Bake"));
+	FCollisionQueryParams TraceParams(LandscapeBakeTag, true);
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+
+	int32 NumVerts = Grid.NumVertsPerSide * Grid.NumVertsPerSide;
+	while (Grid.Heights.Num() < NumVerts && InOutTraceBudget > 0)
+	{
+		int32 I = Grid.Heights.Num() % Grid.NumVertsPerSide;
+		int32 J = Grid.Heights.Num() / Grid.NumVertsPerSide;
+		FVector VertexWS = Grid.ComponentToWorld.TransformPosition(
+			FVector(I * Grid.VertexSpacing, J * Grid.VertexSpacing, 0.0f));
+
+		FHitResult Hit;
+		bool bHit = World->LineTraceSingleByObjectType(Hit,
+			FVector(VertexWS.X, VertexWS.Y, TraceTop),
+			FVector(VertexWS.X, VertexWS.Y, TraceEnd),
+			ObjectParams,
+			TraceParams);
+		--InOutTraceBudget;
+
+		// Only keep samples where the landscape is the first surface hit
+		bool bLandscapeFirst = bHit && Hit.GetComponent() == Component;
+		Grid.Heights.Add(bLandscapeFirst ? Hit.ImpactPoint.Z : LandscapeGridHole);
+	}
+
+	return Grid.Heights.Num() == NumVerts;
+}
+
+bool FIKLandscapeGroundProvider::FHeightGrid::Sample(const FVector& LocationWS, float& OutHeight, FVector& OutNormal) const
+{
+	FVector LocationLocal = ComponentToWorld.InverseTransformPosition(LocationWS);
+	float U = LocationLocal.X / VertexSpacing;
+	float V = LocationLocal.Y / VertexSpacing;
+	int32 I = FMath::FloorToInt(U);
+	int32 J = FMath::FloorToInt(V);
+
+	if (I < 0 || J < 0 || I >= NumVertsPerSide - 1 || J >= NumVertsPerSide - 1)
+	{
+		return false;
+	}
+
+	float H00 = Heights[J * NumVertsPerSide + I];
+	float H10 = Heights[J * NumVertsPerSide + I + 1];
+	float H01 = Heights[(J + 1) * NumVertsPerSide + I];
+	float H11 = Heights[(J + 1) * NumVertsPerSide + I + 1];
+
+	if (H00 == LandscapeGridHole || H10 == LandscapeGridHole ||
+		H01 == LandscapeGridHole || H11 == LandscapeGridHole)
+	{
+		return false;
+	}
+
+	OutHeight = FMath::BiLerp(H00, H10, H01, H11, U - I, V - J);
+
+	// Normal of the quad, from the world-space corner positions
+	FVector P00 = ComponentToWorld.TransformPosition(FVector(I * VertexSpacing, J * VertexSpacing, 0.0f));
+	FVector P10 = ComponentToWorld.TransformPosition(FVector((I + 1) * VertexSpacing, J * VertexSpacing, 0.0f));
+	FVector P01 = ComponentToWorld.TransformPosition(FVector(I * VertexSpacing, (J + 1) * VertexSpacing, 0.0f));
+	FVector P11 = ComponentToWorld.TransformPosition(FVector((I + 1) * VertexSpacing, (J + 1) * VertexSpacing, 0.0f));
+	P00.Z = H00;
+	P10.Z = H10;
+	P01.Z = H01;
+	P11.Z = H11;
+
+	FVector AlongU = (P10 - P00) + (P11 - P01);
+	FVector AlongV = (P01 - P00) + (P11 - P10);
+	OutNormal      = FVector::CrossProduct(AlongU, AlongV).GetSafeNormal();
+	if (OutNormal.Z < 0.0f)
+	{
+		OutNormal *= -1.0f;
+	}
+
+	return true;
+}
+
+#pragma endregion FIKLandscapeGroundProvider
+
+#pragma region FIKBakedGroundProvider
+
+FCriticalSection FIKBakedGroundProvider::ProvidersLock;
+TMap<TWeakObjectPtr<UWorld>, TSharedRef<FIKBakedGroundProvider, ESPMode::ThreadSafe>> FIKBakedGroundProvider::Providers;
+
+TSharedRef<FIKBakedGroundProvider, ESPMode::ThreadSafe> FIKBakedGroundProvider::Get(UWorld* World)
+{
+	FScopeLock ScopeLock(&ProvidersLock);
+
+	TSharedRef<FIKBakedGroundProvider, ESPMode::ThreadSafe>* Provider = Providers.Find(World);
+	if (Provider == nullptr)
+	{
+		Provider = &Providers.Add(World, MakeShared<FIKBakedGroundProvider, ESPMode::ThreadSafe>());
+	}
+
+	return *Provider;
+}
+
+void FIKBakedGroundProvider::RegisterDelegates()
+{
+	check(IsInGameThread());
+
+	FWorldDelegates::OnWorldCleanup.AddStatic(&FIKBakedGroundProvider::OnWorldCleanup);
+}
+
+void FIKBakedGroundProvider::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	FScopeLock ScopeLock(&ProvidersLock);
+	Providers.Remove(World);
+}
+
+void FIKBakedGroundProvider::AddData(const UIKBakedGroundData* InData)
+{
+	FScopeLock ScopeLock(&Lock);
+	Data.AddUnique(InData);
+}
+
+void FIKBakedGroundProvider::RemoveData(const UIKBakedGroundData* InData)
+{
+	FScopeLock ScopeLock(&Lock);
+	Data.Remove(InData);
+}
+
+bool FIKBakedGroundProvider::FindGround(const FVector& Start, const FVector& End, FHitResult& OutHit)
+{
+	if (!IsVerticalDownwardTrace(Start, End))
+	{
+		return false;
+	}
+
+	// Hold the lock while sampling, so data can't be removed out from under us
+	FScopeLock ScopeLock(&Lock);
+
+	for (const UIKBakedGroundData* GroundData : Data)
+	{
+		float Height;
+		FVector Normal;
+		if (GroundData->Sample(FVector2D(Start), Height, Normal) && Height <= Start.Z && Height >= End.Z)
+		{
+			MakeProviderHit(Start, End, Height, Normal, OutHit);
+			OutHit.Actor = Cast<AActor>(GroundData->GetOuter());
+			INC_DWORD_STAT(STAT_IKBakedGroundProvider_Hits);
+			return true;
+		}
+	}
+
+	INC_DWORD_STAT(STAT_IKBakedGroundProvider_Misses);
+	return false;
+}
+
+#pragma endregion FIKBakedGroundProvider
@@ -0,0 +1,168 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "GroundQueryService.h"
+#include "Utility/TraceUtil.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("IK Ground Query Service Flush"), STAT_IKGroundQueryService_Flush, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Queries Submitted"), STAT_IKGroundQueryService_NumQueries, STATGROUP_Anim);
+
+// Bits of FGroundQuery::QualityFlags
+static const uint8 GroundQueryTraceComplex    = 1 << 0;
+static const uint8 GroundQueryReturnPhysMat   = 1 << 1;
+static const uint8 GroundQueryReturnFaceIndex = 1 << 2;
+
+TMap<TWeakObjectPtr<UWorld>, TUniquePtr<FIKGroundQueryService>> FIKGroundQueryService::Services;
+
+FIKGroundQueryService& FIKGroundQueryService::Get(UWorld* World)
+{
+	check(IsInGameThread());
+	check(World != nullptr);
+
+	TUniquePtr<FIKGroundQueryService>* Service = Services.Find(World);
+	if (Service == nullptr)
+	{
+		Service = &Services.Add(World, TUniquePtr<FIKGroundQueryService>(new FIKGroundQueryService(World)));
+	}
+
+	return **Service;
+}
+
+void FIKGroundQueryService::RegisterDelegates()
+{
+	check(IsInGameThread());
+
+	FWorldDelegates::OnWorldPostActorTick.AddStatic(&FIKGroundQueryService::OnWorldPostActorTick);
+	FWorldDelegates::OnWorldCleanup.AddStatic(&FIKGroundQueryService::OnWorldCleanup);
+}
+
+FIKGroundQueryService::FIKGroundQueryService(UWorld* InWorld)
+	:
+	World(InWorld)
+{
+	TraceDelegate.BindRaw(this, &FIKGroundQueryService::OnTraceCompleted);
+}
+
+FIKGroundQueryService::~FIKGroundQueryService()
+{
+	TraceDelegate.Unbind();
+}
+
+void FIKGroundQueryService::RequestLegTrace(AActor* ActorToIgnore,
+	UHumanoidIKTraceData_Wrapper* TraceData,
+	const FHumanoidLegTraceEndpoints& EndpointsWS,
+	const FIKGroundQueryQuality& Quality,
+	ECollisionChannel CollisionChannel)
+{
+	check(IsInGameThread());
+
+	if (TraceData == nullptr)
+	{
+		return;
+	}
+
+	FGroundQuery FootQuery;
+	FootQuery.TraceData        = TraceData;
+	FootQuery.ActorToIgnore    = ActorToIgnore;
+	FootQuery.Start            = EndpointsWS.FootTraceStart;
+	FootQuery.End              = EndpointsWS.FootTraceEnd;
+	FootQuery.CollisionChannel = CollisionChannel;
+	FootQuery.QualityFlags     = GetQualityFlags(Quality);
+	FootQuery.bToeTrace        = false;
+
+	FGroundQuery ToeQuery(FootQuery);
+	ToeQuery.Start     = EndpointsWS.ToeTraceStart;
+	ToeQuery.End       = EndpointsWS.ToeTraceEnd;
+	ToeQuery.bToeTrace = true;
+
+	PendingQueries.Add(FootQuery);
+	PendingQueries.Add(ToeQuery);
+}
+
+uint8 FIKGroundQueryService::GetQualityFlags(const FIKGroundQueryQuality& Quality)
+{
+	return (Quality.bTraceComplex ? GroundQueryTraceComplex : 0) |
+		(Quality.bReturnPhysicalMaterial ? GroundQueryReturnPhysMat : 0) |
+		(Quality.bReturnFaceIndex ? GroundQueryReturnFaceIndex : 0);
+}
+
+void FIKGroundQueryService::Flush()
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKGroundQueryService_Flush);
+
+	// Results for the previous flush have been delivered by now; late results are dropped in OnTraceCompleted
+	InFlightQueries.Reset();
+	Swap(InFlightQueries, PendingQueries);
+
+	UWorld* WorldPtr = World.Get();
+	if (WorldPtr == nullptr || InFlightQueries.Num() == 0)
+	{
+		InFlightQueries.Reset();
+		return;
+	}
+
+	static const FName GroundQueryTraceTag(TEXT("IK Ground Query"));
+	QueryParamsPerActor.Reset();
+
+	for (int32 i = 0; i < InFlightQueries.Num(); ++i)
+	{
+		FGroundQuery& Query = InFlightQueries[i];
+
+		TPair<TWeakObjectPtr<AActor>, uint8> ParamsKey(Query.ActorToIgnore, Query.QualityFlags);
+		FCollisionQueryParams* TraceParams = QueryParamsPerActor.Find(ParamsKey);
+		if (TraceParams == nullptr)
+		{
+			TraceParams = &QueryParamsPerActor.Add(ParamsKey, UTraceUtil::MakeQueryParams(GroundQueryTraceTag,
+				Query.ActorToIgnore.Get(),
+				(Query.QualityFlags & GroundQueryReturnPhysMat) != 0,
+				(Query.QualityFlags & GroundQueryTraceComplex) != 0,
+				(Query.QualityFlags & GroundQueryReturnFaceIndex) != 0));
+		}
+
+		Query.Handle = WorldPtr->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+			Query.Start,
+			Query.End,
+			Query.CollisionChannel,
+			*TraceParams,
+			FCollisionResponseParams::DefaultResponseParam,
+			&TraceDelegate,
+			static_cast<uint32>(i));
+	}
+
+	INC_DWORD_STAT_BY(STAT_IKGroundQueryService_NumQueries, InFlightQueries.Num());
+}
+
+void FIKGroundQueryService::OnTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	int32 QueryIndex = static_cast<int32>(Datum.UserData);
+	if (!InFlightQueries.IsValidIndex(QueryIndex) || !(InFlightQueries[QueryIndex].Handle == Handle))
+	{
+		return;
+	}
+
+	FGroundQuery& Query = InFlightQueries[QueryIndex];
+	UHumanoidIKTraceData_Wrapper* TraceData = Query.TraceData.Get();
+	if (TraceData == nullptr)
+	{
+		return;
+	}
+
+	FIKGroundSample& SampleOut = Query.bToeTrace ? TraceData->QueryResultsWS.ToeSample : TraceData->QueryResultsWS.FootSample;
+	SampleOut.SetFromHit(Datum.OutHits.Num() > 0 ? Datum.OutHits[0] : FHitResult(ForceInit), FTransform::Identity);
+	++TraceData->NumQueryResultsReceived;
+}
+
+void FIKGroundQueryService::OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	TUniquePtr<FIKGroundQueryService>* Service = Services.Find(InWorld);
+	if (Service != nullptr)
+	{
+		(*Service)->Flush();
+	}
+}
+
+void FIKGroundQueryService::OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources)
+{
+	Services.Remove(InWorld);
+}
@@ -0,0 +1,215 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "GroundSampleHash.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "Misc/ScopeLock.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Sample Hash Hits"), STAT_IKGroundSampleHash_Hits, STATGROUP_Anim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Sample Hash Misses"), STAT_IKGroundSampleHash_Misses, STATGROUP_Anim);
+
+const float FIKGroundSampleHash::CellSize       = 5.0f;
+const float FIKGroundSampleHash::BandHeight     = 50.0f;
+const double FIKGroundSampleHash::MaxAgeSeconds = 10.0;
+
+// Expired samples are only swept out once the hash holds more than this many
+static const int32 GroundSampleHashPruneThreshold = 16384;
+
+FCriticalSection FIKGroundSampleHash::HashesLock;
+TMap<TWeakObjectPtr<UWorld>, TSharedRef<FIKGroundSampleHash, ESPMode::ThreadSafe>> FIKGroundSampleHash::Hashes;
+
+TSharedRef<FIKGroundSampleHash, ESPMode::ThreadSafe> FIKGroundSampleHash::Get(UWorld* World)
+{
+	FScopeLock ScopeLock(&HashesLock);
+
+	TSharedRef<FIKGroundSampleHash, ESPMode::ThreadSafe>* Hash = Hashes.Find(World);
+	if (Hash == nullptr)
+	{
+		Hash = &Hashes.Add(World, MakeShared<FIKGroundSampleHash, ESPMode::ThreadSafe>());
+	}
+
+	return *Hash;
+}
+
+void FIKGroundSampleHash::RegisterDelegates()
+{
+	check(IsInGameThread());
+
+	FWorldDelegates::LevelAddedToWorld.AddStatic(&FIKGroundSampleHash::OnLevelsChanged);
+	FWorldDelegates::LevelRemovedFromWorld.AddStatic(&FIKGroundSampleHash::OnLevelsChanged);
+	FWorldDelegates::OnWorldCleanup.AddStatic(&FIKGroundSampleHash::OnWorldCleanup);
+}
+
+void FIKGroundSampleHash::OnLevelsChanged(ULevel* Level, UWorld* World)
+{
+	FScopeLock ScopeLock(&HashesLock);
+
+	TSharedRef<FIKGroundSampleHash, ESPMode::ThreadSafe>* Hash = Hashes.Find(World);
+	if (Hash != nullptr)
+	{
+		(*Hash)->Empty();
+	}
+}
+
+void FIKGroundSampleHash::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	FScopeLock ScopeLock(&HashesLock);
+	Hashes.Remove(World);
+}
+
+FIntVector FIKGroundSampleHash::GetKey(const FVector& Location)
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / BandHeight));
+}
+
+int32 FIKGroundSampleHash::GetQualityIndex(const FIKGroundQueryQuality& Quality)
+{
+	int32 Index = static_cast<int32>(Quality.ProbeMode) << 3;
+	Index      |= Quality.bTraceComplex ? 1 : 0;
+	Index      |= Quality.bReturnPhysicalMaterial ? 2 : 0;
+	Index      |= Quality.bReturnFaceIndex ? 4 : 0;
+
+	check(Index < NumQualityKinds);
+	return Index;
+}
+
+bool FIKGroundSampleHash::FindHit(const FVector& Start, 
+	const FVector& End, 
+	const FIKGroundQueryQuality& Quality, 
+	FHitResult& OutHit)
+{
+	// Only vertical, downward traces can be answered
+	FVector TraceVec  = End - Start;
+	float TraceLength = TraceVec.Size();
+	if (TraceLength < KINDA_SMALL_NUMBER || TraceVec.Z > -TraceLength * (1.0f - KINDA_SMALL_NUMBER))
+	{
+		return false;
+	}
+
+	FIntVector StartKey = GetKey(Start);
+	int32 EndBand       = GetKey(End).Z;
+	double Now          = FPlatformTime::Seconds();
+
+	FScopeLock ScopeLock(&Lock);
+	const TMap<FIntVector, FSample>& QualitySamples = Samples[GetQualityIndex(Quality)];
+
+	// Search downward from the start; the first sample found is the highest one
+	for (int32 Band = StartKey.Z; Band >= EndBand; --Band)
+	{
+		const FSample* Sample = QualitySamples.Find(FIntVector(StartKey.X, StartKey.Y, Band));
+		if (Sample == nullptr)
+		{
+			continue;
+		}
+
+		if (Now - Sample->Timestamp > MaxAgeSeconds ||
+			Sample->TraceStartZ < Start.Z ||
+			FMath::Abs(Sample->ImpactNormal.Z) < KINDA_SMALL_NUMBER)
+		{
+			break;
+		}
+
+		// Slide the sample along its plane to the new trace line
+		FVector Offset = Start - Sample->ImpactPoint;
+		float Height   = Sample->ImpactPoint.Z -
+			(Sample->ImpactNormal.X * Offset.X + Sample->ImpactNormal.Y * Offset.Y) / Sample->ImpactNormal.Z;
+
+		if (Height > Start.Z || Height < End.Z)
+		{
+			break;
+		}
+
+		FVector ImpactPoint(Start.X, Start.Y, Height);
+
+		OutHit              = FHitResult(ForceInit);
+		OutHit.bBlockingHit = true;
+		OutHit.ImpactPoint  = ImpactPoint;
+		OutHit.Location     = ImpactPoint;
+		OutHit.ImpactNormal = Sample->ImpactNormal;
+		OutHit.Normal       = Sample->ImpactNormal;
+		OutHit.TraceStart   = Start;
+		OutHit.TraceEnd     = End;
+		OutHit.Distance     = Start.Z - Height;
+		OutHit.Time         = OutHit.Distance / TraceLength;
+		OutHit.Actor        = Sample->Actor;
+		OutHit.Component    = Sample->Component;
+		OutHit.PhysMaterial = Sample->PhysMaterial;
+		OutHit.FaceIndex    = Sample->FaceIndex;
+
+		INC_DWORD_STAT(STAT_IKGroundSampleHash_Hits);
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_IKGroundSampleHash_Misses);
+	return false;
+}
+
+void FIKGroundSampleHash::AddHit(const FHitResult& Hit, const FIKGroundQueryQuality& Quality)
+{
+	UPrimitiveComponent* HitComponent = Hit.GetComponent();
+	if (Hit.GetActor() == nullptr || HitComponent == nullptr || HitComponent->Mobility != EComponentMobility::Static)
+	{
+		return;
+	}
+
+	FSample Sample;
+	Sample.ImpactPoint  = Hit.ImpactPoint;
+	Sample.ImpactNormal = Hit.ImpactNormal;
+	Sample.TraceStartZ  = Hit.TraceStart.Z;
+	Sample.Timestamp    = FPlatformTime::Seconds();
+	Sample.Actor        = Hit.Actor;
+	Sample.Component    = Hit.Component;
+	Sample.PhysMaterial = Hit.PhysMaterial;
+	Sample.FaceIndex    = Hit.FaceIndex;
+
+	FScopeLock ScopeLock(&Lock);
+	TMap<FIntVector, FSample>& QualitySamples = Samples[GetQualityIndex(Quality)];
+
+	// Keep whichever sample was traced from higher up, so it can answer more traces
+	FIntVector Key          = GetKey(Hit.ImpactPoint);
+	FSample* ExistingSample = QualitySamples.Find(Key);
+	if (ExistingSample != nullptr &&
+		ExistingSample->TraceStartZ > Sample.TraceStartZ &&
+		Sample.Timestamp - ExistingSample->Timestamp < MaxAgeSeconds)
+	{
+		return;
+	}
+
+	QualitySamples.Add(Key, Sample);
+	Prune(QualitySamples, Sample.Timestamp);
+}
+
+void FIKGroundSampleHash::Empty()
+{
+	FScopeLock ScopeLock(&Lock);
+	for (TMap<FIntVector, FSample>& QualitySamples : Samples)
+	{
+		QualitySamples.Empty();
+	}
+}
+
+void FIKGroundSampleHash::Prune(TMap<FIntVector, FSample>& QualitySamples, double Now)
+{
+	if (QualitySamples.Num() < GroundSampleHashPruneThreshold)
+	{
+		return;
+	}
+
+	for (auto It = QualitySamples.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value().Timestamp > MaxAgeSeconds)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Everything is recent; start over rather than growing without bound
+	if (QualitySamples.Num() >= GroundSampleHashPruneThreshold)
+	{
+		QualitySamples.Empty();
+	}
+}
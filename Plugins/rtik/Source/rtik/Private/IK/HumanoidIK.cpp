@@ -4,7 +4,11 @@
 #include "HumanoidIK.h"
 #include "Utility/AnimUtil.h"
 #include "Utility/TraceUtil.h"
+#include "GroundProvider.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "TwoBoneIK.h"
 
 void FHumanoidIK::HumanoidIKLegTrace(ACharacter* Character,
 	FCSPose<FCompactPose>& MeshBases,
@@ -12,7 +16,9 @@ void FHumanoidIK::HumanoidIKLegTrace(ACharacter* Character,
 	FIKBone& PelvisBone,
 	float MaxPelvisAdjustHeight,
 	FHumanoidIKTraceData& OutTraceData,
-	bool bEnableDebugDraw)
+	bool bEnableDebugDraw,
+	const FIKGroundQueryQuality& Quality,
+	FIKGroundProvider* GroundProvider)
 {
 	// Traces to find floor points below foot bone and toe. 
 
@@ -26,153 +32,501 @@ void FHumanoidIK::HumanoidIKLegTrace(ACharacter* Character,
 		return;
 	}
 
-	USkeletalMeshComponent* SkelComp = Character->GetMesh();
-	UWorld* World = Character->GetWorld();
-	const FBoneContainer& RequiredBones = MeshBases.GetPose().GetBoneContainer();	
-	FVector TraceDirection = -1 * Character->GetActorUpVector();
+	HumanoidIKLegTrace(Character->GetWorld(), Character, Character->GetMesh()->GetComponentToWorld(), MeshBases, 
+		LegChain, PelvisBone, MaxPelvisAdjustHeight, OutTraceData, bEnableDebugDraw, Quality, GroundProvider);
+}
+
+void FHumanoidIK::HumanoidIKLegTrace(UWorld* World,
+	AActor* ActorToIgnore,
+	const FTransform& ComponentToWorld,
+	FCSPose<FCompactPose>& MeshBases,
+	FHumanoidLegChain& LegChain,
+	FIKBone& PelvisBone,
+	float MaxPelvisAdjustHeight,
+	FHumanoidIKTraceData& OutTraceData,
+	bool bEnableDebugDraw,
+	const FIKGroundQueryQuality& Quality,
+	FIKGroundProvider* GroundProvider)
+{
+	if (World == nullptr)
+	{
+		return;
+	}
 
 	// All calcuations done in CS; will be translated to world space for final trace
-	FVector PelvisLocation = FAnimUtil::GetBoneCSLocation(*SkelComp,
-		MeshBases,
-		PelvisBone.BoneIndex);
+	FHumanoidLegTraceEndpoints Endpoints;
+	ComputeLegTraceEndpointsCS(MeshBases, LegChain, PelvisBone, MaxPelvisAdjustHeight, Endpoints);
 
-	FVector FootLocation = FAnimUtil::GetBoneCSLocation(*SkelComp, MeshBases, LegChain.ShinBone.BoneIndex);
-	FVector ToeLocation = FAnimUtil::GetBoneCSLocation(*SkelComp, MeshBases, LegChain.FootBone.BoneIndex);
+	FHumanoidLegGroundHits Hits;
+	ProbeLegEndpoints(World, ActorToIgnore, LegChain, Endpoints.TransformBy(ComponentToWorld), 
+		Quality, Hits, bEnableDebugDraw, GroundProvider);
+	Hits.ToTraceData(ComponentToWorld, OutTraceData);
+}
 
-	float TraceStartHeight = FMath::Max3(FootLocation.Z + LegChain.FootRadius,
-		ToeLocation.Z + LegChain.ToeRadius,
-		PelvisLocation.Z);
-	float TraceEndHeight = PelvisLocation.Z - (LegChain.GetTotalChainLength() + LegChain.FootRadius + LegChain.ToeRadius + MaxPelvisAdjustHeight);
+void FHumanoidIK::ProbeLegEndpoints(UWorld* World,
+	AActor* ActorToIgnore,
+	const FHumanoidLegChain& LegChain,
+	const FHumanoidLegTraceEndpoints& EndpointsWS,
+	const FIKGroundQueryQuality& Quality,
+	FHumanoidLegGroundHits& OutHits,
+	bool bEnableDebugDraw,
+	FIKGroundProvider* GroundProvider)
+{
+	if (GroundProvider != nullptr &&
+		GroundProvider->FindGround(EndpointsWS.FootTraceStart, EndpointsWS.FootTraceEnd, OutHits.FootHitResult) &&
+		GroundProvider->FindGround(EndpointsWS.ToeTraceStart, EndpointsWS.ToeTraceEnd, OutHits.ToeHitResult))
+	{
+		return;
+	}
 
-	FVector FootTraceStart(FootLocation.X, FootLocation.Y, TraceStartHeight);
-	FVector FootTraceEnd(FootLocation.X, FootLocation.Y, TraceEndHeight);
+	if (Quality.ProbeMode == EHumanoidLegProbeMode::HLPM_FootSweep)
+	{
+		SweepLegEndpoints(World, ActorToIgnore, LegChain, EndpointsWS, OutHits, bEnableDebugDraw, Quality);
+	}
+	else
+	{
+		TraceLegEndpoints(World, ActorToIgnore, EndpointsWS, OutHits, bEnableDebugDraw, Quality);
+	}
 
-	FVector ToeTraceStart(ToeLocation.X, ToeLocation.Y, TraceStartHeight);
-	FVector ToeTraceEnd(ToeLocation.X, ToeLocation.Y, TraceEndHeight);
+	// Give the provider a chance to learn about whatever was hit
+	if (GroundProvider != nullptr)
+	{
+		GroundProvider->OnPhysicsTrace(OutHits.FootHitResult);
+		GroundProvider->OnPhysicsTrace(OutHits.ToeHitResult);
+	}
+}
 
-	// Convert to world space for tracing
-	FTransform ComponentToWorld = SkelComp->GetComponentToWorld();
-	FootTraceStart = ComponentToWorld.TransformPosition(FootTraceStart);
-	FootTraceEnd   = ComponentToWorld.TransformPosition(FootTraceEnd);
-	ToeTraceStart  = ComponentToWorld.TransformPosition(ToeTraceStart);
-	ToeTraceEnd    = ComponentToWorld.TransformPosition(ToeTraceEnd);
-	
+// Moves a sweep hit to where the line from Start to End crosses the contact plane
+static void ProjectSweepHitOntoLine(const FHitResult& SweepHit,
+	const FVector& Start,
+	const FVector& End,
+	FHitResult& OutHit)
+{
+	OutHit = SweepHit;
+
+	FVector TraceVec = End - Start;
+	float Denom      = FVector::DotProduct(TraceVec, SweepHit.ImpactNormal);
+
+	// Contact normal is perpendicular to the trace (e.g., hit a wall); just use the contact point
+	FVector ImpactPoint = SweepHit.ImpactPoint;
+	if (FMath::Abs(Denom) > KINDA_SMALL_NUMBER)
+	{
+		float Time  = FVector::DotProduct(SweepHit.ImpactPoint - Start, SweepHit.ImpactNormal) / Denom;
+		ImpactPoint = Start + FMath::Clamp(Time, 0.0f, 1.0f) * TraceVec;
+	}
+
+	OutHit.ImpactPoint = ImpactPoint;
+	OutHit.Location    = ImpactPoint;
+	OutHit.TraceStart  = Start;
+	OutHit.TraceEnd    = End;
+}
+
+void FHumanoidIK::SweepLegEndpoints(UWorld* World,
+	AActor* ActorToIgnore,
+	const FHumanoidLegChain& LegChain,
+	const FHumanoidLegTraceEndpoints& EndpointsWS,
+	FHumanoidLegGroundHits& OutHits,
+	bool bEnableDebugDraw,
+	const FIKGroundQueryQuality& Quality)
+{
+	FVector SweepStart = 0.5f * (EndpointsWS.FootTraceStart + EndpointsWS.ToeTraceStart);
+	FVector SweepEnd   = 0.5f * (EndpointsWS.FootTraceEnd + EndpointsWS.ToeTraceEnd);
+	FVector SweepDir   = (SweepEnd - SweepStart).GetSafeNormal();
+
+	// Orient the box along the foot, perpendicular to the sweep
+	FVector FootVec = EndpointsWS.ToeTraceStart - EndpointsWS.FootTraceStart;
+	FootVec        -= FVector::DotProduct(FootVec, SweepDir) * SweepDir;
+	float FootLength = FootVec.Size();
+
+	FQuat SweepRotation = FootLength > KINDA_SMALL_NUMBER ?
+		FRotationMatrix::MakeFromXZ(FootVec, -SweepDir).ToQuat() :
+		FRotationMatrix::MakeFromZ(-SweepDir).ToQuat();
+
+	FVector HalfExtent(0.5f * FootLength + LegChain.ToeRadius, LegChain.ToeRadius, 1.0f);
+
+	FHitResult SweepHit;
+	if (!UTraceUtil::BoxSweep(World, ActorToIgnore, SweepStart, SweepEnd, SweepRotation, HalfExtent,
+		SweepHit, ECC_Pawn, Quality.bReturnPhysicalMaterial, bEnableDebugDraw, Quality.bTraceComplex, Quality.bReturnFaceIndex))
+	{
+		OutHits.FootHitResult = FHitResult(ForceInit);
+		OutHits.ToeHitResult  = FHitResult(ForceInit);
+		return;
+	}
+
+	ProjectSweepHitOntoLine(SweepHit, EndpointsWS.FootTraceStart, EndpointsWS.FootTraceEnd, OutHits.FootHitResult);
+	ProjectSweepHitOntoLine(SweepHit, EndpointsWS.ToeTraceStart, EndpointsWS.ToeTraceEnd, OutHits.ToeHitResult);
+}
+
+void FHumanoidIK::TraceLegEndpoints(UWorld* World,
+	AActor* ActorToIgnore,
+	const FHumanoidLegTraceEndpoints& EndpointsWS,
+	FHumanoidLegGroundHits& OutHits,
+	bool bEnableDebugDraw,
+	const FIKGroundQueryQuality& Quality)
+{
 	UTraceUtil::LineTrace(World,
-		Character,
-		FootTraceStart,
-		FootTraceEnd,
-		OutTraceData.FootHitResult,
+		ActorToIgnore,
+		EndpointsWS.FootTraceStart,
+		EndpointsWS.FootTraceEnd,
+		OutHits.FootHitResult,
 		ECC_Pawn,
-		false,
-		bEnableDebugDraw);
+		Quality.bReturnPhysicalMaterial,
+		bEnableDebugDraw,
+		Quality.bTraceComplex,
+		Quality.bReturnFaceIndex);
 
 	UTraceUtil::LineTrace(World,
-		Character,
-		ToeTraceStart,
-		ToeTraceEnd,
-		OutTraceData.ToeHitResult,
+		ActorToIgnore,
+		EndpointsWS.ToeTraceStart,
+		EndpointsWS.ToeTraceEnd,
+		OutHits.ToeHitResult,
 		ECC_Pawn,
+		Quality.bReturnPhysicalMaterial,
+		bEnableDebugDraw,
+		Quality.bTraceComplex,
+		Quality.bReturnFaceIndex);
+}
+
+void FHumanoidIK::ComputeLegTraceEndpointsCS(FCSPose<FCompactPose>& MeshBases,
+	FHumanoidLegChain& LegChain,
+	FIKBone& PelvisBone,
+	float MaxPelvisAdjustHeight,
+	FHumanoidLegTraceEndpoints& OutEndpoints)
+{
+	FVector PelvisLocation = MeshBases.GetComponentSpaceTransform(PelvisBone.BoneIndex).GetLocation();
+	FVector FootLocation   = MeshBases.GetComponentSpaceTransform(LegChain.ShinBone.BoneIndex).GetLocation();
+	FVector ToeLocation    = MeshBases.GetComponentSpaceTransform(LegChain.FootBone.BoneIndex).GetLocation();
+
+	float TraceStartHeight = FMath::Max3(FootLocation.Z + LegChain.FootRadius,
+		ToeLocation.Z + LegChain.ToeRadius,
+		PelvisLocation.Z);
+	float TraceEndHeight = PelvisLocation.Z - (LegChain.GetTotalChainLength() + LegChain.FootRadius + LegChain.ToeRadius + MaxPelvisAdjustHeight);
+
+	OutEndpoints.FootTraceStart = FVector(FootLocation.X, FootLocation.Y, TraceStartHeight);
+	OutEndpoints.FootTraceEnd   = FVector(FootLocation.X, FootLocation.Y, TraceEndHeight);
+
+	OutEndpoints.ToeTraceStart  = FVector(ToeLocation.X, ToeLocation.Y, TraceStartHeight);
+	OutEndpoints.ToeTraceEnd    = FVector(ToeLocation.X, ToeLocation.Y, TraceEndHeight);
+}
+
+void FHumanoidIK::SolveLegTwoBoneKneeAware(const FTransform& HipCSTransform,
+	const FTransform& KneeCSTransform,
+	const FTransform& FootCSTransform,
+	const FVector& FootTargetCS,
+	TArray<FTransform>& OutCSTransforms)
+{
+	OutCSTransforms.Empty(3);
+	OutCSTransforms.Add(HipCSTransform);
+	OutCSTransforms.Add(KneeCSTransform);
+	OutCSTransforms.Add(FootCSTransform);
+
+	FVector HipCS  = HipCSTransform.GetLocation();
+	FVector KneeCS = KneeCSTransform.GetLocation();
+	FVector FootCS = FootCSTransform.GetLocation();
+
+	// How the hip-foot axis turns as the foot moves to the target
+	FVector HipFootAxis   = (FootCS - HipCS).GetSafeNormal();
+	FVector HipTargetAxis = (FootTargetCS - HipCS).GetSafeNormal();
+	FQuat AxisRotation    = HipFootAxis.IsZero() || HipTargetAxis.IsZero() ?
+		FQuat::Identity : FQuat::FindBetweenNormals(HipFootAxis, HipTargetAxis);
+
+	// The knee's direction off the hip-foot axis. A straight leg has none; bend it forward, like the plain
+	// two-bone solver does.
+	FVector KneeOffset    = KneeCS - HipCS;
+	FVector KneeDirection = FVector::VectorPlaneProject(KneeOffset, HipFootAxis);
+	if (!KneeDirection.Normalize())
+	{
+		KneeDirection = FVector(1.0f, 0.0f, 0.0f);
+	}
+
+	FVector KneeTargetCS = HipCS + AxisRotation.RotateVector(KneeOffset.ProjectOnToNormal(HipFootAxis) + 
+		KneeDirection * KneeOffset.Size());
+
+	AnimationCore::SolveTwoBoneIK(
+		OutCSTransforms[0],
+		OutCSTransforms[1],
+		OutCSTransforms[2],
+		KneeTargetCS,
+		FootTargetCS,
 		false,
-		bEnableDebugDraw);
+		1.0f,
+		1.0f
+	);
 }
 
-bool FHumanoidLegChain::IsValid(const FBoneContainer& RequiredBones)
+void FHumanoidIK::ComputeLegDeltaRotations(const FTransform& HipCSPre,
+	const FTransform& KneeCSPre,
+	const FTransform& HipCSPost,
+	const FTransform& KneeCSPost,
+	FQuat& OutHipDelta,
+	FQuat& OutKneeDelta)
 {
-	bool bValid = HipBone.IsValid(RequiredBones)
-		&& ThighBone.IsValid(RequiredBones)
-		&& ShinBone.IsValid(RequiredBones)
-		&& FootBone.IsValid(RequiredBones);
+	OutHipDelta  = (HipCSPost.GetRotation() * HipCSPre.GetRotation().Inverse()).GetNormalized();
+	OutKneeDelta = (KneeCSPost.GetRotation() * KneeCSPre.GetRotation().Inverse()).GetNormalized();
+}
 
-	return bValid;
+void FHumanoidIK::ApplyLegDeltaRotations(const FTransform& HipCSTransform,
+	const FTransform& KneeCSTransform,
+	const FTransform& FootCSTransform,
+	const FQuat& HipDelta,
+	const FQuat& KneeDelta,
+	TArray<FTransform>& OutCSTransforms)
+{
+	OutCSTransforms.Empty(3);
+
+	FVector HipCS  = HipCSTransform.GetLocation();
+	FVector KneeCS = HipCS + HipDelta.RotateVector(KneeCSTransform.GetLocation() - HipCS);
+	FVector FootCS = KneeCS + KneeDelta.RotateVector(FootCSTransform.GetLocation() - KneeCSTransform.GetLocation());
+
+	FTransform NewHip(HipCSTransform);
+	NewHip.SetRotation((HipDelta * HipCSTransform.GetRotation()).GetNormalized());
+
+	FTransform NewKnee(KneeCSTransform);
+	NewKnee.SetRotation((KneeDelta * KneeCSTransform.GetRotation()).GetNormalized());
+	NewKnee.SetLocation(KneeCS);
+
+	FTransform NewFoot(FootCSTransform);
+	NewFoot.SetLocation(FootCS);
+
+	OutCSTransforms.Add(NewHip);
+	OutCSTransforms.Add(NewKnee);
+	OutCSTransforms.Add(NewFoot);
 }
 
-float FHumanoidLegChain::GetTotalChainLength() const
+FHumanoidLegTraceEndpoints FHumanoidLegTraceEndpoints::TransformBy(const FTransform& Transform) const
 {
-	return TotalChainLength;
+	FHumanoidLegTraceEndpoints Result;
+	Result.FootTraceStart = Transform.TransformPosition(FootTraceStart);
+	Result.FootTraceEnd   = Transform.TransformPosition(FootTraceEnd);
+	Result.ToeTraceStart  = Transform.TransformPosition(ToeTraceStart);
+	Result.ToeTraceEnd    = Transform.TransformPosition(ToeTraceEnd);
+	return Result;
 }
 
-bool FHumanoidLegChain::FindWithinFootRotationLimit(const USkeletalMeshComponent& SkelComp,
-	const FHumanoidIKTraceData& TraceData,
-	float& OutAngleRad) const
+#pragma region FIKGroundSample
+
+void FIKGroundSample::SetFromHit(const FHitResult& Hit, const FTransform& ComponentToWorld)
+{
+	UPrimitiveComponent* HitComponent = Hit.GetComponent();
+	UPhysicalMaterial* PhysMaterial   = Hit.PhysMaterial.Get();
+
+	bValid      = Hit.bBlockingHit;
+	bMovable    = HitComponent != nullptr && HitComponent->Mobility == EComponentMobility::Movable;
+	Location    = ComponentToWorld.InverseTransformPosition(Hit.ImpactPoint);
+	Normal      = ComponentToWorld.InverseTransformVectorNoScale(Hit.ImpactNormal);
+	ComponentID = HitComponent != nullptr ? HitComponent->GetUniqueID() : 0;
+	SurfaceType = PhysMaterial != nullptr ? PhysMaterial->SurfaceType : TEnumAsByte<EPhysicalSurface>(SurfaceType_Default);
+}
+
+FIKGroundSample FIKGroundSample::TransformBy(const FTransform& Transform) const
+{
+	FIKGroundSample Result(*this);
+	Result.Location = Transform.TransformPosition(Location);
+	Result.Normal   = Transform.TransformVectorNoScale(Normal);
+	return Result;
+}
+
+FIKGroundSample FIKGroundSample::InverseTransformBy(const FTransform& Transform) const
 {
+	FIKGroundSample Result(*this);
+	Result.Location = Transform.InverseTransformPosition(Location);
+	Result.Normal   = Transform.InverseTransformVectorNoScale(Normal);
+	return Result;
+}
 
-	if (TraceData.FootHitResult.GetActor() == nullptr ||
-		TraceData.ToeHitResult.GetActor() == nullptr)
+#pragma endregion FIKGroundSample
+
+#pragma region FHumanoidLegGroundCache
+
+// Answers a single trace by intersecting it with the cached hit plane. Fails if the new trace is too far from the cached 
+// one, or doesn't cross the plane within its length. Samples are in world space.
+static bool ProjectOntoCachedSample(const FVector& Start,
+	const FVector& End,
+	const FVector& CachedStart,
+	const FIKGroundSample& CachedSample,
+	const FPlane& CachedPlane,
+	float RetraceDistance,
+	FIKGroundSample& OutSample)
+{
+	FVector TraceVec  = End - Start;
+	float TraceLength = TraceVec.Size();
+	if (TraceLength < KINDA_SMALL_NUMBER)
 	{
 		return false;
 	}
+	FVector TraceDir = TraceVec / TraceLength;
 
-	FVector ToCS = -1 * SkelComp.GetComponentLocation();
+	// Only the offset perpendicular to the trace matters; trace start height changes with the pose
+	FVector Offset = Start - CachedStart;
+	Offset -= FVector::DotProduct(Offset, TraceDir) * TraceDir;
+	if (Offset.SizeSquared() > RetraceDistance * RetraceDistance)
+	{
+		return false;
+	}
 
-	FVector FootFloorCS = ToCS + TraceData.FootHitResult.ImpactPoint;
-	FVector ToeFloorCS  = ToCS + TraceData.ToeHitResult.ImpactPoint;
-	
-	FVector FloorSlopeVec = ToeFloorCS - FootFloorCS;
-	FVector FloorFlatVec(FloorSlopeVec);
-	FloorFlatVec.Z = 0.0f;
+	OutSample = CachedSample;
+
+	// A cached miss stays a miss
+	if (!CachedSample.bValid)
+	{
+		return true;
+	}
 	
-	if(!FloorSlopeVec.Normalize() || !FloorFlatVec.Normalize())
+	float Denom = FVector::DotProduct(TraceDir, FVector(CachedPlane));
+	if (FMath::Abs(Denom) < KINDA_SMALL_NUMBER)
 	{
-		OutAngleRad = 0.0f;
 		return false;
 	}
-   
-	OutAngleRad = FMath::Acos(FVector::DotProduct(FloorFlatVec, FloorSlopeVec));
-	float RequiredRotationDeg = FMath::RadiansToDegrees(OutAngleRad);
 
-	if (RequiredRotationDeg > MaxFootRotationDegrees)
+	FVector Intersection = FMath::LinePlaneIntersection(Start, End, CachedPlane);
+	float Distance       = FVector::DotProduct(Intersection - Start, TraceDir);
+	if (Distance < 0.0f || Distance > TraceLength)
 	{
 		return false;
 	}
-	
+
+	OutSample.Location = Intersection;
 	return true;
 }
 
-bool FHumanoidLegChain::GetIKFloorPointCS(const USkeletalMeshComponent& SkelComp,
+bool FHumanoidLegGroundCache::TryProject(const FHumanoidLegTraceEndpoints& EndpointsWS,
+	const FHumanoidLegGroundCacheSettings& Settings,
+	const FTransform& ComponentToWorld,
+	FHumanoidIKTraceData& OutTraceData)
+{
+	if (!bValid || bHitMovable || FramesSinceTrace >= Settings.RevalidationIntervalFrames)
+	{
+		return false;
+	}
+
+	FHumanoidIKTraceData ProjectedWS;
+	bool bProjected = ProjectOntoCachedSample(EndpointsWS.FootTraceStart,
+		EndpointsWS.FootTraceEnd,
+		CachedEndpointsWS.FootTraceStart,
+		CachedTraceDataWS.FootSample,
+		FootPlane,
+		Settings.RetraceDistance,
+		ProjectedWS.FootSample);
+
+	bProjected = bProjected && ProjectOntoCachedSample(EndpointsWS.ToeTraceStart,
+		EndpointsWS.ToeTraceEnd,
+		CachedEndpointsWS.ToeTraceStart,
+		CachedTraceDataWS.ToeSample,
+		ToePlane,
+		Settings.RetraceDistance,
+		ProjectedWS.ToeSample);
+
+	if (!bProjected)
+	{
+		return false;
+	}
+
+	OutTraceData = ProjectedWS.InverseTransformBy(ComponentToWorld);
+	++FramesSinceTrace;
+	return true;
+}
+
+void FHumanoidLegGroundCache::Store(const FHumanoidLegTraceEndpoints& EndpointsWS, 
 	const FHumanoidIKTraceData& TraceData,
+	const FTransform& ComponentToWorld)
+{
+	bValid            = true;
+	FramesSinceTrace  = 0;
+	CachedEndpointsWS = EndpointsWS;
+	CachedTraceDataWS = TraceData.TransformBy(ComponentToWorld);
+	FootPlane         = FPlane(CachedTraceDataWS.FootSample.Location, CachedTraceDataWS.FootSample.Normal);
+	ToePlane          = FPlane(CachedTraceDataWS.ToeSample.Location, CachedTraceDataWS.ToeSample.Normal);
+	bHitMovable       = CachedTraceDataWS.FootSample.bMovable || CachedTraceDataWS.ToeSample.bMovable;
+}
+
+#pragma endregion FHumanoidLegGroundCache
+
+bool FHumanoidLegChain::IsValid(const FBoneContainer& RequiredBones)
+{
+	bool bValid = HipBone.IsValid(RequiredBones)
+		&& ThighBone.IsValid(RequiredBones)
+		&& ShinBone.IsValid(RequiredBones)
+		&& FootBone.IsValid(RequiredBones);
+
+	return bValid;
+}
+
+float FHumanoidLegChain::GetTotalChainLength() const
+{
+	return TotalChainLength;
+}
+
+bool FHumanoidLegChain::FindWithinFootRotationLimit(const FHumanoidIKTraceData& TraceData,
+	float& OutAngleRad) const
+{
+	FHumanoidLegGroundSolution Solution;
+	SolveGround(TraceData, Solution);
+
+	OutAngleRad = Solution.SlopeAngleRad;
+	return Solution.bWithinRotationLimit;
+}
+
+bool FHumanoidLegChain::GetIKFloorPointCS(const FHumanoidIKTraceData& TraceData,
 	FVector& OutTraceLocationCS) const 
 {
-	FVector ToCS        = -1 * SkelComp.GetComponentLocation();
-	FVector FootFloorCS = ToCS + TraceData.FootHitResult.ImpactPoint;
-	FVector ToeFloorCS  = ToCS + TraceData.ToeHitResult.ImpactPoint;
+	FHumanoidLegGroundSolution Solution;
+	SolveGround(TraceData, Solution);
+
+	if (Solution.bValid)
+	{
+		OutTraceLocationCS = Solution.FloorPointCS;
+	}
+#if ENABLE_IK_DEBUG_VERBOSE
+	else
+	{
+		UE_LOG(LogRTIK, Warning, TEXT("Warning, GetIKFloorPointCS was called on an invalid trace result. The output floor point may be invalid."));
+	}
+#endif // ENABLE_IK_DEBUG_VERBOSE
+
+	return Solution.bWithinRotationLimit;
+}
+
+void FHumanoidLegChain::SolveGround(const FHumanoidIKTraceData& TraceData, 
+	FHumanoidLegGroundSolution& OutSolution) const
+{
+	const FIKGroundSample& FootSample = TraceData.FootSample;
+	const FIKGroundSample& ToeSample  = TraceData.ToeSample;
+
+	OutSolution        = FHumanoidLegGroundSolution();
+	OutSolution.bValid = FootSample.bValid || ToeSample.bValid;
 
 	// If one of the trace results is invalid, don't rotate, and use the other one
-	if (TraceData.FootHitResult.GetActor() == nullptr || TraceData.ToeHitResult.GetActor() == nullptr)
+	if (!FootSample.bValid || !ToeSample.bValid)
 	{
-		if (TraceData.FootHitResult.GetActor() != nullptr)
-		{
-			OutTraceLocationCS = FootFloorCS;
-		}
-		else if (TraceData.ToeHitResult.GetActor() != nullptr)
-		{
-			OutTraceLocationCS = ToeFloorCS;
-		}
+		OutSolution.FloorPointCS = FootSample.bValid ? FootSample.Location : ToeSample.Location;
+		return;
+	}
 
-#if ENABLE_IK_DEBUG_VERBOSE
-		else
-		{
-			UE_LOG(LogRTIK, Warning, TEXT("Warning, GetIKFloorPointCS was called on an invalid trace result. The output floor point may be invalid."));
-			// check (false);
-		}
-#endif // ENABLE_IK_DEBUG
-		
-		return false;
+	FVector FloorSlopeVec = ToeSample.Location - FootSample.Location;
+	FVector FloorFlatVec(FloorSlopeVec);
+	FloorFlatVec.Z = 0.0f;
+
+	if (FloorSlopeVec.Normalize() && FloorFlatVec.Normalize())
+	{
+		OutSolution.SlopeAngleRad        = FMath::Acos(FMath::Clamp(FVector::DotProduct(FloorFlatVec, FloorSlopeVec), -1.0f, 1.0f));
+		OutSolution.bWithinRotationLimit = FMath::RadiansToDegrees(OutSolution.SlopeAngleRad) <= MaxFootRotationDegrees;
 	}
 
-	float Unused;
 	// If within foot rotation limit, always use the foot. Otherwise, use the higher point and the foot shouldn't rotate.
-	bool bWithinRotationLimit = FindWithinFootRotationLimit(SkelComp, TraceData, Unused);
-	
-	if (bWithinRotationLimit)
+	if (OutSolution.bWithinRotationLimit)
 	{
-		OutTraceLocationCS = FootFloorCS;
+		OutSolution.FloorPointCS = FootSample.Location;
+
+		FVector RotationAxis = FVector::CrossProduct(FloorFlatVec, FloorSlopeVec);
+		if (RotationAxis.Normalize())
+		{
+			OutSolution.TargetFootRotationCS = FQuat(RotationAxis, OutSolution.SlopeAngleRad);
+		}
 	}
 	else
 	{
-		OutTraceLocationCS = FootFloorCS.Z > ToeFloorCS.Z ? FootFloorCS : ToeFloorCS;
+		OutSolution.FloorPointCS = FootSample.Location.Z > ToeSample.Location.Z ? FootSample.Location : ToeSample.Location;
 	}
-
-	return bWithinRotationLimit;
 }
 
 bool FHumanoidLegChain::InitBoneReferences(const FBoneContainer& RequiredBones)
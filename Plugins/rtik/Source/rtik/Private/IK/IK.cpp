@@ -3,6 +3,9 @@
 #include "rtik.h"
 #include "IK.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Animation/AnimInstance.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Skipped Bone Commits"), STAT_IKCommit_NumSkippedBones, STATGROUP_Anim);
 
 FVector FIKUtil::IKBoneAxisToVector(EIKBoneAxis InBoneAxis)
 {
@@ -311,3 +314,169 @@ bool URangeLimitedIKChainWrapper::IsValid(const FBoneContainer& RequiredBones)
 	return Chain.IsValid(RequiredBones);
 }
 #pragma endregion URangedLimitedIKChainWrapper
+
+#pragma region FIKReducedRateSettings
+int32 FIKReducedRateSettings::GetSolveInterval(int32 LODLevel) const
+{
+	if (!bEnable || SolveIntervalPerLOD.Num() < 1)
+	{
+		return 1;
+	}
+
+	int32 Index = FMath::Clamp(LODLevel, 0, SolveIntervalPerLOD.Num() - 1);
+	return FMath::Max(SolveIntervalPerLOD[Index], 1);
+}
+#pragma endregion FIKReducedRateSettings
+
+#pragma region FIKReducedRateCounter
+bool FIKReducedRateCounter::Tick(const FIKReducedRateSettings& Settings, int32 LODLevel)
+{
+	SolveInterval = Settings.GetSolveInterval(LODLevel);
+
+	// Interval may have shrunk since the last solve (e.g., LOD changed)
+	FramesUntilSolve = FMath::Min(FramesUntilSolve, SolveInterval - 1);
+
+	if (FramesUntilSolve <= 0)
+	{
+		FramesUntilSolve = SolveInterval - 1;
+		return true;
+	}
+
+	--FramesUntilSolve;
+	return false;
+}
+
+float FIKReducedRateCounter::GetInterpolationAlpha() const
+{
+	// FramesUntilSolve counts the frames remaining after this one
+	return 1.0f / (FramesUntilSolve + 1);
+}
+
+void FIKReducedRateCounter::Reset()
+{
+	FramesUntilSolve = 0;
+}
+#pragma endregion FIKReducedRateCounter
+
+#pragma region FIKCommitSettings
+void FIKCommitSettings::DiscardUnchangedBones(FCSPose<FCompactPose>& Pose, TArray<FBoneTransform>& BoneTransforms) const
+{
+	if (!bSkipUnchangedBones || BoneTransforms.Num() == 0)
+	{
+		return;
+	}
+
+	float RotationToleranceRad = FMath::DegreesToRadians(RotationToleranceDegrees);
+
+	TArray<FCompactPoseBoneIndex, TInlineAllocator<8>> ChangedBones;
+	TArray<bool, TInlineAllocator<8>> bUnchanged;
+	bUnchanged.Reserve(BoneTransforms.Num());
+
+	for (const FBoneTransform& BoneTransform : BoneTransforms)
+	{
+		const FTransform& Current = Pose.GetComponentSpaceTransform(BoneTransform.BoneIndex);
+		const FTransform& New     = BoneTransform.Transform;
+
+		bool bBoneUnchanged = FVector::DistSquared(Current.GetLocation(), New.GetLocation()) <= FMath::Square(LocationTolerance) &&
+			Current.GetRotation().AngularDistance(New.GetRotation()) <= RotationToleranceRad;
+
+		bUnchanged.Add(bBoneUnchanged);
+		if (!bBoneUnchanged)
+		{
+			ChangedBones.Add(BoneTransform.BoneIndex);
+		}
+	}
+
+	if (ChangedBones.Num() == BoneTransforms.Num())
+	{
+		return;
+	}
+
+	const FCompactPose& CompactPose = Pose.GetPose();
+	int32 NumKept = 0;
+	for (int32 i = 0; i < BoneTransforms.Num(); ++i)
+	{
+		bool bDiscard = bUnchanged[i];
+		if (bDiscard && ChangedBones.Num() > 0)
+		{
+			// Keep the bone if anything above it changes, or its component space transform would change with it
+			for (FCompactPoseBoneIndex Parent = CompactPose.GetParentBoneIndex(BoneTransforms[i].BoneIndex);
+				Parent.IsValid(); Parent = CompactPose.GetParentBoneIndex(Parent))
+			{
+				if (ChangedBones.Contains(Parent))
+				{
+					bDiscard = false;
+					break;
+				}
+			}
+		}
+
+		if (!bDiscard)
+		{
+			BoneTransforms[NumKept++] = BoneTransforms[i];
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_IKCommit_NumSkippedBones, BoneTransforms.Num() - NumKept);
+	BoneTransforms.SetNum(NumKept, false);
+}
+#pragma endregion FIKCommitSettings
+
+#pragma region FIKGate
+void FIKGate::CaptureCurve(const FIKGateSettings& Settings, const UAnimInstance* AnimInstance)
+{
+	if (Settings.CurveName == NAME_None || AnimInstance == nullptr)
+	{
+		CurveValue = 1.0f;
+		return;
+	}
+
+	// GetCurveValue only reads, but isn't const
+	CurveValue = const_cast<UAnimInstance*>(AnimInstance)->GetCurveValue(Settings.CurveName);
+}
+
+bool FIKGate::IsCurveOpen(const FIKGateSettings& Settings) const
+{
+	return Settings.CurveName == NAME_None || CurveValue > Settings.CurveThreshold;
+}
+
+bool FIKGate::Evaluate(const FIKGateSettings& Settings, float Alpha, const FGraphTraversalCounter& EvaluationCounter,
+	bool bHasOffsets)
+{
+	bool bOpen   = IsCurveOpen(Settings) && Alpha > Settings.AlphaThreshold;
+	bBlendingOut = !bOpen && bHasOffsets;
+	if (!bOpen && !bBlendingOut)
+	{
+		bReopened = false;
+		return false;
+	}
+
+	// Running again in the same evaluation, or in the one right after the last, means the node never stopped.
+	// Frames the anim instance skipped entirely don't count, since they don't advance the evaluation counter.
+	bReopened = !LastOpenEvaluation.IsSynchronizedWith(EvaluationCounter) && 
+		!NextEvaluation.IsSynchronizedWith(EvaluationCounter);
+
+	LastOpenEvaluation.SynchronizeWith(EvaluationCounter);
+	NextEvaluation.SynchronizeWith(EvaluationCounter);
+	NextEvaluation.Increment();
+
+	return true;
+}
+#pragma endregion FIKGate
+
+#pragma region FIKNodeSnapshot
+void FIKNodeSnapshot::Capture(const UAnimInstance* AnimInstance)
+{
+	USkeletalMeshComponent* SkelComp = AnimInstance->GetSkelMeshComponent();
+	if (SkelComp == nullptr)
+	{
+		World     = nullptr;
+		Character = nullptr;
+		return;
+	}
+
+	ComponentToWorld = SkelComp->GetComponentToWorld();
+	World            = SkelComp->GetWorld();
+	Character        = Cast<ACharacter>(SkelComp->GetOwner());
+}
+#pragma endregion FIKNodeSnapshot
@@ -2,6 +2,7 @@
 
 #include "rtik.h"
 #include "RangeLimitedFABRIK.h"
+#include "Constraints.h"
 #include "Utility/DebugDrawUtil.h"
 
 bool FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
@@ -344,6 +345,222 @@ bool FRangeLimitedFABRIK::SolveNoisyThreePoint(
 	return true;
 }
 
+bool FRangeLimitedFABRIK::SolveTwoBoneAnalytic(
+	const TArray<FTransform>& InTransforms,
+	const FPlanarRotation* Hinge,
+	int32 HingeIndex,
+	const FVector& EffectorTargetLocation,
+	TArray<FTransform>& OutTransforms,
+	float Precision
+)
+{
+	OutTransforms.Empty();
+	OutTransforms.Append(InTransforms);
+
+	if (InTransforms.Num() != 3)
+	{
+#if ENABLE_IK_DEBUG
+		UE_LOG(LogRTIK, Warning, TEXT("SolveTwoBoneAnalytic requires a chain of exactly 3 points"));
+#endif // ENABLE_IK_DEBUG
+		return false;
+	}
+
+	FVector RootLoc  = InTransforms[0].GetLocation();
+	FVector JointLoc = InTransforms[1].GetLocation();
+	FVector TipLoc   = InTransforms[2].GetLocation();
+
+	if (FVector::Dist(TipLoc, EffectorTargetLocation) <= Precision)
+	{
+		return false;
+	}
+
+	float UpperLength = FVector::Dist(RootLoc, JointLoc);
+	float LowerLength = FVector::Dist(JointLoc, TipLoc);
+	FVector ToTarget  = EffectorTargetLocation - RootLoc;
+
+	FVector NewJointLoc = JointLoc;
+	FVector NewTipLoc   = TipLoc;
+
+	if (Hinge == nullptr)
+	{
+		// Unconstrained: the joint sits on the circle where spheres around the root and target meet. Keep it on
+		// the same side of the root-target line as it started, so the chain doesn't flip.
+		float TargetDistance = ToTarget.Size();
+		if (TargetDistance > KINDA_SMALL_NUMBER)
+		{
+			FVector TargetDirection = ToTarget / TargetDistance;
+			TargetDistance = FMath::Clamp(TargetDistance, FMath::Abs(UpperLength - LowerLength), UpperLength + LowerLength);
+
+			FVector BendDirection = FVector::VectorPlaneProject(JointLoc - RootLoc, TargetDirection);
+			if (!BendDirection.Normalize())
+			{
+				FVector Unused;
+				TargetDirection.FindBestAxisVectors(BendDirection, Unused);
+			}
+
+			float AlongTarget = (UpperLength * UpperLength - LowerLength * LowerLength + TargetDistance * TargetDistance) /
+				(2.0f * TargetDistance);
+			float AlongBend   = FMath::Sqrt(FMath::Max(UpperLength * UpperLength - AlongTarget * AlongTarget, 0.0f));
+
+			NewJointLoc = RootLoc + TargetDirection * AlongTarget + BendDirection * AlongBend;
+		}
+		
+		NewTipLoc = NewJointLoc + (EffectorTargetLocation - NewJointLoc).GetSafeNormal() * LowerLength;
+	}
+	else
+	{
+		// One bone turns only in the hinge plane. Its direction is Forward * cos(A) + Up * sin(A); the other bone
+		// is free, so the solve reduces to finding the angle A which lets the free bone reach the target.
+		FVector Axis = Hinge->RotationAxis.GetSafeNormal();
+		FVector Up   = FVector::CrossProduct(Axis, Hinge->ForwardDirection).GetSafeNormal();
+		if (Up.IsNearlyZero())
+		{
+#if ENABLE_IK_DEBUG
+			UE_LOG(LogRTIK, Warning, TEXT("SolveTwoBoneAnalytic: hinge forward direction and rotation axis must not be colinear"));
+#endif // ENABLE_IK_DEBUG
+			return false;
+		}
+
+		FVector Forward = FVector::CrossProduct(Up, Axis);
+
+		auto HingeDirection = [&Forward, &Up](float AngleRad)
+		{
+			return Forward * FMath::Cos(AngleRad) + Up * FMath::Sin(AngleRad);
+		};
+
+		auto PlaneAngle = [&Forward, &Up](const FVector& Direction)
+		{
+			return FMath::Atan2(FVector::DotProduct(Direction, Up), FVector::DotProduct(Direction, Forward));
+		};
+
+		float MinRad = FMath::DegreesToRadians(Hinge->MinDegrees);
+		float MaxRad = FMath::DegreesToRadians(Hinge->MaxDegrees);
+
+		if (HingeIndex == 0)
+		{
+			// Hinged root bone: the joint lies on a circle around the root. Solve |Root + Upper * D(A) - Target| = Lower,
+			// i.e. Dot(ToTarget, D(A)) = (Upper^2 + |ToTarget|^2 - Lower^2) / (2 * Upper)
+			float C = (UpperLength * UpperLength + ToTarget.SizeSquared() - LowerLength * LowerLength) /
+				FMath::Max(2.0f * UpperLength, KINDA_SMALL_NUMBER);
+
+			float AngleRad = SolveHingeAngle(ToTarget, Forward, Up, C, PlaneAngle(JointLoc - RootLoc), MinRad, MaxRad,
+				[&](float Candidate)
+			{
+				FVector Joint = RootLoc + HingeDirection(Candidate) * UpperLength;
+				return FMath::Abs(FVector::Dist(Joint, EffectorTargetLocation) - LowerLength);
+			});
+
+			NewJointLoc = RootLoc + HingeDirection(AngleRad) * UpperLength;
+			NewTipLoc   = NewJointLoc + (EffectorTargetLocation - NewJointLoc).GetSafeNormal() * LowerLength;
+		}
+		else
+		{
+			// Hinged lower bone: the tip lies at Target - Lower * D(A), which must be Upper away from the root, i.e.
+			// Dot(ToTarget, D(A)) = (|ToTarget|^2 + Lower^2 - Upper^2) / (2 * Lower)
+			float C = (ToTarget.SizeSquared() + LowerLength * LowerLength - UpperLength * UpperLength) /
+				FMath::Max(2.0f * LowerLength, KINDA_SMALL_NUMBER);
+
+			float AngleRad = SolveHingeAngle(ToTarget, Forward, Up, C, PlaneAngle(TipLoc - JointLoc), MinRad, MaxRad,
+				[&](float Candidate)
+			{
+				FVector Joint = EffectorTargetLocation - HingeDirection(Candidate) * LowerLength;
+				return FMath::Abs(FVector::Dist(Joint, RootLoc) - UpperLength);
+			});
+
+			FVector LowerDirection = HingeDirection(AngleRad);
+			FVector UpperDirection = EffectorTargetLocation - LowerDirection * LowerLength - RootLoc;
+			if (!UpperDirection.Normalize())
+			{
+				UpperDirection = (JointLoc - RootLoc).GetSafeNormal();
+			}
+
+			NewJointLoc = RootLoc + UpperDirection * UpperLength;
+			NewTipLoc   = NewJointLoc + LowerDirection * LowerLength;
+		}
+	}
+
+	OutTransforms[1].SetLocation(NewJointLoc);
+	OutTransforms[2].SetLocation(NewTipLoc);
+
+	// Update bone rotations, as FABRIK does
+	if (!FMath::IsNearlyZero(UpperLength))
+	{
+		UpdateParentRotation(OutTransforms[0], InTransforms[0], OutTransforms[1], InTransforms[1]);
+	}
+
+	if (!FMath::IsNearlyZero(LowerLength))
+	{
+		UpdateParentRotation(OutTransforms[1], InTransforms[1], OutTransforms[2], InTransforms[2]);
+	}
+
+	return true;
+}
+
+float FRangeLimitedFABRIK::SolveHingeAngle(
+	const FVector& ToTarget,
+	const FVector& Forward,
+	const FVector& Up,
+	float C,
+	float CurrentRad,
+	float MinRad,
+	float MaxRad,
+	TFunctionRef<float(float)> ReachError
+)
+{
+	// Dot(ToTarget, Forward * cos(A) + Up * sin(A)) = M * cos(A - TargetRad)
+	float X         = FVector::DotProduct(ToTarget, Forward);
+	float Y         = FVector::DotProduct(ToTarget, Up);
+	float M         = FMath::Sqrt(X * X + Y * Y);
+	float TargetRad = FMath::Atan2(Y, X);
+
+	if (M < KINDA_SMALL_NUMBER)
+	{
+		// Target is on the hinge axis; every angle does equally well, so don't move
+		return FMath::Clamp(CurrentRad, MinRad, MaxRad);
+	}
+
+	// Two solutions if the target is reachable. Otherwise, point toward the target (if it's too far) 
+	// or directly away (if it's too close)
+	float Ratio = C / M;
+	float Candidates[2];
+	if (Ratio >= 1.0f)
+	{
+		Candidates[0] = Candidates[1] = TargetRad;
+	}
+	else if (Ratio <= -1.0f)
+	{
+		Candidates[0] = Candidates[1] = TargetRad + PI;
+	}
+	else
+	{
+		float Spread  = FMath::Acos(Ratio);
+		Candidates[0] = TargetRad + Spread;
+		Candidates[1] = TargetRad - Spread;
+	}
+
+	// Clamp each to the hinge limits, and keep whichever gets closest to the target. If both do equally well,
+	// keep the one nearest the current angle.
+	float BestRad      = CurrentRad;
+	float BestError    = BIG_NUMBER;
+	float BestDistance = BIG_NUMBER;
+	for (float Candidate : Candidates)
+	{
+		float AngleRad = FMath::Clamp(FMath::UnwindRadians(Candidate), MinRad, MaxRad);
+		float Error    = ReachError(AngleRad);
+		float Distance = FMath::Abs(FMath::UnwindRadians(AngleRad - CurrentRad));
+
+		if (Error < BestError - KINDA_SMALL_NUMBER ||
+			(Error < BestError + KINDA_SMALL_NUMBER && Distance < BestDistance))
+		{
+			BestRad      = AngleRad;
+			BestError    = Error;
+			BestDistance = Distance;
+		}
+	}
+
+	return BestRad;
+}
+
 void FRangeLimitedFABRIK::FABRIKForwardPass(
 	const TArray<FTransform>& InTransforms,
 	const TArray<FIKBoneConstraint*>& Constraints,
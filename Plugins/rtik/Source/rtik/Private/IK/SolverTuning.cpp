@@ -0,0 +1,258 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtik.h"
+#include "SolverTuning.h"
+#include "IK.h"
+#include "RangeLimitedFABRIK.h"
+#include "HAL/PlatformTime.h"
+
+#if WITH_EDITORONLY_DATA
+// Reference solves run with this fraction of the tightest candidate precision, and this multiple of the iteration limit
+static const float SolverTuningReferencePrecisionScale = 0.1f;
+static const int32 SolverTuningReferenceIterationScale = 10;
+
+// Largest effector distance (cm) and bone direction angle (degrees) between Transforms and ReferenceTransforms
+static void MeasureSolveError(const TArray<FTransform>& Transforms, const TArray<FTransform>& ReferenceTransforms,
+	float& OutEffectorError, float& OutJointAngleError)
+{
+	OutEffectorError   = FVector::Dist(Transforms.Last().GetLocation(), ReferenceTransforms.Last().GetLocation());
+	OutJointAngleError = 0.0f;
+
+	for (int32 i = 0; i < Transforms.Num() - 1; ++i)
+	{
+		FVector Direction          = (Transforms[i + 1].GetLocation() - Transforms[i].GetLocation()).GetSafeNormal();
+		FVector ReferenceDirection = (ReferenceTransforms[i + 1].GetLocation() - ReferenceTransforms[i].GetLocation()).GetSafeNormal();
+		float Cos                  = FMath::Clamp(FVector::DotProduct(Direction, ReferenceDirection), -1.0f, 1.0f);
+		OutJointAngleError         = FMath::Max(OutJointAngleError, FMath::RadiansToDegrees(FMath::Acos(Cos)));
+	}
+}
+
+static void SolveProblem(const FIKSolverProblem& Problem, const TArray<FIKBoneConstraint*>& Constraints,
+	float Precision, int32 MaxIterations, TArray<FTransform>& OutTransforms)
+{
+	FRangeLimitedFABRIK::SolveRangeLimitedFABRIK(
+		Problem.CSTransforms,
+		Constraints,
+		Problem.EffectorTargetCS,
+		OutTransforms,
+		Problem.MaxRootDragDistance,
+		Problem.RootDragStiffness,
+		Precision,
+		MaxIterations
+	);
+}
+#endif // WITH_EDITORONLY_DATA
+
+#pragma region UIKSolverRecording
+UIKSolverRecording::UIKSolverRecording()
+	:
+	bRecording(false),
+	RecordInterval(10),
+	MaxProblems(500),
+	TunedPrecision(0.0f),
+	TunedMaxIterations(0)
+{
+#if WITH_EDITORONLY_DATA
+	NumSolvesSeen = 0;
+#endif // WITH_EDITORONLY_DATA
+}
+
+void UIKSolverRecording::Record(const FIKSolverProblem& Problem, const TArray<UIKBoneConstraintWrapper*>& ChainConstraints)
+{
+	check(IsInGameThread());
+
+#if WITH_EDITORONLY_DATA
+	if (!bRecording || Problem.CSTransforms.Num() != ChainConstraints.Num())
+	{
+		return;
+	}
+
+	if (NumSolvesSeen++ % RecordInterval != 0)
+	{
+		return;
+	}
+
+	// A different chain invalidates what was recorded so far
+	bool bChainChanged = Constraints.Num() != ChainConstraints.Num();
+	for (int32 i = 0; i < Constraints.Num() && !bChainChanged; ++i)
+	{
+		bool bHadConstraint = Constraints[i] != nullptr;
+		bool bHasConstraint = ChainConstraints[i] != nullptr;
+		bChainChanged       = bHadConstraint != bHasConstraint ||
+			(bHasConstraint && Constraints[i]->GetClass() != ChainConstraints[i]->GetClass());
+	}
+
+	if (!bChainChanged && Problems.Num() >= MaxProblems)
+	{
+		return;
+	}
+
+	Modify();
+
+	if (bChainChanged)
+	{
+		Problems.Reset();
+		Constraints.Reset();
+		for (UIKBoneConstraintWrapper* Wrapper : ChainConstraints)
+		{
+			Constraints.Add(Wrapper != nullptr ? DuplicateObject<UIKBoneConstraintWrapper>(Wrapper, this) : nullptr);
+		}
+	}
+
+	Problems.Add(Problem);
+#endif // WITH_EDITORONLY_DATA
+}
+
+void UIKSolverRecording::ClearRecording()
+{
+#if WITH_EDITORONLY_DATA
+	Modify();
+	Problems.Reset();
+	Constraints.Reset();
+	NumSolvesSeen = 0;
+#endif // WITH_EDITORONLY_DATA
+}
+
+bool UIKSolverRecording::Tune()
+{
+#if WITH_EDITORONLY_DATA
+	if (Problems.Num() == 0 || TuningSettings.CandidatePrecisions.Num() == 0)
+	{
+#if ENABLE_IK_DEBUG
+		UE_LOG(LogRTIK, Warning, TEXT("Solver recording %s has nothing to tune"), *GetName());
+#endif // ENABLE_IK_DEBUG
+		return false;
+	}
+
+	Modify();
+
+	TArray<FIKBoneConstraint*> SolverConstraints;
+	for (UIKBoneConstraintWrapper* Wrapper : Constraints)
+	{
+		FIKBoneConstraint* Constraint = Wrapper != nullptr ? Wrapper->GetConstraint() : nullptr;
+		if (Constraint != nullptr)
+		{
+			Constraint->Initialize();
+		}
+		SolverConstraints.Add(Constraint);
+	}
+
+	// Converged solves to measure the candidates against
+	float ReferencePrecision = TuningSettings.CandidatePrecisions[0];
+	for (float Precision : TuningSettings.CandidatePrecisions)
+	{
+		ReferencePrecision = FMath::Min(ReferencePrecision, Precision);
+	}
+	ReferencePrecision *= SolverTuningReferencePrecisionScale;
+
+	TArray<TArray<FTransform>> References;
+	References.SetNum(Problems.Num());
+	for (int32 i = 0; i < Problems.Num(); ++i)
+	{
+		SolveProblem(Problems[i], SolverConstraints, ReferencePrecision,
+			TuningSettings.MaxIterationsLimit * SolverTuningReferenceIterationScale, References[i]);
+	}
+
+	auto MeetsTargets = [this, &SolverConstraints, &References](float Precision, int32 MaxIterations)
+	{
+		TArray<FTransform> Solved;
+		for (int32 i = 0; i < Problems.Num(); ++i)
+		{
+			SolveProblem(Problems[i], SolverConstraints, Precision, MaxIterations, Solved);
+
+			float EffectorError;
+			float JointAngleError;
+			MeasureSolveError(Solved, References[i], EffectorError, JointAngleError);
+			if (EffectorError > TuningSettings.MaxEffectorError || JointAngleError > TuningSettings.MaxJointAngleError)
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	bool bFound        = false;
+	double BestSeconds = MAX_dbl;
+
+	for (float Precision : TuningSettings.CandidatePrecisions)
+	{
+		// Fewest iterations meeting the targets at this precision
+		int32 MaxIterations = 1;
+		while (MaxIterations <= TuningSettings.MaxIterationsLimit && !MeetsTargets(Precision, MaxIterations))
+		{
+			++MaxIterations;
+		}
+
+		if (MaxIterations > TuningSettings.MaxIterationsLimit)
+		{
+			continue;
+		}
+
+		double Seconds = MAX_dbl;
+		TArray<FTransform> Solved;
+		for (int32 Run = 0; Run < TuningSettings.NumTimingRuns; ++Run)
+		{
+			double StartSeconds = FPlatformTime::Seconds();
+			for (const FIKSolverProblem& Problem : Problems)
+			{
+				SolveProblem(Problem, SolverConstraints, Precision, MaxIterations, Solved);
+			}
+			Seconds = FMath::Min(Seconds, FPlatformTime::Seconds() - StartSeconds);
+		}
+
+		if (Seconds < BestSeconds)
+		{
+			bFound             = true;
+			BestSeconds        = Seconds;
+			TunedPrecision     = Precision;
+			TunedMaxIterations = MaxIterations;
+		}
+	}
+
+#if ENABLE_IK_DEBUG
+	if (!bFound)
+	{
+		UE_LOG(LogRTIK, Warning, TEXT("No solver settings met the error targets of solver recording %s"), *GetName());
+	}
+#endif // ENABLE_IK_DEBUG
+
+	return bFound;
+#else
+	return false;
+#endif // WITH_EDITORONLY_DATA
+}
+#pragma endregion UIKSolverRecording
+
+#pragma region FIKSolverRecorder
+void FIKSolverRecorder::Capture(const UIKSolverRecording* Recording,
+	const TArray<FTransform>& CSTransforms,
+	const FVector& EffectorTargetCS,
+	float MaxRootDragDistance,
+	float RootDragStiffness)
+{
+#if WITH_EDITOR
+	if (Recording == nullptr || !Recording->bRecording)
+	{
+		return;
+	}
+
+	PendingProblem.CSTransforms        = CSTransforms;
+	PendingProblem.EffectorTargetCS    = EffectorTargetCS;
+	PendingProblem.MaxRootDragDistance = MaxRootDragDistance;
+	PendingProblem.RootDragStiffness   = RootDragStiffness;
+	bHasPendingProblem                 = true;
+#endif // WITH_EDITOR
+}
+
+void FIKSolverRecorder::Flush(UIKSolverRecording* Recording, const TArray<UIKBoneConstraintWrapper*>& ChainConstraints)
+{
+#if WITH_EDITOR
+	if (Recording != nullptr && bHasPendingProblem)
+	{
+		Recording->Record(PendingProblem, ChainConstraints);
+	}
+
+	bHasPendingProblem = false;
+#endif // WITH_EDITOR
+}
+#pragma endregion FIKSolverRecorder
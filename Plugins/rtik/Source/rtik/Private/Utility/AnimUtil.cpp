@@ -10,16 +10,26 @@
 // Get the world space location vector for a bone
 FVector FAnimUtil::GetBoneWorldLocation(USkeletalMeshComponent& SkelComp, FCSPose<FCompactPose>& MeshBases, FCompactPoseBoneIndex BoneIndex)
 {
-	FTransform BoneTransform = MeshBases.GetComponentSpaceTransform(BoneIndex);
-	FAnimationRuntime::ConvertCSTransformToBoneSpace(SkelComp.GetComponentTransform(), MeshBases, BoneTransform, BoneIndex, BCS_WorldSpace);
-	return BoneTransform.GetLocation();
+	return GetBoneWorldLocation(SkelComp.GetComponentTransform(), MeshBases, BoneIndex);
 }
 
 // Get the world space transform for a bone
 FTransform FAnimUtil::GetBoneWorldTransform(USkeletalMeshComponent& SkelComp, FCSPose<FCompactPose>& MeshBases, FCompactPoseBoneIndex BoneIndex)
+{
+	return GetBoneWorldTransform(SkelComp.GetComponentTransform(), MeshBases, BoneIndex);
+}
+
+FVector FAnimUtil::GetBoneWorldLocation(const FTransform& ComponentToWorld, FCSPose<FCompactPose>& MeshBases, FCompactPoseBoneIndex BoneIndex)
+{
+	FTransform BoneTransform = MeshBases.GetComponentSpaceTransform(BoneIndex);
+	FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentToWorld, MeshBases, BoneTransform, BoneIndex, BCS_WorldSpace);
+	return BoneTransform.GetLocation();
+}
+
+FTransform FAnimUtil::GetBoneWorldTransform(const FTransform& ComponentToWorld, FCSPose<FCompactPose>& MeshBases, FCompactPoseBoneIndex BoneIndex)
 {
 	FTransform BoneTransform = MeshBases.GetComponentSpaceTransform(BoneIndex);
-	FAnimationRuntime::ConvertCSTransformToBoneSpace(SkelComp.GetComponentTransform(), MeshBases, BoneTransform, BoneIndex, BCS_WorldSpace);
+	FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentToWorld, MeshBases, BoneTransform, BoneIndex, BCS_WorldSpace);
 	return BoneTransform;
 }
 
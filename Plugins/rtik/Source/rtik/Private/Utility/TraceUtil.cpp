@@ -18,15 +18,13 @@ bool UTraceUtil::LineTrace(
 	FHitResult& HitOut,
 	ECollisionChannel CollisionChannel,
 	bool ReturnPhysMat,
-	bool bEnableDebugDraw) 
+	bool bEnableDebugDraw,
+	bool bTraceComplex,
+	bool bReturnFaceIndex) 
 {
-	FCollisionQueryParams TraceParams(FName(TEXT("Line Trace")), true, ActorToIgnore);
-	TraceParams.bTraceComplex = true;
-	//TraceParams.bTraceAsyncScene = true;
-	TraceParams.bReturnPhysicalMaterial = ReturnPhysMat;
-	
-	//Ignore Actors
-	TraceParams.AddIgnoredActor(ActorToIgnore);
+	static const FName LineTraceTag(TEXT("Line Trace"));
+	FCollisionQueryParams TraceParams = MakeQueryParams(LineTraceTag, ActorToIgnore, ReturnPhysMat, 
+		bTraceComplex, bReturnFaceIndex);
 	
 	//Re-initialize hit info
 	HitOut = FHitResult(ForceInit);
@@ -56,3 +54,107 @@ bool UTraceUtil::LineTrace(
 
 	return bHitActor;
 }
+
+bool UTraceUtil::BoxSweep(
+	UWorld* World,
+	AActor* ActorToIgnore,
+	const FVector& Start,
+	const FVector& End,
+	const FQuat& Rotation,
+	const FVector& HalfExtent,
+	FHitResult& HitOut,
+	ECollisionChannel CollisionChannel,
+	bool ReturnPhysMat,
+	bool bEnableDebugDraw,
+	bool bTraceComplex,
+	bool bReturnFaceIndex)
+{
+	static const FName BoxSweepTag(TEXT("Box Sweep"));
+	FCollisionQueryParams TraceParams = MakeQueryParams(BoxSweepTag, ActorToIgnore, ReturnPhysMat, 
+		bTraceComplex, bReturnFaceIndex);
+
+	HitOut = FHitResult(ForceInit);
+
+	World->SweepSingleByChannel(
+		HitOut,
+		Start,
+		End,
+		Rotation,
+		CollisionChannel,
+		FCollisionShape::MakeBox(HalfExtent),
+		TraceParams
+	);
+
+	bool bHitActor = (HitOut.GetActor() != nullptr);
+
+#if WITH_EDITOR
+	if (bEnableDebugDraw)
+	{		
+		FDebugDrawUtil::DrawLine(World, Start, End, FColor(0, 255, 255));
+		if (bHitActor)
+		{
+			FDebugDrawUtil::DrawPlane(World, HitOut.ImpactPoint, HitOut.ImpactNormal, HalfExtent.X * 2.0f);
+		}
+	}
+#endif // WITH_EDITOR
+
+	return bHitActor;
+}
+
+FTraceHandle UTraceUtil::AsyncLineTrace(
+	UWorld* World,
+	AActor* ActorToIgnore,
+	const FVector& Start,
+	const FVector& End,
+	ECollisionChannel CollisionChannel,
+	bool ReturnPhysMat,
+	bool bTraceComplex,
+	bool bReturnFaceIndex)
+{
+	check(IsInGameThread());
+
+	static const FName AsyncLineTraceTag(TEXT("Async Line Trace"));
+	FCollisionQueryParams TraceParams = MakeQueryParams(AsyncLineTraceTag, ActorToIgnore, ReturnPhysMat,
+		bTraceComplex, bReturnFaceIndex);
+
+	return World->AsyncLineTraceByChannel(
+		EAsyncTraceType::Single,
+		Start,
+		End,
+		CollisionChannel,
+		TraceParams
+	);
+}
+
+bool UTraceUtil::QueryAsyncLineTrace(
+	UWorld* World,
+	const FTraceHandle& Handle,
+	FHitResult& HitOut)
+{
+	FTraceDatum TraceDatum;
+	if (World == nullptr || !Handle.IsValid() || !World->QueryTraceData(Handle, TraceDatum))
+	{
+		return false;
+	}
+
+	HitOut = TraceDatum.OutHits.Num() > 0 ? TraceDatum.OutHits[0] : FHitResult(ForceInit);
+	return true;
+}
+
+FCollisionQueryParams UTraceUtil::MakeQueryParams(
+	const FName& TraceTag,
+	AActor* ActorToIgnore,
+	bool ReturnPhysMat,
+	bool bTraceComplex,
+	bool bReturnFaceIndex)
+{
+	FCollisionQueryParams TraceParams(TraceTag, bTraceComplex, ActorToIgnore);
+	//TraceParams.bTraceAsyncScene = true;
+	TraceParams.bReturnPhysicalMaterial = ReturnPhysMat;
+	TraceParams.bReturnFaceIndex        = bReturnFaceIndex;
+
+	//Ignore Actors
+	TraceParams.AddIgnoredActor(ActorToIgnore);
+
+	return TraceParams;
+}
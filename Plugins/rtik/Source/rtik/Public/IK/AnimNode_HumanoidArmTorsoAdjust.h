@@ -32,6 +32,10 @@
 *   between the two twists; if it is set closer to 1.0, the large-magnitude twist is favored; if it is set closer to
 *   0.0, the small-magnitude twist is favored. So, setting this higher will make the torso twist more. You shoulder
 *   usually just leave it at 0.5.
+*
+* - TorsoSolver - The shoulder displacements can instead be estimated in closed form, from each arm's reach and the
+*   distance to its target. This skips FABRIK entirely, and is much cheaper; arm constraints are ignored, since the 
+*   arms themselves are not IKed here.
 */
 
 
@@ -55,6 +59,19 @@ enum class EHumanoidArmTorsoIKMode : uint8
 	IK_Human_ArmTorso_BothArms UMETA(DisplayName = "IK both arms"),
 };
 
+/*
+* How to find the shoulder displacements that drive the torso rotation
+*/
+UENUM(BlueprintType)
+enum class EHumanoidArmTorsoSolver : uint8
+{
+	// Run FABRIK on each arm, dragging the shoulder. Respects arm constraints.
+	IK_Human_ArmTorso_Solver_FABRIK UMETA(DisplayName = "Range-Limited FABRIK"),
+
+	// Move each shoulder toward its target by however far the target is out of the arm's reach. Much cheaper.
+	IK_Human_ArmTorso_Solver_Analytic UMETA(DisplayName = "Analytic Estimate")
+};
+
 
 /*
 * Rotates the torso and shoulders to prepare for IK.
@@ -79,6 +96,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
 	bool bEnableDebugDraw;
 
+	// How shoulder displacements are found. Precision and MaxIterations only apply to FABRIK.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver)
+	EHumanoidArmTorsoSolver TorsoSolver;
+
 	// How precise the FABRIK solver should be. Iteration will cease when effector is within this distance of 
     // the target. Set lower for more accurate IK, but potentially greater cost.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver)
@@ -165,12 +186,21 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Effector, meta = (PinHiddenByDefault))
 	TEnumAsByte<EBoneRotationSource> EffectorRotationSource;
 
+	// Drop output bones the IK barely changed before they are blended into the pose. See FIKCommitSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKCommitSettings CommitSettings;
+
+	// Skip this node entirely while a curve, or the node's alpha, is low. See FIKGateSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKGateSettings GateSettings;
+
 public:
 
 	FAnimNode_HumanoidArmTorsoAdjust()
 		:
 		Mode(EHumanoidArmTorsoIKMode::IK_Human_ArmTorso_Disabled),
 		bEnableDebugDraw(false),
+		TorsoSolver(EHumanoidArmTorsoSolver::IK_Human_ArmTorso_Solver_FABRIK),
 		DeltaTime(0.0f),
 		Precision(0.001f),
 		MaxIterations(10),
@@ -193,6 +223,11 @@ public:
 		LastRotationOffset(FQuat::Identity)
 	{ }
 
+	// FAnimNode_Base interface
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
+	// End FAnimNode_Base interface
+
 	// FAnimNode_SkeletalControlBase Interface
 	virtual void UpdateInternal(const FAnimationUpdateContext& Context) override;
 	virtual void EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, TArray<FBoneTransform>& OutBoneTransforms) override;
@@ -202,7 +237,18 @@ public:
 	// End FAnimNode_SkeletalControlBase Interface
 
 protected:
+
+	// Closed-form estimate of the shoulder displacement FABRIK would produce with shoulder dragging: the shoulder moves 
+	// toward the target by however far the target is beyond the arm's reach, scaled by stiffness and clamped to the max drag
+	FVector EstimateShoulderDisplacement(const TArray<FTransform>& ArmCSTransforms, const FVector& TargetCS) const;
+
 	float DeltaTime;
 	FVector LastEffectorOffset;
 	FQuat LastRotationOffset;
+
+	// Captured in PreUpdate for use during evaluation
+	FIKNodeSnapshot Snapshot;
+
+	// Tracks whether GateSettings let the node run
+	FIKGate Gate;
 };
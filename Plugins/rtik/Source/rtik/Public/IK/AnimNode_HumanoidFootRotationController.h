@@ -38,7 +38,15 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
 	bool bEnableDebugDraw;
-   
+
+	// Drop output bones the IK barely changed before they are blended into the pose. See FIKCommitSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKCommitSettings CommitSettings;
+
+	// Skip this node entirely while a curve, or the node's alpha, is low. See FIKGateSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKGateSettings GateSettings;
+
 public:
 
 	FAnimNode_HumanoidFootRotationController()
@@ -50,6 +58,11 @@ public:
 		bInterpolateRotation(true)
 	{ }
 
+	// FAnimNode_Base interface
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
+	// End FAnimNode_Base interface
+
 	// FAnimNode_SkeletalControlBase Interface
 	virtual void UpdateInternal(const FAnimationUpdateContext & Context);
 	virtual void EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, TArray<FBoneTransform>& OutBoneTransforms) override;
@@ -61,4 +74,10 @@ public:
 protected:
 	float DeltaTime;
 	FQuat LastRotationOffset;
+
+	// Captured in PreUpdate for use during evaluation
+	FIKNodeSnapshot Snapshot;
+
+	// Tracks whether GateSettings let the node run
+	FIKGate Gate;
 };
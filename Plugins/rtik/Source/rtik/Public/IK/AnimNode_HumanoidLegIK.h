@@ -5,6 +5,9 @@
 #include "CoreMinimal.h"
 #include "IK.h"
 #include "HumanoidIK.h"
+#include "BasePoseCache.h"
+#include "CrowdSolver.h"
+#include "SolverTuning.h"
 #include "BoneControllers/AnimNode_SkeletalControlBase.h"
 #include "AnimNode_HumanoidLegIK.generated.h"
 
@@ -28,7 +31,11 @@ enum class EHumanoidLegIKSolver: uint8
 	IK_Human_Leg_Solver_FABRIK UMETA(DisplayName = "Range-Limited FABRIK"),
 	
 	// Two-bone - No constraint support, simple, fast
-	IK_Human_Leg_Solver_TwoBone UMETA(DisplayName = "Two-Bone")
+	IK_Human_Leg_Solver_TwoBone UMETA(DisplayName = "Two-Bone"),
+
+	// Two-bone, keeping the knee pointed the way it was before IK. Does the job of the knee correction node as part
+	// of the solve, so legs using it don't need one. No constraint support.
+	IK_Human_Leg_Solver_TwoBoneKneeAware UMETA(DisplayName = "Two-Bone, Knee-Aware")
 };
 
 
@@ -49,6 +56,12 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Links)
 	FComponentSpacePoseLink BaseComponentPose;
 
+	// Optional cache shared with the other leg IK and knee correction nodes of this character. If set, the base pose
+	// is evaluated once per frame for all of them, instead of once by each node. All nodes sharing the cache must have
+	// the same base pose.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Links, meta = (PinHiddenByDefault))
+	UIKBasePoseCache_Wrapper* BasePoseCache;
+
 	// The leg on which IK is applied
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bones, meta = (PinShownByDefault))
 	UHumanoidLegChain_Wrapper* Leg;
@@ -86,6 +99,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver)
 	EHumanoidLegIKSolver Solver;
 
+	// Records this node's FABRIK solves, for tuning Precision and MaxIterations offline. See UIKSolverRecording.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver, meta = (PinHiddenByDefault))
+	UIKSolverRecording* SolverRecording;
+
 	// How to handle rotation of the effector (the foot). If set to No Change, the foot will maintain the same
 	// rotation as before IK. If set to Maintain Local, it will maintain the same rotation relative to the parent
 	// as before IK. Copy Target Rotation is the same as No Change for now.	
@@ -111,11 +128,51 @@ public:
 	// from having an effect 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
 	float MinimumEffectorDelta;
-	
+
+	// Lock the foot in place in world space while it's planted, to stop it sliding. While locked, the ground isn't 
+	// traced and the leg is solved toward the locked location; FABRIK starts from the last solve (except with the 
+	// crowd solver). Only used in Normal Locomotion mode.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	FHumanoidLegPlantLockSettings PlantLock;
+
+	// Curve holding this foot's height above the root in the base pose, baked into the animations with the
+	// IKBakeFootHeight commandlet (e.g., IKFootHeight_foot_l). While the curve is present, it's used instead of 
+	// evaluating the base pose, which is the most expensive part of locomotion IK. The curve value comes from the
+	// previous frame's pose, like all anim instance curves. Needs FootHeightWeightCurveName.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FName FootHeightCurveName;
+
+	// Weight curve baked alongside FootHeightCurveName (e.g., IKFootHeightWeight_foot_l). It's 1 while only baked
+	// animations play, and drops while they blend with unbaked ones, scaling the height down with it. The baked height
+	// is only used while the weight is about 1; otherwise the base pose is evaluated.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FName FootHeightWeightCurveName;
+
+	// Solve only every Nth frame, with N picked by LOD level. In between, the hip and knee rotations from the
+	// last solve are re-applied (and interpolated) without tracing or solving. Useful for distant characters.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKReducedRateSettings ReducedRate;
+
+	// Hand FABRIK solves to the world's crowd solver, which solves every character's legs together in a background task
+	// at the end of the frame. The leg is posed with the solve from the previous frame, re-applied as hip and knee 
+	// rotations, so IK lags the animation by a frame. Useful with many characters on screen. Only used with the FABRIK 
+	// solver. See FIKCrowdSolver for how to measure whether it helps.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	bool bUseCrowdSolver;
+
+	// Drop output bones the IK barely changed before they are blended into the pose. See FIKCommitSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKCommitSettings CommitSettings;
+
+	// Skip this node entirely while a curve, or the node's alpha, is low. See FIKGateSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKGateSettings GateSettings;
+
 public:
 
 	FAnimNode_HumanoidLegIK()
 		:
+		BasePoseCache(nullptr),
 		bEnableDebugDraw(false),
 		DeltaTime(0.0f),
 		FootTargetWorld(FVector(0.0f, 0.0f, 0.0f)),
@@ -124,12 +181,38 @@ public:
 		bEnable(true),
 		Mode(EHumanoidLegIKMode::IK_Human_Leg_Locomotion),
 		Solver(EHumanoidLegIKSolver::IK_Human_Leg_Solver_FABRIK),
+		SolverRecording(nullptr),
 		EffectorRotationSource(EBoneRotationSource::BRS_KeepComponentSpaceRotation),
 		EffectorVelocity(300.0f),
 		bEffectorMovesInstantly(false),
-		LastEffectorOffset(0.0f, 0.0f, 0.0f)
+		FootHeightCurveName(NAME_None),
+		FootHeightWeightCurveName(NAME_None),
+		bUseCrowdSolver(false),
+		LastEffectorOffset(0.0f, 0.0f, 0.0f),
+		LODLevel(0),
+		bHasSolvedDeltas(false),
+		CurrentHipDelta(FQuat::Identity),
+		CurrentKneeDelta(FQuat::Identity),
+		TargetHipDelta(FQuat::Identity),
+		TargetKneeDelta(FQuat::Identity),
+		PlantCurveValue(0.0f),
+		PlantDeltaTime(0.0f),
+		LastFootWS(ForceInitToZero),
+		bHasLastFootWS(false),
+		bPlantLocked(false),
+		LockedFootTargetWS(ForceInitToZero),
+		bHasPlantDeltas(false),
+		PlantHipDelta(FQuat::Identity),
+		PlantKneeDelta(FQuat::Identity),
+		BakedFootHeight(0.0f),
+		bHasBakedFootHeight(false)
 	{ }
 
+	// FAnimNode_Base interface
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
+	// End FAnimNode_Base interface
+
 	// FAnimNode_SkeletalControlBase Interface
 	virtual void Initialize_AnyThread(const FAnimationInitializeContext& Context) override;
 	virtual void CacheBones_AnyThread(const FAnimationCacheBonesContext& Context) override;
@@ -144,4 +227,53 @@ public:
 protected:
 	float DeltaTime;
 	FVector LastEffectorOffset;
+
+	// Reduced-rate evaluation state. Target deltas are the result of the last full solve; current deltas 
+	// are what was actually applied last frame.
+	int32 LODLevel;
+	FIKReducedRateCounter ReducedRateCounter;
+	bool bHasSolvedDeltas;
+	FQuat CurrentHipDelta;
+	FQuat CurrentKneeDelta;
+	FQuat TargetHipDelta;
+	FQuat TargetKneeDelta;
+
+	// Moves the current deltas toward the target deltas, and applies them to the incoming leg transforms. Once the
+	// current deltas are back to identity, bHasSolvedDeltas is cleared.
+	void ApplySolvedDeltas(FCSPose<FCompactPose>& Pose, const FTransform& HipCSTransform, 
+		const FTransform& KneeCSTransform, const FTransform& FootCSTransform, TArray<FBoneTransform>& OutBoneTransforms);
+
+	// Plant lock state. The curve is read on the game thread in PreUpdate. Plant deltas are the hip and knee 
+	// rotations from the last solve while locked, used to start the next one.
+	float PlantCurveValue;
+	float PlantDeltaTime;
+	FVector LastFootWS;
+	bool bHasLastFootWS;
+	bool bPlantLocked;
+	FVector LockedFootTargetWS;
+	bool bHasPlantDeltas;
+	FQuat PlantHipDelta;
+	FQuat PlantKneeDelta;
+
+	// Tracks the animated foot, and releases the plant lock once the foot lifts off or drifts too far.
+	// @return - true if the foot is planted this frame
+	bool UpdatePlantLock(const FVector& FootWS);
+
+	void ReleasePlantLock();
+
+	// Value of FootHeightCurveName, read on the game thread in PreUpdate. Only set if the weight curve allowed it.
+	float BakedFootHeight;
+	bool bHasBakedFootHeight;
+
+	// Where the crowd solver writes this leg's results. Created on first use.
+	TSharedPtr<FIKCrowdSolveSlot, ESPMode::ThreadSafe> CrowdSolveSlot;
+
+	// Captured in PreUpdate for use during evaluation
+	FIKNodeSnapshot Snapshot;
+
+	// Tracks whether GateSettings let the node run
+	FIKGate Gate;
+
+	// Hands solves to SolverRecording
+	FIKSolverRecorder SolverRecorder;
 };
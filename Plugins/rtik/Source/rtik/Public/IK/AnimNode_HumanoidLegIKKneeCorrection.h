@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "HumanoidIK.h"
+#include "BasePoseCache.h"
 #include "BoneControllers/AnimNode_SkeletalControlBase.h"
 #include "AnimNode_HumanoidLegIKKneeCorrection.generated.h"
 
@@ -16,6 +17,8 @@
 * The corrected knee angle is determined by comparing the direction of the foot and knee in the
 * original animation. Therefore, the corrected angle should blend seamlessly with the original
 * animation, without creating an awkward or stiff look.
+*
+* Not needed after a leg IK node using the knee-aware two-bone solver, which keeps the knee angle as part of the solve.
 */
 USTRUCT()
 struct RTIK_API FAnimNode_HumanoidLegIKKneeCorrection : public FAnimNode_SkeletalControlBase
@@ -29,6 +32,12 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Links)
 	FComponentSpacePoseLink BaseComponentPose;
 
+	// Optional cache shared with the other leg IK and knee correction nodes of this character. If set, the base pose
+	// is evaluated once per frame for all of them, instead of once by each node. All nodes sharing the cache must have
+	// the same base pose.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Links, meta = (PinHiddenByDefault))
+	UIKBasePoseCache_Wrapper* BasePoseCache;
+
 	// The leg on which IK is applied
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bones, meta = (PinShownByDefault))
 	UHumanoidLegChain_Wrapper* Leg;
@@ -36,14 +45,28 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
 	bool bEnableDebugDraw;
 
+	// Drop output bones the IK barely changed before they are blended into the pose. See FIKCommitSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKCommitSettings CommitSettings;
+
+	// Skip this node entirely while a curve, or the node's alpha, is low. See FIKGateSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKGateSettings GateSettings;
+
 public:
 
 	FAnimNode_HumanoidLegIKKneeCorrection()
 		:
+		BasePoseCache(nullptr),
 		bEnableDebugDraw(false),
 		DeltaTime(0.0f)
 	{ }
 
+	// FAnimNode_Base interface
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
+	// End FAnimNode_Base interface
+
 	// FAnimNode_SkeletalControlBase Interface
 	virtual void Initialize_AnyThread(const FAnimationInitializeContext& Context) override;
 	virtual void CacheBones_AnyThread(const FAnimationCacheBonesContext& Context) override;
@@ -59,4 +82,9 @@ public:
 protected:
 	float DeltaTime;
 
+	// Captured in PreUpdate for use during evaluation
+	FIKNodeSnapshot Snapshot;
+
+	// Tracks whether GateSettings let the node run
+	FIKGate Gate;
 };
\ No newline at end of file
@@ -0,0 +1,205 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IK.h"
+#include "HumanoidIK.h"
+#include "AnimNode_HumanoidLegIK.h"
+#include "BoneControllers/AnimNode_SkeletalControlBase.h"
+#include "AnimNode_HumanoidLocomotionIK.generated.h"
+
+/*
+* State kept between frames for one leg of FAnimNode_HumanoidLocomotionIK
+*/
+struct RTIK_API FHumanoidLocomotionLegState
+{
+	// Trace data, when the node traces for itself
+	FHumanoidIKTraceData TraceData;
+	FHumanoidLegGroundSolution Ground;
+
+	// Set during evaluation; traced from in the next PreUpdate, when the node traces for itself
+	FHumanoidLegTraceEndpoints QueryEndpointsCS;
+	bool bRequestQuery;
+
+	FVector LastEffectorOffset;
+	FQuat LastRotationOffset;
+
+	FHumanoidLocomotionLegState()
+		:
+		bRequestQuery(false),
+		LastEffectorOffset(0.0f, 0.0f, 0.0f),
+		LastRotationOffset(FQuat::Identity)
+	{ }
+};
+
+/*
+* Humanoid locomotion IK for both legs and the pelvis, in a single node. Does the same steps as the usual chain of
+* IK Humanoid Leg Trace (x2), IK Biped Hip Adjustment, IK Humanoid Leg (x2), knee correction (x2) and
+* foot rotation (x2), in locomotion mode, but reads the bones it needs once, and writes all of its bone
+* transforms in one pass.
+*
+* This is a separate implementation of those steps, not a drop-in replacement for the chain: it has not been checked 
+* for pose equivalence with it, nor benchmarked against it. Reduced-rate evaluation, plant locking and baked foot 
+* height curves are not supported. Compare the poses, and the "IK Humanoid Locomotion IK Eval" stat against the 
+* chain's node stats (stat anim), before switching a character over.
+*
+* The input pose is used as the base (pre-IK) pose. If trace data wrappers are given, ground is read from them,
+* so they can be updated by trace nodes with async or batched traces, ground caching, etc. Otherwise this node
+* does its own synchronous traces in PreUpdate, from where the feet were in the previous evaluation, so its ground
+* lags the pose by a frame.
+*/
+USTRUCT()
+struct RTIK_API FAnimNode_HumanoidLocomotionIK : public FAnimNode_SkeletalControlBase
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bones, meta = (PinShownByDefault))
+	UHumanoidLegChain_Wrapper* LeftLeg;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bones, meta = (PinShownByDefault))
+	UHumanoidLegChain_Wrapper* RightLeg;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Bones, meta = (PinShownByDefault))
+	UIKBoneWrapper* PelvisBone;
+
+	// Optional. If set, ground for the left leg is read from here instead of traced by this node.
+	// Use an IK Humanoid Leg Trace node earlier in the graph to update it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trace, meta = (PinHiddenByDefault))
+	UHumanoidIKTraceData_Wrapper* LeftLegTraceData;
+
+	// Optional. If set, ground for the right leg is read from here instead of traced by this node.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trace, meta = (PinHiddenByDefault))
+	UHumanoidIKTraceData_Wrapper* RightLegTraceData;
+
+	// Which queries to use when this node traces for itself. Can vary by LOD.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trace)
+	FIKGroundQueryQualitySettings QueryQuality;
+
+	// Maximum height the pelvis will move to let the legs reach the floor. Will transition back to base pose if the
+	// required adjustment is larger than this. Also extends the traces.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (PinShownByDefault))
+	float MaxPelvisAdjustSize;
+
+	// How quickly the pelvis moves to match floor height
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (PinHiddenByDefault))
+	float PelvisAdjustVelocity;
+
+	// Which solver to use for each leg
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver)
+	EHumanoidLegIKSolver Solver;
+
+	// FABRIK solver precision. See FAnimNode_HumanoidLegIK.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver)
+	float Precision;
+
+	// Max number of FABRIK iterations. See FAnimNode_HumanoidLegIK.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver)
+	int32 MaxIterations;
+
+	// How quickly the feet move toward their targets. Only used if bEffectorMovesInstantly is false.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	float EffectorVelocity;
+
+	// If true, the feet snap to their targets instead of moving at EffectorVelocity
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bEffectorMovesInstantly;
+
+	// Return the knees to the angle they had in the base pose after IK. See FAnimNode_HumanoidLegIKKneeCorrection.
+	// Not needed with the knee-aware solver, which does this itself.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bEnableKneeCorrection;
+
+	// Rotate the feet to match the floor slope. See FAnimNode_HumanoidFootRotationController.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bEnableFootRotation;
+
+	// If true, feet rotate toward the floor slope at RotationSlerpSpeed. If false, they snap to it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bInterpolateRotation;
+
+	// How quickly the feet rotate (using Slerp). Only used if bInterpolateRotation is true.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (PinHiddenByDefault))
+	float RotationSlerpSpeed;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bEnableDebugDraw;
+
+	// Drop output bones the IK barely changed before they are blended into the pose. See FIKCommitSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKCommitSettings CommitSettings;
+
+	// Skip this node entirely while a curve, or the node's alpha, is low. See FIKGateSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKGateSettings GateSettings;
+
+public:
+
+	FAnimNode_HumanoidLocomotionIK()
+		:
+		LeftLegTraceData(nullptr),
+		RightLegTraceData(nullptr),
+		MaxPelvisAdjustSize(40.0f),
+		PelvisAdjustVelocity(150.0f),
+		Solver(EHumanoidLegIKSolver::IK_Human_Leg_Solver_FABRIK),
+		Precision(0.001f),
+		MaxIterations(10),
+		EffectorVelocity(300.0f),
+		bEffectorMovesInstantly(false),
+		bEnableKneeCorrection(true),
+		bEnableFootRotation(true),
+		bInterpolateRotation(true),
+		RotationSlerpSpeed(20.0f),
+		bEnableDebugDraw(false),
+		DeltaTime(0.0f),
+		LODLevel(0),
+		LastPelvisOffset(0.0f, 0.0f, 0.0f)
+	{ }
+
+	// FAnimNode_Base interface
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
+	// End FAnimNode_Base interface
+
+	// FAnimNode_SkeletalControlBase Interface
+	virtual void UpdateInternal(const FAnimationUpdateContext& Context) override;
+	virtual void EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, TArray<FBoneTransform>& OutBoneTransforms) override;
+	virtual bool IsValidToEvaluate(const USkeleton* Skeleton, const FBoneContainer& RequiredBones) override;
+	virtual void InitializeBoneReferences(const FBoneContainer& RequiredBones) override;
+	// End FAnimNode_SkeletalControlBase Interface
+
+protected:
+
+	// Traces the ground for one leg on the game thread, if it has no trace data wrapper and evaluation asked for it
+	void QueryGround(UHumanoidLegChain_Wrapper* Leg,
+		UHumanoidIKTraceData_Wrapper* TraceDataWrapper,
+		FHumanoidLocomotionLegState& State);
+
+	// Finds the ground for one leg, from its trace data wrapper if set, otherwise from the last PreUpdate query
+	void FindGround(FCSPose<FCompactPose>& Pose,
+		UHumanoidLegChain_Wrapper& Leg,
+		UHumanoidIKTraceData_Wrapper* TraceDataWrapper,
+		FHumanoidLocomotionLegState& State);
+
+	// Solves one leg, after the pelvis has moved by PelvisOffsetCS, and adds its bone transforms to OutBoneTransforms
+	void SolveLeg(ACharacter* Character,
+		FCSPose<FCompactPose>& Pose,
+		UHumanoidLegChain_Wrapper& Leg,
+		const FVector& PelvisOffsetCS,
+		FHumanoidLocomotionLegState& State,
+		TArray<FBoneTransform>& OutBoneTransforms);
+
+	float DeltaTime;
+	int32 LODLevel;
+	FVector LastPelvisOffset;
+	FHumanoidLocomotionLegState LeftLegState;
+	FHumanoidLocomotionLegState RightLegState;
+
+	// Captured in PreUpdate for use during evaluation
+	FIKNodeSnapshot Snapshot;
+
+	// Tracks whether GateSettings let the node run
+	FIKGate Gate;
+};
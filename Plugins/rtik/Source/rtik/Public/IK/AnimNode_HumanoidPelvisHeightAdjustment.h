@@ -57,6 +57,19 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
 	bool bEnableDebugDraw;
 
+	// Recompute the target pelvis height only every Nth frame, with N picked by LOD level. In between, the pelvis
+	// keeps moving toward the last target, without reading trace data.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKReducedRateSettings ReducedRate;
+
+	// Drop output bones the IK barely changed before they are blended into the pose. See FIKCommitSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKCommitSettings CommitSettings;
+
+	// Skip this node entirely while a curve, or the node's alpha, is low. See FIKGateSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKGateSettings GateSettings;
+
 public:
 
 	FAnimNode_HumanoidPelvisHeightAdjustment()
@@ -65,9 +78,17 @@ public:
 		LastPelvisOffset(0.0f, 0.0f, 0.0f),
 		PelvisAdjustVelocity(150.0f),
 		MaxPelvisAdjustSize(50.0),
-		bEnableDebugDraw(false)
+		bEnableDebugDraw(false),
+		LODLevel(0),
+		LastTargetPelvisDelta(0.0f),
+		bLastReturnToCenter(true)
 	{ }
 
+	// FAnimNode_Base interface
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
+	// End FAnimNode_Base interface
+
 	// FAnimNode_SkeletalControlBase Interface
 	virtual void UpdateInternal(const FAnimationUpdateContext& Context) override;
 	virtual void EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, TArray<FBoneTransform>& OutBoneTransforms) override;
@@ -79,4 +100,16 @@ public:
 protected:
 	float DeltaTime;
 	FVector LastPelvisOffset;
+
+	// Reduced-rate evaluation state; the target found on the last full solve
+	int32 LODLevel;
+	FIKReducedRateCounter ReducedRateCounter;
+	float LastTargetPelvisDelta;
+	bool bLastReturnToCenter;
+
+	// Captured in PreUpdate for use during evaluation
+	FIKNodeSnapshot Snapshot;
+
+	// Tracks whether GateSettings let the node run
+	FIKGate Gate;
 };
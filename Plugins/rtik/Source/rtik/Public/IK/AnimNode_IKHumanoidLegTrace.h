@@ -4,7 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "HumanoidIK.h"
+#include "GroundHeightField.h"
 #include "Animation/AnimNodeBase.h"
+#include "WorldCollision.h"
 #include "AnimNode_IKHumanoidLegTrace.generated.h"
 
 
@@ -20,6 +22,12 @@
 // trace data is stored in a wrapper passed in by pointer. During the execution of this node,
 // trace data is store in the TraceData input; you can then re-use this wrapper object
 // later in your AnimGraph.
+//
+// Ground is never queried during evaluation, which may run on a worker thread. Evaluation records where the feet
+// are, and the next PreUpdate queries the ground there on the game thread (relative to where the component is 
+// then), so ground is one frame behind the pose. With bUseAsyncTrace, traces are requested from PreUpdate and 
+// the results are collected on the following frame instead. With bBatchTraces, the traces of all nodes in the 
+// world are gathered by FIKGroundQueryService and submitted together.
 USTRUCT()
 struct RTIK_API FAnimNode_IKHumanoidLegTrace : public FAnimNode_SkeletalControlBase
 {
@@ -38,6 +46,13 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trace, meta = (PinShownByDefault))
 	UHumanoidIKTraceData_Wrapper* TraceData;
 
+	// Optional height field around the character. If set, foot and toe traces are answered from the height 
+	// field where it has samples, and only fall back to real traces where it doesn't. Share one 
+	// height field between all legs of a character. The height field is traced asynchronously from PreUpdate,
+	// with the QueryQuality of this node.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trace, meta = (PinHiddenByDefault))
+	UIKGroundHeightField_Wrapper* HeightField;
+
 	// Maximum height above the floor to do pelvis adjustment. Will transition back to base pose if the 
 	// required hip adjustment is larger than this value. Should probably be something like 1 / 3 character capsule height
     // (more if you're brave)
@@ -47,14 +62,94 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
 	bool bEnableDebugDraw;
 
+	// Accuracy of ground queries: line traces or a foot sweep, complex or simple collision, and which extra
+	// hit information to return. Can vary by LOD, so nearby characters can use accurate queries and crowds cheap ones.
+	// Async and batched traces always use line traces.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trace)
+	FIKGroundQueryQualitySettings QueryQuality;
+
+	// Trace only every Nth frame, with N picked by LOD level. In between, the last trace results are reused.
+	// Should usually match the reduced-rate settings of the nodes that use this trace data.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKReducedRateSettings ReducedRate;
+
+	// If true, traces are requested asynchronously in PreUpdate, using the foot positions from the last evaluation.
+	// Results are picked up on the next frame, so the game thread never blocks on a physics query, but trace data
+	// is another frame behind. Until the first results arrive, the ground is queried synchronously in PreUpdate.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	bool bUseAsyncTrace;
+
+	// If true, async traces are handed to the world's ground query service instead of being requested
+	// directly. The service submits the traces from all nodes together once per frame, which is cheaper 
+	// when there are many characters. Only used if bUseAsyncTrace is set.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	bool bBatchTraces;
+
+	// Reuse trace results while the foot barely moves. New traces are answered by projecting onto the last hit plane.
+	// The cache hit rate can be read from the trace data wrapper.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FHumanoidLegGroundCacheSettings GroundCacheSettings;
+
+	// Share ground hits on static geometry with other characters in the world, through a world-wide spatial hash
+	// (see FIKGroundSampleHash). Useful for crowds walking over the same floor. Not used by async or batched traces.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	bool bUseSharedGroundSamples;
+
+	// Answer ground queries over landscapes from the landscape heightfield directly, instead of tracing
+	// (see FIKLandscapeGroundProvider). Landscape is baked on the game thread when first hit; until then, and where
+	// props stand on it, physics traces are used. Objects moving over the landscape are not seen. Not used by async 
+	// or batched traces.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	bool bUseLandscapeGroundProvider;
+
+	// Answer ground queries from ground data baked offline for static levels (see AIKBakedGroundVolume), where
+	// the current level has any. Asked before the landscape provider. Not used by async or batched traces.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	bool bUseBakedGround;
+
+	// Probe the ground once per step, where the foot is predicted to plant, instead of every frame below the foot. 
+	// The plant location is predicted from root velocity and the foot's animated velocity when the foot lifts off. 
+	// While the foot is in the air, the plant probe result is used. Not used by async or batched traces.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FHumanoidLegFootfallPredictionSettings FootfallPrediction;
+
+	// Skip this node's queries while a curve, or the node's alpha, is low; the last trace data is held in world space
+	// meanwhile. See FIKGateSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKGateSettings GateSettings;
+
 public:
 
 	FAnimNode_IKHumanoidLegTrace()
 		:
+		HeightField(nullptr),
 		bEnableDebugDraw(false),
-		MaxPelvisAdjustSize(40.0f)
+		MaxPelvisAdjustSize(40.0f),
+		bUseAsyncTrace(false),
+		bBatchTraces(false),
+		bUseSharedGroundSamples(false),
+		bUseLandscapeGroundProvider(false),
+		bUseBakedGround(false),
+		LODLevel(0),
+		bQueryFrame(true),
+		bRequestQuery(false),
+		bHasQueryResults(false),
+		bWasPlantLocked(false),
+		LastNumQueryResults(0),
+		RootVelocityWS(ForceInitToZero),
+		PredictionDeltaTime(0.0f),
+		LastFootLocationCS(ForceInitToZero),
+		bHasLastFootLocation(false),
+		bInSwing(false),
+		PlantProbeDistance(0.0f),
+		TraceDataComponentToWorld(FTransform::Identity)
 	{ }
 
+	// FAnimNode_Base interface
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
+	// End FAnimNode_Base interface
+
 protected: 
 
 	// FAnimNode_SkeletalControlBase interface
@@ -64,4 +159,79 @@ protected:
 	virtual bool IsValidToEvaluate(const USkeleton* Skeleton, const FBoneContainer& RequiredBones) override;
 	// End FAnimNode_SkeletalControlBase Interface
 
+	int32 LODLevel;
+
+	// Ticked in PreUpdate. bQueryFrame is false on frames where evaluation reuses the previous results.
+	FIKReducedRateCounter ReducedRateCounter;
+	bool bQueryFrame;
+
+	// Trace endpoints from the last evaluation, to be queried in the next PreUpdate
+	FHumanoidLegTraceEndpoints QueryEndpointsCS;
+	bool bRequestQuery;
+
+	// Handles for traces in flight. Results are only available on the frame after the request.
+	FTraceHandle FootTraceHandle;
+	FTraceHandle ToeTraceHandle;
+
+	// True once queries made in PreUpdate have filled in the trace data
+	bool bHasQueryResults;
+
+	// True if the trace data was held for a plant-locked foot on the last evaluation. When the lock is released, 
+	// the query results are cleared, so the first query after lift-off is synchronous.
+	bool bWasPlantLocked;
+
+	// World-space endpoints of the async traces in flight, and the number of batched results seen so far
+	FHumanoidLegTraceEndpoints PendingTraceEndpointsWS;
+	int32 LastNumQueryResults;
+
+	FHumanoidLegGroundCache GroundCache;
+
+	// Component transform, world and owner, captured in PreUpdate for use during evaluation
+	FIKNodeSnapshot Snapshot;
+
+	// Tracks whether GateSettings let the node run
+	FIKGate Gate;
+
+	// Answers both traces from the height field into the trace data, if it covers them
+	bool QueryHeightField(const FHumanoidLegTraceEndpoints& EndpointsWS);
+
+	// Picks up the async or batched traces requested last frame. Game thread only.
+	void CollectAsyncTraces(UWorld* World);
+
+	// Requests async or batched traces, or answers from the ground cache. Game thread only.
+	void RequestAsyncTraces(UWorld* World, AActor* Owner, const FHumanoidLegTraceEndpoints& EndpointsWS);
+
+	// Queries the ground synchronously into the trace data: footfall prediction, ground cache, providers and
+	// traces, as enabled. Also used by async nodes until their first results arrive. Game thread only.
+	void QueryGround(const FHumanoidLegTraceEndpoints& EndpointsWS);
+
+	// Probes the ground synchronously, through the shared ground sample hash if enabled.
+	// OutTraceData is in the space of ComponentToWorld.
+	void ProbeGround(const FTransform& ComponentToWorld,
+		const FHumanoidLegTraceEndpoints& EndpointsWS, 
+		FHumanoidIKTraceData& OutTraceData);
+
+	// Footfall prediction state. Root velocity is read on the game thread in PreUpdate.
+	FVector RootVelocityWS;
+	float PredictionDeltaTime;
+	FVector LastFootLocationCS;
+	bool bHasLastFootLocation;
+	bool bInSwing;
+	float PlantProbeDistance;
+	FHumanoidLegGroundCache PlantProbe;
+
+	// Tracks foot movement, and probes the predicted plant location when the foot lifts off.
+	// @return - true if the trace data was filled in from the plant probe
+	bool UpdateFootfallPrediction(const FHumanoidLegTraceEndpoints& EndpointsCS,
+		const FHumanoidLegTraceEndpoints& EndpointsWS);
+
+	// Counts a ground cache hit or miss in stats and in the trace data wrapper
+	void RecordGroundCacheResult(bool bHit);
+
+	// Solves the ground for the new trace data, and marks the trace data as updated this tick
+	void FinishTraceDataUpdate();
+
+	// Component transform the trace data was last updated with. While gated off, the trace data is held in place
+	// in world space from this.
+	FTransform TraceDataComponentToWorld;
 };
@@ -4,9 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "IK/IK.h"
+#include "IK/SolverTuning.h"
 #include "BoneControllers/AnimNode_SkeletalControlBase.h"
 #include "AnimNode_RangeLimitedFabrik.generated.h"
 
+struct FPlanarRotation;
+
 
 /*
 	Range-limited FABRIK solver. Based on UE4 FABRIK solver (see AnimNode_Fabrik.h), but will
@@ -15,6 +18,9 @@
 	See IK.h for a description of ROM constraints.
 	
 	See RangeLimitedFABRIK.h for more detailed description of the FABRIK algorithm(s) as implemented here.
+
+	If bUseAnalyticTwoBoneSolver is set, two-bone chains (optionally with a planar constraint on one bone, and no 
+	other constraints) are solved in closed form instead of by FABRIK, when using the normal solver with a fixed root.
 */
 
 /*
@@ -30,6 +36,21 @@ enum class ERangeLimitedFABRIKSolverMode : uint8
 	RLF_ClosedLoop UMETA(DisplayName = "Closed Loop")
 };
 
+/*
+* Shape of the IK chain, as far as picking a solver goes. Checked on every evaluation, since constraints may be swapped.
+*/
+enum class ERangeLimitedFABRIKChainType : uint8
+{
+	// Anything else; solved with FABRIK
+	General,
+
+	// Two bones, no constraints
+	TwoBone,
+
+	// Two bones, one with a planar rotation constraint
+	TwoBoneHinge
+};
+
 USTRUCT()
 struct RTIK_API FAnimNode_RangeLimitedFabrik : public FAnimNode_SkeletalControlBase
 {
@@ -46,6 +67,8 @@ struct RTIK_API FAnimNode_RangeLimitedFabrik : public FAnimNode_SkeletalControlB
 		MaxIterations(10),
 		MaxRootDragDistance(0.0f),
 		RootDragStiffness(1.0f),
+		bUseAnalyticTwoBoneSolver(false),
+		SolverRecording(nullptr),
 		bEnableDebugDraw(false)
 	{ }
 
@@ -89,12 +112,34 @@ struct RTIK_API FAnimNode_RangeLimitedFabrik : public FAnimNode_SkeletalControlB
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver, meta = (UIMin = 0.0f))
 	float RootDragStiffness;
 
+	// Solve two-bone chains in closed form instead of iterating, if the chain has no constraints or a single planar
+	// constraint, the solver mode is Normal and the root is fixed. Other chains always use FABRIK.
+	//
+	// Results can differ from FABRIK's: the planar constraint's limits are met exactly, including on the bone ending
+	// at the effector, and the chain keeps bending the way it started.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver)
+	bool bUseAnalyticTwoBoneSolver;
+
+	// Records this node's solves, for tuning Precision and MaxIterations offline. See UIKSolverRecording.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Solver, meta = (PinHiddenByDefault))
+	UIKSolverRecording* SolverRecording;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
 	bool bEnableDebugDraw;
 
+	// Drop output bones the IK barely changed before they are blended into the pose. See FIKCommitSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKCommitSettings CommitSettings;
+
+	// Skip this node entirely while a curve, or the node's alpha, is low. See FIKGateSettings.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Optimization)
+	FIKGateSettings GateSettings;
+
 public:
 
 	// FAnimNode_Base interface
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
 	virtual void GatherDebugData(FNodeDebugData& DebugData) override;
 	// End of FAnimNode_Base interface
 
@@ -109,6 +154,10 @@ protected:
 	virtual void InitializeBoneReferences(const FBoneContainer& RequiredBones) override;
 	// End of FAnimNode_SkeletalControlBase interface
 
+	// Decide whether IKChain, as it is now, can be solved analytically. For TwoBoneHinge chains, OutHingeBoneIndex
+	// is the bone carrying the planar constraint, and OutHinge is that constraint.
+	ERangeLimitedFABRIKChainType ClassifyChain(FPlanarRotation*& OutHinge, int32& OutHingeBoneIndex) const;
+
 	// Update rotation of parent bone to reflect new position of the child. 
 	void UpdateParentRotation(FTransform& ParentTransform, const FIKBone& ParentBone,
 		FTransform& ChildTransform, const FIKBone& ChildBone, FCSPose<FCompactPose>& Pose) const;
@@ -117,4 +166,13 @@ protected:
 	// Cached CS location when in editor for debug drawing
 	FTransform CachedEffectorCSTransform;
 #endif
+
+	// Captured in PreUpdate for use during evaluation
+	FIKNodeSnapshot Snapshot;
+
+	// Tracks whether GateSettings let the node run
+	FIKGate Gate;
+
+	// Hands solves to SolverRecording
+	FIKSolverRecorder SolverRecorder;
 };
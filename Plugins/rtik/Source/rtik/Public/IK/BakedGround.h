@@ -0,0 +1,156 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "GameFramework/Actor.h"
+#include "BakedGround.generated.h"
+
+class UBoxComponent;
+
+/*
+* One square tile of baked ground samples. Tiles with no walkable ground store nothing.
+*/
+struct FIKBakedGroundTile
+{
+	// Quantized heights, row-major, UIKBakedGroundData::TileSize samples per side
+	TArray<uint16> Heights;
+
+	// Normal X and Y, each packed into one signed byte. Normal Z is reconstructed.
+	TArray<uint16> Normals;
+
+	friend FArchive& operator<<(FArchive& Ar, FIKBakedGroundTile& Tile)
+	{
+		Ar << Tile.Heights;
+		Ar << Tile.Normals;
+		return Ar;
+	}
+};
+
+/*
+* Ground heights and normals baked offline over the walkable static geometry of a level.
+*
+* Samples lie on a world-aligned X / Y grid and hold the height of the highest walkable surface at that point.
+* Heights are quantized to 16 bits relative to the lowest sample, and normals to two bytes, so each sample
+* costs four bytes. Samples are stored in tiles; tiles without any walkable ground cost nothing.
+*
+* Ground queries are answered by bilinear interpolation between the four surrounding samples. Where those
+* differ in height by more than MaxInterpolationHeightDelta (step edges, ledges), queries are not answered,
+* so the caller can fall back to a physics trace.
+*
+* The data is immutable once baked, so it can be read from any thread.
+*/
+UCLASS()
+class RTIK_API UIKBakedGroundData : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	// Samples along each side of a tile
+	static const int32 TileSize;
+
+	// Quantized height of samples with no walkable ground
+	static const uint16 NoGround;
+
+	UIKBakedGroundData();
+
+	// World location of the first sample
+	UPROPERTY(VisibleAnywhere, Category = Data)
+	FVector2D Origin;
+
+	// Distance between samples, in cm
+	UPROPERTY(VisibleAnywhere, Category = Data)
+	float CellSize;
+
+	UPROPERTY(VisibleAnywhere, Category = Data)
+	int32 NumTilesX;
+
+	UPROPERTY(VisibleAnywhere, Category = Data)
+	int32 NumTilesY;
+
+	// Height of quantized height 0
+	UPROPERTY(VisibleAnywhere, Category = Data)
+	float MinHeight;
+
+	// Height of one quantization step, in cm
+	UPROPERTY(VisibleAnywhere, Category = Data)
+	float HeightQuantum;
+
+	UPROPERTY(VisibleAnywhere, Category = Data)
+	float MaxInterpolationHeightDelta;
+
+	// Number of samples which found walkable ground
+	UPROPERTY(VisibleAnywhere, Category = Data)
+	int32 NumWalkableSamples;
+
+	// Finds the ground height and normal at a world location.
+	// @return - false outside the baked area, where there is no walkable ground, or across a step edge
+	bool Sample(const FVector2D& LocationWS, float& OutHeight, FVector& OutNormal) const;
+
+	/*
+	* Samples the ground inside Bounds with vertical traces, every CellSize cm. Only hits on static components,
+	* with normals at most WalkableFloorAngle degrees from vertical, are kept. Replaces any existing data.
+	*/
+	void Bake(UWorld* World,
+		const FBox& Bounds,
+		float InCellSize,
+		float WalkableFloorAngle,
+		float InMaxInterpolationHeightDelta);
+
+	// UObject interface
+	virtual void Serialize(FArchive& Ar) override;
+	// End UObject interface
+
+protected:
+
+	// Looks up a single sample by its grid coordinates
+	bool GetSample(int32 X, int32 Y, float& OutHeight, FVector& OutNormal) const;
+
+	TArray<FIKBakedGroundTile> Tiles;
+};
+
+/*
+* Place in a static level to bake ground samples for the area inside the box. Bake from the details panel,
+* or for many maps at once with the IKBakeGround commandlet. The baked data is saved with, and streamed with,
+* the level. While the level is loaded, the data is available to leg trace nodes with bUseBakedGround set
+* (see FIKBakedGroundProvider).
+*/
+UCLASS(hidecategories = (Collision, Physics, Input, Replication, LOD, Cooking))
+class RTIK_API AIKBakedGroundVolume : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	AIKBakedGroundVolume();
+
+	// Area to bake. Only its axis-aligned bounds are used.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Bake)
+	UBoxComponent* Bounds;
+
+	// Distance between samples, in cm. Smaller is more accurate but takes more memory.
+	UPROPERTY(EditAnywhere, Category = Bake, meta = (ClampMin = 1.0f))
+	float CellSize;
+
+	// Surfaces steeper than this, in degrees, are not baked
+	UPROPERTY(EditAnywhere, Category = Bake, meta = (ClampMin = 0.0f, ClampMax = 89.0f))
+	float WalkableFloorAngle;
+
+	// Queries across samples which differ in height by more than this fall back to a physics trace
+	UPROPERTY(EditAnywhere, Category = Bake, meta = (ClampMin = 0.0f))
+	float MaxInterpolationHeightDelta;
+
+	UPROPERTY(VisibleAnywhere, Category = Bake)
+	UIKBakedGroundData* GroundData;
+
+	// Bakes the ground inside the box, replacing any existing data
+	UFUNCTION(CallInEditor, Category = Bake)
+	void BakeGround();
+
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End AActor interface
+};
@@ -0,0 +1,64 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimNodeBase.h"
+#include "BasePoseCache.generated.h"
+
+/*
+* Bones from one evaluation of a base (pre-IK) pose, shared between several nodes.
+*
+* Leg IK and knee correction nodes each read a few bones from the pose before IK, through their own base pose link.
+* Without a cache, each of those links evaluates the whole pre-IK subgraph again. With a shared cache, the first node
+* to evaluate in a frame evaluates its link once, and copies out the component-space transforms of the bones each node
+* has asked for. The other nodes read the copies and never evaluate their own links.
+*
+* Every node sharing a cache must have its base pose link connected to the same pose. Bones are remembered once asked
+* for; if a node asks for a bone that wasn't copied yet this frame (e.g., on the first frame), its own link is
+* evaluated once more to fill it in. Bones are forgotten whenever the required bones change (e.g., on LOD change).
+*/
+struct RTIK_API FIKBasePoseCache
+{
+public:
+
+	typedef TArray<FCompactPoseBoneIndex, TInlineAllocator<8>> FBoneList;
+
+	// Makes sure Bones are cached for the current evaluation of the anim graph, evaluating BasePoseLink if they aren't
+	void Evaluate(FComponentSpacePoseLink& BasePoseLink, FComponentSpacePoseContext& Output, const FBoneList& Bones);
+
+	// Gets the component-space transform of a bone. Evaluate must have been called with this bone in this frame.
+	const FTransform& GetBoneCSTransform(const FCompactPoseBoneIndex& BoneIndex) const
+	{
+		return BoneCSTransforms[BoneIndex.GetInt()];
+	}
+
+protected:
+
+	// True if every bone in Bones was copied during this evaluation
+	bool HasBones(const FBoneList& Bones) const;
+
+	// Bones to copy whenever the pose is evaluated
+	TArray<FCompactPoseBoneIndex> RequiredBones;
+
+	// Indexed by compact pose bone index. Only bones flagged in CachedBones are valid.
+	TArray<FTransform> BoneCSTransforms;
+	TBitArray<> CachedBones;
+
+	FGraphTraversalCounter CachedBonesCounter;
+	FGraphTraversalCounter EvaluationCounter;
+};
+
+/*
+* Wrapper for passing a base pose cache around in BP. Give each character its own cache, and share it between that
+* character's leg IK and knee correction nodes.
+*/
+UCLASS(BlueprintType, EditInlineNew)
+class RTIK_API UIKBasePoseCache_Wrapper : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	FIKBasePoseCache Cache;
+};
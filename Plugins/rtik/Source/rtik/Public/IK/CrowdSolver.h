@@ -0,0 +1,125 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IK.h"
+#include "HAL/CriticalSection.h"
+#include "Async/TaskGraphInterfaces.h"
+
+/*
+* Results of the deferred solves for one chain. Owned by the requesting node, and shared with the crowd solver, which
+* writes into it from a worker thread when it solves.
+*
+* Results are guarded by the slot's lock, so they can be read while a solve may be running (e.g., when an anim
+* instance is ticked by hand, or in a world that doesn't tick).
+*/
+struct RTIK_API FIKCrowdSolveSlot
+{
+public:
+
+	FIKCrowdSolveSlot()
+		:
+		SolvedFrame(0),
+		PendingRequestIndex(INDEX_NONE)
+	{ }
+
+	// Copies out the last result, if it was requested on the previous frame (or this one).
+	// @return - false if there is no recent result
+	bool GetRecentResult(TArray<FTransform>& OutSourceCSTransforms, TArray<FTransform>& OutSolvedCSTransforms) const;
+
+	// Stores the result of a solve requested on frame RequestFrame
+	void SetResult(TArray<FTransform>&& InSourceCSTransforms, TArray<FTransform>&& InSolvedCSTransforms, uint64 RequestFrame);
+
+	// Index of this slot's queued request in the solver. Guarded by the solver's lock.
+	int32 PendingRequestIndex;
+
+protected:
+
+	mutable FCriticalSection Lock;
+
+	// Component-space chain transforms the last solve started from
+	TArray<FTransform> SourceCSTransforms;
+
+	// Component-space chain transforms after the last solve
+	TArray<FTransform> SolvedCSTransforms;
+
+	// Value of GFrameCounter when the last solve was requested
+	uint64 SolvedFrame;
+};
+
+/*
+* Collects range-limited FABRIK solves from many characters over a frame, and solves them together, once per world,
+* after all actors have ticked (and all animation has been evaluated). The solves are handed to a background task,
+* so the game thread doesn't wait for them; inside it, requests are split into fixed-size chunks, each solved start
+* to finish by one worker, so the solves are done in a few dense batches instead of scattered across every
+* character's evaluation task.
+*
+* Requests are made during evaluation, and a pose can't be changed once evaluated, so a node using the crowd solver
+* sees its own solve on the next frame; see FAnimNode_HumanoidLegIK::bUseCrowdSolver. Nodes wait for the solve task
+* in PreUpdate, before their next evaluation; it normally finishes well before then. The task is also waited for 
+* before garbage collection and world cleanup, as it reads the requests' constraints.
+*
+* To measure: with many characters, compare "IK Humanoid Leg IK Eval" in stat anim with and without the crowd 
+* solver. The solves themselves show up as "IK Crowd Solver Flush" (on workers), any game thread stall as
+* "IK Crowd Solver Wait", and nodes that had to solve for themselves as "IK Crowd Solver Misses".
+*
+* There is one solver per world. Solvers are created on first use and destroyed when their world is cleaned up.
+* Get and Enqueue are thread-safe.
+*/
+class RTIK_API FIKCrowdSolver
+{
+public:
+
+	// Number of requests solved by each task
+	static const int32 ChunkSize;
+
+	// Get the solver for World, creating it if needed
+	static TSharedRef<FIKCrowdSolver, ESPMode::ThreadSafe> Get(UWorld* World);
+
+	// Must be called once from the game thread at startup, so queued solves are run at the end of each world tick
+	static void RegisterDelegates();
+
+	// Queue a FABRIK solve. Transforms are copied; constraints must stay alive until the end of the frame.
+	// The result is written into Slot when the solver flushes.
+	void Enqueue(const TSharedRef<FIKCrowdSolveSlot, ESPMode::ThreadSafe>& Slot,
+		const TArray<FTransform>& CSTransforms,
+		const TArray<FIKBoneConstraint*>& Constraints,
+		const FVector& EffectorTargetCS,
+		float Precision,
+		int32 MaxIterations);
+
+	// Number of solves queued for this frame
+	int32 GetNumPendingRequests();
+
+	// Blocks until the solves handed off last frame are done. Game thread only.
+	void WaitForFlush();
+
+protected:
+
+	struct FSolveRequest
+	{
+		TSharedPtr<FIKCrowdSolveSlot, ESPMode::ThreadSafe> Slot;
+		TArray<FTransform> CSTransforms;
+		TArray<FIKBoneConstraint*> Constraints;
+		FVector EffectorTargetCS;
+		float Precision;
+		int32 MaxIterations;
+	};
+
+	// Hands all queued requests to a task, which solves them and writes the results into their slots. Game thread only.
+	void Flush();
+
+	FCriticalSection Lock;
+	TArray<FSolveRequest> PendingRequests;
+
+	// Task solving the requests flushed last. Only touched on the game thread.
+	FGraphEventRef FlushTask;
+
+	static void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	static void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+	static void OnPreGarbageCollect();
+
+	static FCriticalSection SolversLock;
+	static TMap<TWeakObjectPtr<UWorld>, TSharedRef<FIKCrowdSolver, ESPMode::ThreadSafe>> Solvers;
+};
@@ -0,0 +1,179 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "HumanoidIK.h"
+#include "GroundHeightField.generated.h"
+
+/*
+* Settings for a ground height field. See FIKGroundHeightField.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FIKGroundHeightFieldSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FIKGroundHeightFieldSettings()
+		:
+		GridSize(16),
+		CellSize(10.0f),
+		TracesPerFrame(8),
+		TraceHalfHeight(150.0f),
+		MaxCellAgeFrames(120)
+	{ }
+
+	// Number of samples along each side of the grid
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 2, ClampMax = 64))
+	int32 GridSize;
+
+	// Distance between samples, in cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 1.0f))
+	float CellSize;
+
+	// Maximum number of traces done each frame to fill in the grid
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 1))
+	int32 TracesPerFrame;
+
+	// Each sample is traced from this far above the grid center height to this far below it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 1.0f))
+	float TraceHalfHeight;
+
+	// Samples older than this many frames are traced again. Movable components entering the grid are noticed
+	// separately, within a frame, so this only needs to catch changes to static geometry.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 1))
+	int32 MaxCellAgeFrames;
+};
+
+/*
+* A small grid of ground heights which follows a character around. The grid is aligned with world X / Y and
+* filled in a few async traces at a time, nearest cells first. Cells are addressed by their world grid coordinates,
+* wrapped into the array, so moving the grid doesn't copy anything; cells which fall out of range are simply replaced.
+*
+* Ground queries inside the grid are answered by bilinear interpolation between the four surrounding samples,
+* instead of a trace. Samples on movable components are never used, and neither are samples under the bounds of 
+* a movable component overlapping the grid (found with an async overlap each frame). All samples are discarded 
+* when a level is streamed in or out, or the query quality changes.
+*
+* Cells are only written by Update, on the game thread. Evaluation may read them from a worker thread, as it never 
+* runs at the same time as the owning anim instance's PreUpdate.
+*/
+struct RTIK_API FIKGroundHeightField
+{
+public:
+
+	FIKGroundHeightField();
+
+	// Collects the traces requested last frame, moves the grid to CenterWS, and requests async traces for up to 
+	// Settings.TracesPerFrame missing or stale samples. Call from PreUpdate, on the game thread. Does nothing if 
+	// already called this frame, so it is safe to call from each leg.
+	void Update(UWorld* World, 
+		AActor* ActorToIgnore, 
+		const FVector& CenterWS, 
+		const FIKGroundHeightFieldSettings& Settings,
+		const FIKGroundQueryQuality& Quality);
+
+	// Finds the ground height and normal at a world location by bilinear interpolation.
+	// @return - false if any of the surrounding samples is missing, missed the ground, or hit a movable component
+	bool SampleHeight(const FVector2D& LocationWS, float& OutHeight, FVector& OutNormal) const;
+
+	// Answers a vertical trace from Start to End using the grid. OutHit is filled in as if a trace had been done.
+	// @return - false if the trace isn't vertical, or can't be answered from the grid
+	bool GetHit(const FVector& Start, const FVector& End, FHitResult& OutHit) const;
+
+	// Discards all samples
+	void Invalidate();
+
+	// Must be called once from the game thread at startup, so level streaming can invalidate height fields
+	static void RegisterLevelDelegates();
+
+protected:
+
+	struct FCell
+	{
+		FIntPoint Key;
+		float Height;
+		FVector Normal;
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		TWeakObjectPtr<UPhysicalMaterial> PhysMaterial;
+		int32 FaceIndex;
+		uint64 TraceFrame;
+		bool bTraced;
+		bool bUsable;
+	};
+
+	struct FPendingTrace
+	{
+		FIntPoint Key;
+		FTraceHandle Handle;
+	};
+
+	void Reset(const FIKGroundHeightFieldSettings& Settings);
+	int32 GetCellIndex(const FIntPoint& Key) const;
+	const FCell* FindCell(const FIntPoint& Key) const;
+	bool IsInGrid(const FIntPoint& Key) const;
+	void CollectTraces(UWorld* World);
+	void CollectMovableOverlaps(UWorld* World, AActor* ActorToIgnore);
+
+	TArray<FCell> Cells;
+
+	// Traces and overlap requested last frame
+	TArray<FPendingTrace> PendingTraces;
+	FTraceHandle MovableOverlapHandle;
+
+	// Bounds of movable components overlapping the grid, grown by one cell. Samples inside these aren't used.
+	TArray<FBox> MovableBoundsWS;
+
+	// Offsets from the center cell, nearest first. Determines fill order.
+	TArray<FIntPoint> FillOrder;
+
+	int32 GridSize;
+	float CellSize;
+	FIntPoint CenterKey;
+	float CenterHeight;
+	float CachedTraceHalfHeight;
+	uint64 LastUpdateFrame;
+	int32 LevelGeneration;
+
+	// Query settings the samples were traced with
+	bool bTraceComplex;
+	bool bReturnPhysicalMaterial;
+	bool bReturnFaceIndex;
+};
+
+/*
+* Wrapper for passing a height field around in BP. Give each character its own height field, and share it between
+* that character's leg trace nodes.
+*/
+UCLASS(BlueprintType, EditInlineNew)
+class RTIK_API UIKGroundHeightField_Wrapper : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	FIKGroundHeightFieldSettings Settings;
+
+	UFUNCTION(BlueprintCallable, Category = IK)
+	void Initialize(FIKGroundHeightFieldSettings InSettings)
+	{
+		Settings = InSettings;
+		HeightField.Invalidate();
+	}
+
+	// Finds the ground height at a world location, if the height field covers it. Returns false otherwise.
+	// Reads the samples as of the last PreUpdate; call on the game thread.
+	UFUNCTION(BlueprintCallable, Category = IK)
+	bool SampleHeight(FVector2D Location, float& OutHeight, FVector& OutNormal) const
+	{
+		return HeightField.SampleHeight(Location, OutHeight, OutNormal);
+	}
+
+	FIKGroundHeightField HeightField;
+};
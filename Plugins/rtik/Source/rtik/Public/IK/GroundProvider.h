@@ -0,0 +1,173 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "HAL/CriticalSection.h"
+
+class ULandscapeHeightfieldCollisionComponent;
+class UIKBakedGroundData;
+
+/*
+* Answers ground queries from some faster source than a general physics trace, where it can. Ground probing
+* (see FHumanoidIK::ProbeLegEndpoints) asks the provider first, and only does a physics trace if the provider
+* can't answer.
+*/
+class RTIK_API FIKGroundProvider
+{
+public:
+
+	virtual ~FIKGroundProvider() { }
+
+	// Tries to answer a vertical, downward trace from Start to End. Must be thread-safe.
+	// @return - true if OutHit was filled in. False if the provider can't answer, and a physics trace should be done.
+	virtual bool FindGround(const FVector& Start, const FVector& End, FHitResult& OutHit) = 0;
+
+	// Called with the result of each physics trace done because the provider couldn't answer. Must be thread-safe.
+	virtual void OnPhysicsTrace(const FHitResult& Hit) { }
+};
+
+/*
+* Asks several providers in turn; the first one to answer wins. Physics trace results are passed to all of them.
+*/
+class RTIK_API FIKGroundProviderList : public FIKGroundProvider
+{
+public:
+
+	void Add(FIKGroundProvider* Provider) { Providers.Add(Provider); }
+	bool IsEmpty() const { return Providers.Num() == 0; }
+
+	// FIKGroundProvider interface
+	virtual bool FindGround(const FVector& Start, const FVector& End, FHitResult& OutHit) override;
+	virtual void OnPhysicsTrace(const FHitResult& Hit) override;
+	// End FIKGroundProvider interface
+
+protected:
+
+	TArray<FIKGroundProvider*, TInlineAllocator<4>> Providers;
+};
+
+/*
+* Ground provider which samples landscape heights directly.
+*
+* The first time a physics trace hits a landscape collision component, the component is queued for baking: its 
+* heights are copied into a CPU-side grid, one sample per collision vertex. Baking is done on the game thread at 
+* the end of the world tick, a limited number of traces per frame; queries over the component miss, and fall back
+* to physics traces, until its grid is ready. After that, ground queries over the component are answered by 
+* bilinear interpolation between grid samples.
+*
+* Each sample is baked with a trace against static and dynamic world geometry, and only kept if the landscape is the 
+* first surface hit. Where props stand on the landscape, queries fall back to physics traces. Objects that move in 
+* after baking, and props small enough to fit between collision vertices, are still not seen, so only use this 
+* where the feet are expected to touch mostly bare landscape. Landscapes must not be pitched or rolled.
+*
+* There is one provider per world. Grids are discarded when a level is streamed out. FindGround and OnPhysicsTrace 
+* are thread-safe.
+*/
+class RTIK_API FIKLandscapeGroundProvider : public FIKGroundProvider
+{
+public:
+
+	// Get the provider for World, creating it if needed
+	static TSharedRef<FIKLandscapeGroundProvider, ESPMode::ThreadSafe> Get(UWorld* World);
+
+	// Must be called once from the game thread at startup, so providers bake at the end of each world tick, and are
+	// cleared on level streaming and world cleanup
+	static void RegisterDelegates();
+
+	// FIKGroundProvider interface
+	virtual bool FindGround(const FVector& Start, const FVector& End, FHitResult& OutHit) override;
+	virtual void OnPhysicsTrace(const FHitResult& Hit) override;
+	// End FIKGroundProvider interface
+
+	// Game thread only
+	void Empty();
+
+protected:
+
+	// Heights of one landscape collision component, in world space, at each collision vertex
+	struct FHeightGrid
+	{
+		TWeakObjectPtr<ULandscapeHeightfieldCollisionComponent> Component;
+		TWeakObjectPtr<AActor> Actor;
+		FTransform ComponentToWorld;
+		int32 NumVertsPerSide;
+		float VertexSpacing;
+		TArray<float> Heights;
+
+		// Bilinear lookup. Returns false outside the grid or over a hole.
+		bool Sample(const FVector& LocationWS, float& OutHeight, FVector& OutNormal) const;
+	};
+
+	typedef TSharedPtr<FHeightGrid, ESPMode::ThreadSafe> FHeightGridPtr;
+
+	// Sets up an empty grid for the component. Returns null if the component can't be used.
+	static FHeightGridPtr BeginBake(ULandscapeHeightfieldCollisionComponent* Component);
+
+	// Traces up to InOutTraceBudget more grid samples, and reduces the budget by the number of traces done.
+	// @return - true once every sample has been baked
+	static bool ContinueBake(UWorld* World, 
+		ULandscapeHeightfieldCollisionComponent* Component, 
+		FHeightGrid& Grid, 
+		int32& InOutTraceBudget);
+
+	// Bakes queued components, within the per-frame trace budget. Game thread only.
+	void TickBake(UWorld* World);
+
+	// World X / Y hash cells, used to find grids overlapping a location
+	static const float HashCellSize;
+	static FIntPoint GetHashKey(const FVector& Location);
+
+	FCriticalSection Lock;
+	TArray<FHeightGridPtr> Grids;
+	TMap<FIntPoint, TArray<int32>> GridsPerHashCell;
+	TSet<TWeakObjectPtr<ULandscapeHeightfieldCollisionComponent>> KnownComponents;
+
+	// Components waiting to be baked, and the grid being baked. The grid is only touched on the game thread.
+	TArray<TWeakObjectPtr<ULandscapeHeightfieldCollisionComponent>> BakeQueue;
+	FHeightGridPtr BakingGrid;
+
+	static void OnLevelRemoved(ULevel* Level, UWorld* World);
+	static void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	static void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	static FCriticalSection ProvidersLock;
+	static TMap<TWeakObjectPtr<UWorld>, TSharedRef<FIKLandscapeGroundProvider, ESPMode::ThreadSafe>> Providers;
+};
+
+/*
+* Ground provider which answers queries from ground data baked offline (see AIKBakedGroundVolume).
+*
+* Baked ground volumes add their data when they begin play and remove it when they end play, so data comes
+* and goes with level streaming. Hits from baked data report the baked ground volume as the hit actor, and
+* have no component. There is one provider per world. All functions are thread-safe.
+*/
+class RTIK_API FIKBakedGroundProvider : public FIKGroundProvider
+{
+public:
+
+	// Get the provider for World, creating it if needed
+	static TSharedRef<FIKBakedGroundProvider, ESPMode::ThreadSafe> Get(UWorld* World);
+
+	// Must be called once from the game thread at startup, so providers are removed on world cleanup
+	static void RegisterDelegates();
+
+	// FIKGroundProvider interface
+	virtual bool FindGround(const FVector& Start, const FVector& End, FHitResult& OutHit) override;
+	// End FIKGroundProvider interface
+
+	// Data must stay alive until it is removed
+	void AddData(const UIKBakedGroundData* InData);
+	void RemoveData(const UIKBakedGroundData* InData);
+
+protected:
+
+	FCriticalSection Lock;
+	TArray<const UIKBakedGroundData*> Data;
+
+	static void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	static FCriticalSection ProvidersLock;
+	static TMap<TWeakObjectPtr<UWorld>, TSharedRef<FIKBakedGroundProvider, ESPMode::ThreadSafe>> Providers;
+};
@@ -0,0 +1,83 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HumanoidIK.h"
+#include "WorldCollision.h"
+#include "CollisionQueryParams.h"
+#include "Engine/EngineTypes.h"
+
+/*
+* Collects the ground traces requested by rtik nodes over a frame and submits them together, once per world,
+* after all actors have ticked. Query params are built once per ignored actor and query quality, instead of once per trace.
+* Results are written back into the requesting trace data wrappers when the traces complete (early next frame).
+*
+* There is one service per world. Services are created on first use and destroyed when their world is cleaned up.
+* All functions must be called from the game thread.
+*/
+class RTIK_API FIKGroundQueryService
+{
+public:
+
+	// Get the service for World, creating it if needed
+	static FIKGroundQueryService& Get(UWorld* World);
+
+	// Must be called once from the game thread at startup, so queued traces are submitted at the end of each world tick
+	static void RegisterDelegates();
+
+	// Queue foot and toe traces for one leg. Endpoints must be in world space. Results will be written into
+	// TraceData when the traces complete; TraceData->GetNumQueryResultsReceived() is incremented for each result.
+	void RequestLegTrace(AActor* ActorToIgnore,
+		UHumanoidIKTraceData_Wrapper* TraceData,
+		const FHumanoidLegTraceEndpoints& EndpointsWS,
+		const FIKGroundQueryQuality& Quality = FIKGroundQueryQuality(),
+		ECollisionChannel CollisionChannel = ECC_Pawn);
+
+	// Number of traces queued for this frame which have not been submitted yet
+	int32 GetNumPendingQueries() const { return PendingQueries.Num(); }
+
+	~FIKGroundQueryService();
+
+protected:
+
+	FIKGroundQueryService(UWorld* InWorld);
+
+	struct FGroundQuery
+	{
+		TWeakObjectPtr<UHumanoidIKTraceData_Wrapper> TraceData;
+		TWeakObjectPtr<AActor> ActorToIgnore;
+		FVector Start;
+		FVector End;
+		ECollisionChannel CollisionChannel;
+		uint8 QualityFlags;
+		bool bToeTrace;
+		FTraceHandle Handle;
+	};
+
+	// Submits all pending queries as async traces
+	void Flush();
+
+	void OnTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	static void OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	static void OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources);
+
+	TWeakObjectPtr<UWorld> World;
+
+	// Queries requested this frame
+	TArray<FGroundQuery> PendingQueries;
+
+	// Queries submitted in the last flush, waiting for results. Indexed by trace user data.
+	TArray<FGroundQuery> InFlightQueries;
+
+	// Packs the parts of a query quality which affect query params
+	static uint8 GetQualityFlags(const FIKGroundQueryQuality& Quality);
+
+	// Query params for each ignored actor and quality flags, rebuilt on each flush
+	TMap<TPair<TWeakObjectPtr<AActor>, uint8>, FCollisionQueryParams> QueryParamsPerActor;
+
+	FTraceDelegate TraceDelegate;
+
+	static TMap<TWeakObjectPtr<UWorld>, TUniquePtr<FIKGroundQueryService>> Services;
+};
@@ -0,0 +1,84 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "HAL/CriticalSection.h"
+#include "HumanoidIK.h"
+
+/*
+* A world-wide spatial hash of recent ground hits on static geometry, shared by all characters in the world.
+* Intended for crowds: characters walking over the same floor can reuse each other's trace results.
+*
+* Hits are keyed by quantized X / Y and a height band. A stored hit answers a new vertical trace if it is in the
+* same X / Y cell, lies within the new trace, and the trace that produced it started at least as high as the new one
+* (so nothing above the stored hit could have been missed). The hit point is moved onto the new trace line using
+* the hit normal.
+*
+* Hits are only shared between queries of the same quality (probe mode, complex or simple collision, and returned
+* hit information), so e.g. a simple-collision hit never answers a complex query.
+*
+* Only hits on components with static mobility are stored. Hits expire after a while, and all hashes are cleared
+* when a level is streamed in or out. All functions are thread-safe.
+*/
+class RTIK_API FIKGroundSampleHash
+{
+public:
+
+	// Size of X / Y cells, in cm
+	static const float CellSize;
+
+	// Height of height bands, in cm
+	static const float BandHeight;
+
+	// Hits older than this are not used
+	static const double MaxAgeSeconds;
+
+	// Get the hash for World, creating it if needed
+	static TSharedRef<FIKGroundSampleHash, ESPMode::ThreadSafe> Get(UWorld* World);
+
+	// Must be called once from the game thread at startup, so hashes are cleared on level streaming and world cleanup
+	static void RegisterDelegates();
+
+	// Tries to answer a vertical trace from Start to End with a stored hit of the same query quality.
+	// @return - true if OutHit was filled in
+	bool FindHit(const FVector& Start, const FVector& End, const FIKGroundQueryQuality& Quality, FHitResult& OutHit);
+
+	// Stores the result of a query made with Quality, if it hit static geometry
+	void AddHit(const FHitResult& Hit, const FIKGroundQueryQuality& Quality);
+
+	void Empty();
+
+protected:
+
+	struct FSample
+	{
+		FVector ImpactPoint;
+		FVector ImpactNormal;
+		float TraceStartZ;
+		double Timestamp;
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		TWeakObjectPtr<UPhysicalMaterial> PhysMaterial;
+		int32 FaceIndex;
+	};
+
+	// One sample map per combination of probe mode and query flags
+	static const int32 NumQualityKinds = 16;
+
+	static FIntVector GetKey(const FVector& Location);
+	static int32 GetQualityIndex(const FIKGroundQueryQuality& Quality);
+
+	// Drops expired samples once a sample map gets large
+	static void Prune(TMap<FIntVector, FSample>& QualitySamples, double Now);
+
+	FCriticalSection Lock;
+	TMap<FIntVector, FSample> Samples[NumQualityKinds];
+
+	static void OnLevelsChanged(ULevel* Level, UWorld* World);
+	static void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	static FCriticalSection HashesLock;
+	static TMap<TWeakObjectPtr<UWorld>, TSharedRef<FIKGroundSampleHash, ESPMode::ThreadSafe>> Hashes;
+};
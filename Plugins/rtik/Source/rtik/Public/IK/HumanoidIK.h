@@ -6,11 +6,95 @@
 #include "BonePose.h"
 #include "HumanoidIK.generated.h"
 
+class FIKGroundProvider;
+struct FHumanoidIKTraceData;
+struct FHumanoidLegGroundSolution;
+
 
 /*
 * Basic structs, etc for humanoid biped IK.
 */
 
+/*
+* How the ground under a foot is found
+*/
+UENUM(BlueprintType)
+enum class EHumanoidLegProbeMode : uint8
+{
+	// Separate vertical line traces through the foot and toe
+	HLPM_LineTraces UMETA(DisplayName = "Foot and Toe Line Traces"),
+
+	// A single box sweep covering the foot. Foot and toe floor points are found on the plane of the contact,
+	// so floor slope comes from the contact normal. Handles ledges and stair edges the line traces can miss.
+	HLPM_FootSweep UMETA(DisplayName = "Foot Box Sweep")
+};
+
+/*
+* How accurate (and expensive) ground queries should be
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FIKGroundQueryQuality
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FIKGroundQueryQuality()
+		:
+		ProbeMode(EHumanoidLegProbeMode::HLPM_LineTraces),
+		bTraceComplex(true),
+		bReturnPhysicalMaterial(false),
+		bReturnFaceIndex(false)
+	{ }
+
+	// How to find the ground under the foot. A foot sweep uses one query instead of two. 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	EHumanoidLegProbeMode ProbeMode;
+
+	// Query per-triangle collision. If false, simple collision is used instead, which is much cheaper
+	// but may not follow the visible surface exactly.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bTraceComplex;
+
+	// Fill in the physical material of hits
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bReturnPhysicalMaterial;
+
+	// Fill in the face index of hits. Only meaningful for complex traces.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bReturnFaceIndex;
+};
+
+/*
+* Ground query quality for a node, optionally varying by LOD level
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FIKGroundQueryQualitySettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	// Quality used if QualityPerLOD is empty
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	FIKGroundQueryQuality Quality;
+
+	// Quality to use at each LOD level. LODs past the end of the array use the last entry.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	TArray<FIKGroundQueryQuality> QualityPerLOD;
+
+	// Get the quality to use at LOD level LODLevel
+	const FIKGroundQueryQuality& GetQuality(int32 LODLevel) const
+	{
+		if (QualityPerLOD.Num() == 0)
+		{
+			return Quality;
+		}
+
+		return QualityPerLOD[FMath::Clamp(LODLevel, 0, QualityPerLOD.Num() - 1)];
+	}
+};
+
 /*
 * Represents a humanoid leg, with a hip bone, thigh bone, and shin bone.
 */
@@ -68,8 +152,7 @@ public:
 	// @param TraceData - Trace data for this leg. Must have been updated this tick.
 	// @param OutAngleRad - Returns the UNSIGNED angle, in radians, between the slope of the floor and flat ground. 
 	// @return - true if floor slope is within rotation limit and the foot should rotate, else false.	
-	bool FindWithinFootRotationLimit(const USkeletalMeshComponent& SkelComp,
-		const FHumanoidIKTraceData& TraceData,
+	bool FindWithinFootRotationLimit(const FHumanoidIKTraceData& TraceData,
 		float& OutAngleRad) const;
 	
 	// Gets the relevant trace floor point for IK, converts it to component space, and returns in OutFloorLocationCS.
@@ -77,8 +160,12 @@ public:
 	// @param OutTraceLocationCS - The trace point (either below the foot or the toe) to use.
 	// @return - True if the low IK target was returned, and the foot should rotate to match floor slope. False
 	// if the high IK target was returned, and the foot shouldn't rotate.
-	bool GetIKFloorPointCS(const USkeletalMeshComponent& SkelComp,
-		const FHumanoidIKTraceData& TraceData, FVector& OutFloorLocationCS) const;
+	bool GetIKFloorPointCS(const FHumanoidIKTraceData& TraceData, FVector& OutFloorLocationCS) const;
+
+	// Finds the floor point, floor slope, and foot rotation for this leg from its trace data. Done once per
+	// frame by the trace node; leg IK nodes read the result from the trace data wrapper.
+	// @param TraceData - Trace data for this leg, in component space
+	void SolveGround(const FHumanoidIKTraceData& TraceData, FHumanoidLegGroundSolution& OutSolution) const;
 
 	// FIKModChain interface
 	virtual bool InitBoneReferences(const FBoneContainer& RequiredBones) override;
@@ -122,7 +209,61 @@ struct RTIK_API FHumanoidArmChain : public FRangeLimitedIKChain
 
 
 /*
-* Holds trace data used in leg IK
+* Compact result of one ground query. Filled in once, when the query completes, so users never need to 
+* resolve the hit actor or component on worker threads.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FIKGroundSample
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FIKGroundSample()
+		:
+		bValid(false),
+		bMovable(false),
+		Location(ForceInitToZero),
+		Normal(0.0f, 0.0f, 1.0f),
+		ComponentID(0),
+		SurfaceType(SurfaceType_Default)
+	{ }
+
+	// True if the query found ground
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	bool bValid;
+
+	// True if the ground belongs to a movable component
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	bool bMovable;
+
+	// Ground point. In component space, unless noted otherwise where the sample is stored.
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	FVector Location;
+
+	// Ground normal, in the same space as Location
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	FVector Normal;
+
+	// Unique ID of the hit component, or 0. Can be compared to tell surfaces apart.
+	uint32 ComponentID;
+
+	// Surface type of the hit physical material. Only filled in if the query returned physical materials.
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	// Fills this sample from a world-space hit, converting it to the space of ComponentToWorld
+	void SetFromHit(const FHitResult& Hit, const FTransform& ComponentToWorld);
+
+	// Returns a copy of this sample with Location and Normal transformed by Transform
+	FIKGroundSample TransformBy(const FTransform& Transform) const;
+
+	// Returns a copy of this sample with Location and Normal transformed by the inverse of Transform
+	FIKGroundSample InverseTransformBy(const FTransform& Transform) const;
+};
+
+/*
+* Holds trace data used in leg IK: the ground below the foot and toe, in component space
 */
 USTRUCT(BlueprintType)
 struct RTIK_API FHumanoidIKTraceData
@@ -131,8 +272,259 @@ struct RTIK_API FHumanoidIKTraceData
 		
 public:
 	
+	UPROPERTY(BlueprintReadOnly, Category = Trace)
+	FIKGroundSample FootSample;
+
+	UPROPERTY(BlueprintReadOnly, Category = Trace)
+	FIKGroundSample ToeSample;
+
+	FHumanoidIKTraceData TransformBy(const FTransform& Transform) const
+	{
+		FHumanoidIKTraceData Result;
+		Result.FootSample = FootSample.TransformBy(Transform);
+		Result.ToeSample  = ToeSample.TransformBy(Transform);
+		return Result;
+	}
+
+	FHumanoidIKTraceData InverseTransformBy(const FTransform& Transform) const
+	{
+		FHumanoidIKTraceData Result;
+		Result.FootSample = FootSample.InverseTransformBy(Transform);
+		Result.ToeSample  = ToeSample.InverseTransformBy(Transform);
+		return Result;
+	}
+};
+
+/*
+* Where a foot should be placed, and how it should be rotated, given the trace data for its leg. All in component space.
+* See FHumanoidLegChain::SolveGround.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FHumanoidLegGroundSolution
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FHumanoidLegGroundSolution()
+		:
+		bValid(false),
+		bWithinRotationLimit(false),
+		FloorPointCS(ForceInitToZero),
+		SlopeAngleRad(0.0f),
+		TargetFootRotationCS(FQuat::Identity)
+	{ }
+
+	// True if either the foot or toe trace found ground. If false, nothing else is meaningful.
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	bool bValid;
+
+	// True if both traces found ground, and the floor slope is within the leg's MaxFootRotationDegrees.
+	// If so, the foot should rotate to match the floor; otherwise it should stay flat.
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	bool bWithinRotationLimit;
+
+	// The floor point to IK onto: the foot point if within the rotation limit, else the higher of the foot and toe points
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	FVector FloorPointCS;
+
+	// UNSIGNED angle, in radians, between the floor slope and flat ground. 0 unless both traces found ground.
+	UPROPERTY(BlueprintReadOnly, Category = Ground)
+	float SlopeAngleRad;
+
+	// Rotation taking flat ground onto the floor slope. Identity if not within the rotation limit.
+	// Not visible to Blueprint, which doesn't support FQuat.
+	UPROPERTY()
+	FQuat TargetFootRotationCS;
+};
+
+/*
+* Raw world-space results of the foot and toe ground queries for one leg. Only used while probing; 
+* converted to FHumanoidIKTraceData once the queries are done.
+*/
+struct RTIK_API FHumanoidLegGroundHits
+{
 	FHitResult FootHitResult;
 	FHitResult ToeHitResult;
+
+	// Converts to compact trace data, in the space of ComponentToWorld
+	void ToTraceData(const FTransform& ComponentToWorld, FHumanoidIKTraceData& OutTraceData) const
+	{
+		OutTraceData.FootSample.SetFromHit(FootHitResult, ComponentToWorld);
+		OutTraceData.ToeSample.SetFromHit(ToeHitResult, ComponentToWorld);
+	}
+};
+
+/*
+* Start and end points of the foot and toe traces for one leg. May be in component or world space,
+* depending on where it's used.
+*/
+struct RTIK_API FHumanoidLegTraceEndpoints
+{
+	FVector FootTraceStart;
+	FVector FootTraceEnd;
+	FVector ToeTraceStart;
+	FVector ToeTraceEnd;
+
+	FHumanoidLegTraceEndpoints()
+		:
+		FootTraceStart(ForceInitToZero),
+		FootTraceEnd(ForceInitToZero),
+		ToeTraceStart(ForceInitToZero),
+		ToeTraceEnd(ForceInitToZero)
+	{ }
+
+	// Returns a copy of these endpoints, transformed by Transform (e.g., component to world)
+	FHumanoidLegTraceEndpoints TransformBy(const FTransform& Transform) const;
+};
+
+/*
+* Settings for reusing ground trace results across frames. See FHumanoidLegGroundCache.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FHumanoidLegGroundCacheSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FHumanoidLegGroundCacheSettings()
+		:
+		bEnable(false),
+		RetraceDistance(2.0f),
+		RevalidationIntervalFrames(30)
+	{ }
+
+	// If true, trace results are reused while the foot stays close to where it was last traced
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bEnable;
+
+	// Trace again once the foot or toe has moved this far (horizontally, in cm) from where it was last traced
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 0.0f))
+	float RetraceDistance;
+
+	// Trace again after reusing the cached results for this many frames, even if the foot hasn't moved
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 0))
+	int32 RevalidationIntervalFrames;
+};
+
+/*
+* Settings for probing the ground at the predicted foot plant location. See FAnimNode_IKHumanoidLegTrace.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FHumanoidLegFootfallPredictionSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FHumanoidLegFootfallPredictionSettings()
+		:
+		bEnable(false),
+		LookAheadTime(0.2f),
+		PlantSpeedThreshold(30.0f),
+		PlantProbeTolerance(10.0f)
+	{ }
+
+	// If true, the ground is probed once per step, at the predicted foot plant location
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bEnable;
+
+	// How far ahead, in seconds, to predict the plant location when the foot lifts off. Roughly the 
+	// swing time of a step.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 0.0f))
+	float LookAheadTime;
+
+	// The foot is considered planted while its horizontal world-space speed is below this (cm/s)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 0.0f))
+	float PlantSpeedThreshold;
+
+	// The plant probe is used as long as the foot stays within the predicted step distance plus this (cm) 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 0.0f))
+	float PlantProbeTolerance;
+};
+
+/*
+* Settings for locking a planted foot in place. See FAnimNode_HumanoidLegIK.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FHumanoidLegPlantLockSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FHumanoidLegPlantLockSettings()
+		:
+		bEnable(false),
+		CurveName(NAME_None),
+		CurveThreshold(0.5f),
+		PlantSpeedThreshold(20.0f),
+		MaxLockDistance(20.0f)
+	{ }
+
+	// If true, the foot target is latched in world space when the foot plants, and held there until it lifts off.
+	// The ground isn't traced while the foot is locked.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	bool bEnable;
+
+	// Curve marking the foot as planted (e.g., authored on the walk cycle). If None, the animated foot speed is 
+	// used instead.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	FName CurveName;
+
+	// The foot is planted while the curve is above this value
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings)
+	float CurveThreshold;
+
+	// Without a curve, the foot is planted while its animated horizontal world-space speed is below this (cm/s)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 0.0f))
+	float PlantSpeedThreshold;
+
+	// The lock is released if the animated foot drifts this far (cm, horizontally) from the locked location
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Settings, meta = (ClampMin = 0.0f))
+	float MaxLockDistance;
+};
+
+/*
+* Cached ground trace results for one leg. While the foot stays near the last traced location, new traces 
+* are answered by intersecting the trace line with the cached hit planes. Hits on movable components are never reused.
+* Trace data passed in and out is in the space of ComponentToWorld; the cache itself works in world space.
+*/
+struct RTIK_API FHumanoidLegGroundCache
+{
+	FHumanoidLegGroundCache()
+		:
+		bValid(false),
+		bHitMovable(false),
+		FramesSinceTrace(0)
+	{ }
+
+	// Tries to answer the traces at EndpointsWS from the cache. 
+	// @return - true if OutTraceData was filled from the cache, false if a new trace is needed
+	bool TryProject(const FHumanoidLegTraceEndpoints& EndpointsWS,
+		const FHumanoidLegGroundCacheSettings& Settings,
+		const FTransform& ComponentToWorld,
+		FHumanoidIKTraceData& OutTraceData);
+
+	// Stores the results of new traces done at EndpointsWS
+	void Store(const FHumanoidLegTraceEndpoints& EndpointsWS, 
+		const FHumanoidIKTraceData& TraceData, 
+		const FTransform& ComponentToWorld);
+
+	void Invalidate() 
+	{ 
+		bValid = false;
+	}
+
+protected:
+	bool bValid;
+	bool bHitMovable;
+	int32 FramesSinceTrace;
+	FHumanoidLegTraceEndpoints CachedEndpointsWS;
+	FHumanoidIKTraceData CachedTraceDataWS;
+	FPlane FootPlane;
+	FPlane ToePlane;
 };
 
 /*
@@ -148,7 +540,11 @@ public:
 	UHumanoidIKTraceData_Wrapper(const FObjectInitializer& ObjectInitializer)
 		:
 		Super(ObjectInitializer),
-		bUpdatedThisTick(false)
+		bUpdatedThisTick(false),
+		NumQueryResultsReceived(0),
+		GroundCacheHits(0),
+		GroundCacheMisses(0),
+		PlantLockedFrame(0)
 	{ }
 
 	// Data in this class should be updated each frame before use. This is handled
@@ -171,12 +567,82 @@ public:
 		return TraceData;
 	}
 
+	// Gets the ground solution for the current trace data. Computed by the trace node whenever it updates this wrapper,
+	// so the same staleness rules as GetTraceData apply.
+	UFUNCTION(BlueprintCallable, Category = IK)
+	FHumanoidLegGroundSolution& GetGroundSolution()
+	{
+#if ENABLE_IK_DEBUG
+		if (!bUpdatedThisTick)
+		{
+			UE_LOG(LogRTIK, Warning, TEXT("Warning -- Ground solution was used before it was updated and may be stale. Use a trace node (e.g., IK Humanoid Leg Trace) to update your trace data early in the animgraph, before it is used!"));
+		}
+#endif // ENABLE_IK_DEBUG
+		return GroundSolution;
+	}
+
+	// True once the ground query service has written trace results into this wrapper
+	bool HasReceivedQueryResults() const
+	{
+		return NumQueryResultsReceived > 0;
+	}
+
+	// Number of individual trace results written into this wrapper by the ground query service
+	int32 GetNumQueryResultsReceived() const
+	{
+		return NumQueryResultsReceived;
+	}
+
+	// Fraction of trace updates for this leg which were answered by the ground cache, rather than new traces.
+	// Only counted if the trace node has its ground cache enabled.
+	UFUNCTION(BlueprintCallable, Category = IK)
+	float GetGroundCacheHitRate() const
+	{
+		int32 Total = GroundCacheHits + GroundCacheMisses;
+		return Total > 0 ? static_cast<float>(GroundCacheHits) / Total : 0.0f;
+	}
+
+	// Called by the leg IK node each frame its foot is plant-locked. The trace data is latched in world space when 
+	// the lock starts; the trace node reuses it instead of tracing until the lock is released.
+	void RenewPlantLock(const FTransform& ComponentToWorld)
+	{
+		if (!IsPlantLocked())
+		{
+			PlantTraceDataWS = TraceData.TransformBy(ComponentToWorld);
+		}
+		PlantLockedFrame = GFrameCounter;
+	}
+
+	// Called by the leg IK node when its foot lifts off
+	void ReleasePlantLock()
+	{
+		PlantLockedFrame = 0;
+	}
+
+	// True if the foot was plant-locked last frame (or this one)
+	bool IsPlantLocked() const
+	{
+		return PlantLockedFrame > 0 && GFrameCounter - PlantLockedFrame <= 1;
+	}
+
 	// Trace classes using this wrapper are declared as friends so they can directly update data and set bUpdatedThisTick
 	friend struct FAnimNode_IKHumanoidLegTrace;
+	friend class FIKGroundQueryService;
 
 protected:
 	bool bUpdatedThisTick;
+	int32 NumQueryResultsReceived;
+	int32 GroundCacheHits;
+	int32 GroundCacheMisses;
 	FHumanoidIKTraceData TraceData;
+	FHumanoidLegGroundSolution GroundSolution;
+
+	// Results written by the ground query service, in world space. The trace node converts them to component space.
+	FHumanoidIKTraceData QueryResultsWS;
+
+	// Trace data latched in world space when the foot was plant-locked, and the frame the lock was last renewed
+	FHumanoidIKTraceData PlantTraceDataWS;
+	uint64 PlantLockedFrame;
 };
 
 /*
@@ -314,5 +780,105 @@ static void HumanoidIKLegTrace(ACharacter* Character,
 	FIKBone& PelvisBone,
 	float MaxPelvisAdjustHeight,
 	FHumanoidIKTraceData& OutTraceData,
-	bool bEnableDebugDraw = false);
+	bool bEnableDebugDraw = false,
+	const FIKGroundQueryQuality& Quality = FIKGroundQueryQuality(),
+	FIKGroundProvider* GroundProvider = nullptr);
+
+/*
+* Same as above, but takes the world and component transform directly instead of reading them from a character.
+* Safe to call during evaluation on a worker thread, with state captured in PreUpdate (see FIKNodeSnapshot).
+*/
+static void HumanoidIKLegTrace(UWorld* World,
+	AActor* ActorToIgnore,
+	const FTransform& ComponentToWorld,
+	FCSPose<FCompactPose>& MeshBases,
+	FHumanoidLegChain& LegChain,
+	FIKBone& PelvisBone,
+	float MaxPelvisAdjustHeight,
+	FHumanoidIKTraceData& OutTraceData,
+	bool bEnableDebugDraw = false,
+	const FIKGroundQueryQuality& Quality = FIKGroundQueryQuality(),
+	FIKGroundProvider* GroundProvider = nullptr);
+
+/*
+* Does foot and toe traces between world-space endpoints. 
+*/
+static void TraceLegEndpoints(UWorld* World,
+	AActor* ActorToIgnore,
+	const FHumanoidLegTraceEndpoints& EndpointsWS,
+	FHumanoidLegGroundHits& OutHits,
+	bool bEnableDebugDraw = false,
+	const FIKGroundQueryQuality& Quality = FIKGroundQueryQuality());
+
+/*
+* Probes the ground under a foot with a single box sweep, between the midpoints of the foot and toe trace 
+* endpoints. The box spans the foot lengthwise, plus ToeRadius on each side. The foot and toe hit results 
+* are found by intersecting the foot and toe trace lines with the contact plane.
+*/
+static void SweepLegEndpoints(UWorld* World,
+	AActor* ActorToIgnore,
+	const FHumanoidLegChain& LegChain,
+	const FHumanoidLegTraceEndpoints& EndpointsWS,
+	FHumanoidLegGroundHits& OutHits,
+	bool bEnableDebugDraw = false,
+	const FIKGroundQueryQuality& Quality = FIKGroundQueryQuality());
+
+/*
+* Probes the ground using either TraceLegEndpoints or SweepLegEndpoints, depending on Quality.ProbeMode.
+* If GroundProvider is given, it is asked first; physics is only queried if it can't answer for both foot and toe.
+*/
+static void ProbeLegEndpoints(UWorld* World,
+	AActor* ActorToIgnore,
+	const FHumanoidLegChain& LegChain,
+	const FHumanoidLegTraceEndpoints& EndpointsWS,
+	const FIKGroundQueryQuality& Quality,
+	FHumanoidLegGroundHits& OutHits,
+	bool bEnableDebugDraw = false,
+	FIKGroundProvider* GroundProvider = nullptr);
+
+/*
+* Finds the component-space start and end points of the foot and toe traces done by HumanoidIKLegTrace.
+* Transform them by the component-to-world transform before tracing.
+*/
+static void ComputeLegTraceEndpointsCS(FCSPose<FCompactPose>& MeshBases,
+	FHumanoidLegChain& LegChain,
+	FIKBone& PelvisBone,
+	float MaxPelvisAdjustHeight,
+	FHumanoidLegTraceEndpoints& OutEndpoints);
+
+/*
+* Solves a leg analytically with the two-bone solver, keeping the knee pointed the way it was before IK. The knee's
+* offset from the hip-foot axis is rotated along with that axis as the foot moves to its target, and used as the pole;
+* this puts the knee where the knee correction node would. The input leg must have the base pose's knee plane (moving
+* the pelvis doesn't change it). OutCSTransforms will be emptied and filled with the hip, knee, and foot transforms.
+*/
+static void SolveLegTwoBoneKneeAware(const FTransform& HipCSTransform,
+	const FTransform& KneeCSTransform,
+	const FTransform& FootCSTransform,
+	const FVector& FootTargetCS,
+	TArray<FTransform>& OutCSTransforms);
+
+/*
+* Finds the rotations that take a leg from its pre-IK pose to its post-IK pose. Each delta is a component-space
+* rotation, applied on the left of the pre-IK bone rotation. Useful for storing the result of a solve and 
+* re-applying it later without solving again.
+*/
+static void ComputeLegDeltaRotations(const FTransform& HipCSPre,
+	const FTransform& KneeCSPre,
+	const FTransform& HipCSPost,
+	const FTransform& KneeCSPost,
+	FQuat& OutHipDelta,
+	FQuat& OutKneeDelta);
+
+/*
+* Applies delta rotations (see ComputeLegDeltaRotations) to a leg, forward-kinematics style. The hip stays in place;
+* the knee and foot are moved by the rotated thigh and shin. The foot keeps its component-space rotation.
+* OutCSTransforms will be emptied and filled with the hip, knee, and foot transforms.
+*/
+static void ApplyLegDeltaRotations(const FTransform& HipCSTransform,
+	const FTransform& KneeCSTransform,
+	const FTransform& FootCSTransform,
+	const FQuat& HipDelta,
+	const FQuat& KneeDelta,
+	TArray<FTransform>& OutCSTransforms);
 };
\ No newline at end of file
@@ -192,6 +192,9 @@ public:
 
 	FIKBoneConstraint* GetConstraint();
 
+	// The wrapper object holding this bone's constraint; may be null. Useful to tell which kind of constraint is in use.
+	UIKBoneConstraintWrapper* GetConstraintWrapper() const { return Constraint; }
+
 	FCompactPoseBoneIndex BoneIndex;
 
 public:
@@ -375,3 +378,214 @@ public:
 	virtual bool IsValid(const FBoneContainer& RequiredBones);
 };
 
+
+
+/*
+* Settings for reduced-rate IK evaluation. When enabled, a node performs its full solve (traces, solver
+* iterations, base pose evaluation) only every Nth evaluated frame, where N is picked from the current LOD level.
+* LOD already reflects screen size, so distant characters solve less often.
+*
+* On the frames in between, the node only re-applies the IK deltas it stored on its last solve, interpolating
+* toward them so the result doesn't pop when a new solve comes in.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FIKReducedRateSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FIKReducedRateSettings()
+		:
+		bEnable(false)
+	{
+		SolveIntervalPerLOD.Add(1);
+		SolveIntervalPerLOD.Add(2);
+		SolveIntervalPerLOD.Add(3);
+		SolveIntervalPerLOD.Add(4);
+	}
+
+	// If false, the node does a full solve every evaluated frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings")
+	bool bEnable;
+
+	// How often to do a full solve, in evaluated frames, at each LOD level. Entry 0 is used at LOD 0, entry 1 
+	// at LOD 1, and so on; the last entry is used for all higher LODs. An interval of 1 solves every frame.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (ClampMin = 1))
+	TArray<int32> SolveIntervalPerLOD;
+
+	// Get the solve interval to use at LODLevel. Always at least 1.
+	int32 GetSolveInterval(int32 LODLevel) const;
+};
+
+/*
+* Keeps track of when a node using FIKReducedRateSettings should do its next full solve.
+*/
+struct RTIK_API FIKReducedRateCounter
+{
+public:
+
+	FIKReducedRateCounter()
+		:
+		FramesUntilSolve(0),
+		SolveInterval(1)
+	{ }
+
+	// Advance by one evaluated frame. Returns true if the node should do a full solve this frame.
+	bool Tick(const FIKReducedRateSettings& Settings, int32 LODLevel);
+
+	// How far stored deltas should move toward the last solved deltas this frame. Chosen so that the
+	// interpolated deltas arrive at the solved ones just as the next solve happens. Returns 1 when 
+	// solving every frame.
+	float GetInterpolationAlpha() const;
+
+	// Force a full solve on the next tick
+	void Reset();
+
+protected:
+	int32 FramesUntilSolve;
+	int32 SolveInterval;
+};
+
+/*
+* Settings for skipping bones an IK node barely changed. Every bone a node outputs is blended into the pose, which
+* converts it (and its children) back to local space; that's wasted work when IK moved the bone by a hair. 
+* 
+* With these settings enabled, output bones within tolerance of the incoming pose are dropped before blending. 
+* If every bone is dropped, the blend is skipped entirely.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FIKCommitSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FIKCommitSettings()
+		:
+		bSkipUnchangedBones(false),
+		LocationTolerance(0.0001f),
+		RotationToleranceDegrees(0.01f)
+	{ }
+
+	// If false, every output bone is committed
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings")
+	bool bSkipUnchangedBones;
+
+	// A bone is unchanged if it moved less than this far, in component space, and rotated less than RotationToleranceDegrees
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (UIMin = 0.0f))
+	float LocationTolerance;
+
+	// A bone is unchanged if it rotated less than this many degrees, and moved less than LocationTolerance
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (UIMin = 0.0f))
+	float RotationToleranceDegrees;
+
+	// Remove unchanged bones from BoneTransforms, which must be sorted parent-first (as the blend requires anyway).
+	// A bone is only removed if no changed bone is its ancestor; otherwise it would be carried along by the ancestor's change.
+	void DiscardUnchangedBones(FCSPose<FCompactPose>& Pose, TArray<FBoneTransform>& BoneTransforms) const;
+};
+
+/*
+* Settings for switching a node off while it isn't needed, e.g. leg IK while the foot is in swing. While gated off,
+* the node skips its traces, solves and base pose evaluation, and outputs nothing, as if its alpha were zero.
+*
+* Nodes with smoothed offsets (leg IK, pelvis adjustment, foot rotation, torso adjustment) don't stop right away when
+* the gate closes. They keep running with no IK target, easing their offsets back to the incoming pose at their usual 
+* speed, and switch off once the offsets are gone.
+*
+* When the node comes back on (from the gate, or from zero alpha), it clears its smoothing state, so it eases in
+* from the incoming pose instead of jumping back to wherever it left off.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FIKGateSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FIKGateSettings()
+		:
+		CurveName(NAME_None),
+		CurveThreshold(0.0f),
+		AlphaThreshold(0.0f)
+	{ }
+
+	// If set, the node only runs while this animation curve is above CurveThreshold (e.g., a FootLock_L curve)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings")
+	FName CurveName;
+
+	// See CurveName
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings")
+	float CurveThreshold;
+
+	// The node only runs while its alpha is above this
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings", meta = (UIMin = 0.0f, UIMax = 1.0f))
+	float AlphaThreshold;
+};
+
+/*
+* Keeps track of whether a node using FIKGateSettings is gated on.
+*/
+struct RTIK_API FIKGate
+{
+public:
+
+	FIKGate()
+		:
+		CurveValue(1.0f),
+		bReopened(false),
+		bBlendingOut(false)
+	{ }
+
+	// Read the gate curve. Call from PreUpdate, on the game thread.
+	void CaptureCurve(const FIKGateSettings& Settings, const UAnimInstance* AnimInstance);
+
+	// True if the gate curve, as of the last capture, lets the node run. Alpha is not considered.
+	bool IsCurveOpen(const FIKGateSettings& Settings) const;
+
+	// Call at the start of evaluation. Returns true if the node should run this evaluation.
+	// @param bHasOffsets - The node still holds smoothed offsets. If so, it keeps running while gated off, to blend them out.
+	bool Evaluate(const FIKGateSettings& Settings, float Alpha, const FGraphTraversalCounter& EvaluationCounter,
+		bool bHasOffsets = false);
+
+	// True if the node is running, but didn't run on the previous evaluation. Smoothing state should be reset.
+	bool WasReopened() const { return bReopened; }
+
+	// True if the node is gated off, but running to blend its offsets out. It should move them toward zero, as if it
+	// had no IK target, and skip traces.
+	bool IsBlendingOut() const { return bBlendingOut; }
+
+protected:
+	float CurveValue;
+	bool bReopened;
+	bool bBlendingOut;
+	FGraphTraversalCounter LastOpenEvaluation;
+	FGraphTraversalCounter NextEvaluation;
+};
+
+/*
+* Game-thread state an IK node needs during evaluation. Evaluation may run on a worker thread, where the skeletal 
+* mesh component and its owner must not be touched, so nodes capture this in PreUpdate and evaluate against it.
+*
+* World and Character are only handed on to scene queries and debug drawing; evaluation never reads through them.
+*/
+struct RTIK_API FIKNodeSnapshot
+{
+public:
+
+	FIKNodeSnapshot()
+		:
+		ComponentToWorld(FTransform::Identity),
+		World(nullptr),
+		Character(nullptr)
+	{ }
+
+	// Copy state from the anim instance's skeletal mesh component. Call on the game thread only.
+	void Capture(const UAnimInstance* AnimInstance);
+
+	FTransform ComponentToWorld;
+	UWorld* World;
+
+	// Owning character, or nullptr if the component isn't owned by one
+	ACharacter* Character;
+};
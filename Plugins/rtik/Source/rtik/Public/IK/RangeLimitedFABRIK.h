@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "IK.h"
 
+struct FPlanarRotation;
 
 //	Range-limited FABRIK solvers and related functions. Does not need to be in the context of a Skeleton; 
 //	this solver is designed to work with generic transforms. Make sure all transforms are in the same space, though!
@@ -184,6 +185,30 @@ public:
 		int32 MaxIterations = 20,
 		ACharacter* Character = nullptr		
 	);
+
+	// Solves a two-bone chain (three points) in closed form, with the root held in place. Gives the result FABRIK 
+	// converges to, without iterating. Where there is a choice, the chain keeps bending the way it did in InTransforms.
+	//
+	// One bone may be limited to a planar rotation constraint, whose angle limits are honoured. Any other constraints
+	// are not supported; use SolveRangeLimitedFABRIK for those chains.
+	//
+	// @param InTransforms - The starting transforms of each chain point. Not modified. Must contain exactly 3 transforms.
+	// @param Hinge - Planar constraint on one of the bones, or nullptr if neither bone is constrained. Its SetupFn is not
+	//   called here; call it on InTransforms first, as FABRIK would.
+	// @param HingeIndex - Which bone Hinge applies to: 0 for the root bone, 1 for the bone ending at the effector.
+	// @param EffectorTargetLocation - Where you want the effector to go.
+	// @param OutTransforms - The updated transforms for each chain point. Will be emptied and filled with new transforms.
+	//   Rotations are updated as in SolveRangeLimitedFABRIK.
+	// @param Precision - If the effector starts within this distance from the target, nothing is changed.
+	// @return - True if any transforms in OutTransforms were updated; otherwise, false.
+	static bool SolveTwoBoneAnalytic(
+		const TArray<FTransform>& InTransforms,
+		const FPlanarRotation* Hinge,
+		int32 HingeIndex,
+		const FVector& EffectorTargetLocation,
+		TArray<FTransform>& OutTransforms,
+		float Precision = 0.01f
+	);
 	
 protected:
 
@@ -195,6 +220,20 @@ protected:
 		const FTransform& OldChildTransform
 	);
 
+	// Finds the angle (radians) of a hinged bone direction D(A) = Forward * cos(A) + Up * sin(A), such that 
+	// Dot(ToTarget, D(A)) = C, clamped to [MinRad, MaxRad]. ReachError scores a candidate angle (lower is better);
+	// ties go to the angle nearest CurrentRad.
+	static float SolveHingeAngle(
+		const FVector& ToTarget,
+		const FVector& Forward,
+		const FVector& Up,
+		float C,
+		float CurrentRad,
+		float MinRad,
+		float MaxRad,
+		TFunctionRef<float(float)> ReachError
+	);
+
 	// Iterate from effector to root
 	static void FABRIKForwardPass(
 		const TArray<FTransform>& InTransforms,
@@ -0,0 +1,184 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Engine/DataAsset.h"
+#include "SolverTuning.generated.h"
+
+class UIKBoneConstraintWrapper;
+
+/*
+* One FABRIK solve, as the node set it up: chain transforms before IK, and where the effector was sent.
+*/
+USTRUCT()
+struct RTIK_API FIKSolverProblem
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FIKSolverProblem()
+		:
+		EffectorTargetCS(ForceInitToZero),
+		MaxRootDragDistance(0.0f),
+		RootDragStiffness(1.0f)
+	{ }
+
+	UPROPERTY()
+	TArray<FTransform> CSTransforms;
+
+	UPROPERTY()
+	FVector EffectorTargetCS;
+
+	UPROPERTY()
+	float MaxRootDragDistance;
+
+	UPROPERTY()
+	float RootDragStiffness;
+};
+
+/*
+* Error targets and search space for tuning a solver against recorded solves. See UIKSolverRecording.
+*/
+USTRUCT(BlueprintType)
+struct RTIK_API FIKSolverTuningSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FIKSolverTuningSettings()
+		:
+		MaxEffectorError(0.05f),
+		MaxJointAngleError(1.0f),
+		MaxIterationsLimit(30),
+		NumTimingRuns(5)
+	{
+		CandidatePrecisions = { 1.0f, 0.5f, 0.1f, 0.05f, 0.01f, 0.005f, 0.001f };
+	}
+
+	// How far (cm) the effector may end up from where a fully converged solve puts it, in the worst recorded solve
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tuning, meta = (ClampMin = 0.0f))
+	float MaxEffectorError;
+
+	// How far (degrees) any bone may point from where a fully converged solve points it, in the worst recorded solve
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tuning, meta = (ClampMin = 0.0f))
+	float MaxJointAngleError;
+
+	// Highest MaxIterations to try
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tuning, meta = (ClampMin = 1))
+	int32 MaxIterationsLimit;
+
+	// Precision values to try. For each, the fewest iterations meeting the error targets are found; the fastest
+	// of those settings wins.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tuning)
+	TArray<float> CandidatePrecisions;
+
+	// Times each candidate is run over all recorded solves when timing it. The fastest run is used.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tuning, meta = (ClampMin = 1))
+	int32 NumTimingRuns;
+};
+
+/*
+* Solves recorded from one IK chain, for tuning the chain's solver Precision and MaxIterations offline.
+*
+* Create one as a data asset, and set it as the Solver Recording of a Range Limited FABRIK or Humanoid Leg IK node
+* (FABRIK solver). Turn on bRecording, and the node records its solves when playing in the editor; save the asset
+* afterward. Then run the IKTuneSolver commandlet, which tunes the recording and writes the result back to every
+* node using it (or call Tune from code).
+*
+* All nodes sharing a recording should solve the same chain. Recorded solves are editor-only data, so a cooked
+* recording only holds the settings and tuning results.
+*/
+UCLASS(BlueprintType)
+class RTIK_API UIKSolverRecording : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	UIKSolverRecording();
+
+	// Record solves while playing in the editor. Off by default; turn it off again once enough solves are recorded.
+	UPROPERTY(EditAnywhere, Category = Recording)
+	bool bRecording;
+
+	// Record one out of every this many solves, so the recording covers more of the animation
+	UPROPERTY(EditAnywhere, Category = Recording, meta = (ClampMin = 1))
+	int32 RecordInterval;
+
+	// Recording stops once this many solves have been recorded
+	UPROPERTY(EditAnywhere, Category = Recording, meta = (ClampMin = 1))
+	int32 MaxProblems;
+
+	UPROPERTY(EditAnywhere, Category = Tuning)
+	FIKSolverTuningSettings TuningSettings;
+
+	// Result of the last tune
+	UPROPERTY(VisibleAnywhere, Category = Tuning)
+	float TunedPrecision;
+
+	// Result of the last tune
+	UPROPERTY(VisibleAnywhere, Category = Tuning)
+	int32 TunedMaxIterations;
+
+#if WITH_EDITORONLY_DATA
+	UPROPERTY(VisibleAnywhere, Category = Recording)
+	TArray<FIKSolverProblem> Problems;
+
+	// Copies of the chain's constraints, taken when the first solve was recorded. Null for bones without one.
+	UPROPERTY(VisibleAnywhere, Instanced, Category = Recording)
+	TArray<UIKBoneConstraintWrapper*> Constraints;
+#endif // WITH_EDITORONLY_DATA
+
+	// Adds a solve, if recording. Chain constraints are copied on the first solve, or if the chain changed.
+	// Game thread only. Does nothing without editor-only data.
+	void Record(const FIKSolverProblem& Problem, const TArray<UIKBoneConstraintWrapper*>& ChainConstraints);
+
+	// Discards all recorded solves
+	UFUNCTION(CallInEditor, Category = Recording)
+	void ClearRecording();
+
+	// Finds the fastest Precision and MaxIterations whose results stay within the tuning error targets on every
+	// recorded solve, and stores them in TunedPrecision and TunedMaxIterations.
+	// @return - false if there were no recorded solves (always, without editor-only data), or no candidate met the targets
+	UFUNCTION(CallInEditor, Category = Tuning)
+	bool Tune();
+
+protected:
+
+#if WITH_EDITORONLY_DATA
+	// Solves seen since recording started, for RecordInterval
+	int32 NumSolvesSeen;
+#endif // WITH_EDITORONLY_DATA
+};
+
+/*
+* Hands a node's solves to its solver recording. Solves are captured during evaluation, which may be on a worker
+* thread, and added to the recording in the next PreUpdate, on the game thread. Only records in the editor.
+*/
+struct RTIK_API FIKSolverRecorder
+{
+public:
+
+	FIKSolverRecorder()
+		:
+		bHasPendingProblem(false)
+	{ }
+
+	// Call during evaluation with the inputs of a FABRIK solve
+	void Capture(const UIKSolverRecording* Recording,
+		const TArray<FTransform>& CSTransforms,
+		const FVector& EffectorTargetCS,
+		float MaxRootDragDistance = 0.0f,
+		float RootDragStiffness = 1.0f);
+
+	// Call in PreUpdate, with the constraint wrappers of the solved chain
+	void Flush(UIKSolverRecording* Recording, const TArray<UIKBoneConstraintWrapper*>& ChainConstraints);
+
+protected:
+	bool bHasPendingProblem;
+	FIKSolverProblem PendingProblem;
+};
@@ -24,6 +24,12 @@ public:
 	// Get worldspace transform of a bone
 	static FTransform GetBoneWorldTransform(USkeletalMeshComponent& SkelComp, FCSPose<FCompactPose>& MeshBases, FCompactPoseBoneIndex BoneIndex);
 
+	// Get worldspace location of a bone, given the component-to-world transform. Safe on worker threads.
+	static FVector GetBoneWorldLocation(const FTransform& ComponentToWorld, FCSPose<FCompactPose>& MeshBases, FCompactPoseBoneIndex BoneIndex);
+
+	// Get worldspace transform of a bone, given the component-to-world transform. Safe on worker threads.
+	static FTransform GetBoneWorldTransform(const FTransform& ComponentToWorld, FCSPose<FCompactPose>& MeshBases, FCompactPoseBoneIndex BoneIndex);
+
 	// Get component space location of a bone
 	static FVector GetBoneCSLocation(USkeletalMeshComponent& SkelComp, FCSPose<FCompactPose>& MeshBases, FCompactPoseBoneIndex BoneIndex);
 
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "WorldCollision.h"
+#include "CollisionQueryParams.h"
 #include "TraceUtil.generated.h"
 
 UCLASS()
@@ -15,6 +17,7 @@ public:
 	
 	// Do a line trace from Source to Target. Code courtesy of Rama:
 	// https://wiki.unrealengine.com/Trace_Functions
+	// Set bTraceComplex to false to trace against simple collision, which is much cheaper for most geometry.
 	UFUNCTION(BlueprintCallable, Category = Trace)
 	static bool LineTrace(
 		UWorld* World,
@@ -24,5 +27,51 @@ public:
 		FHitResult& HitOut,
 		ECollisionChannel CollisionChannel = ECC_Pawn,
 		bool ReturnPhysMat = false,
-		bool bEnableDebugDraw = false);
+		bool bEnableDebugDraw = false,
+		bool bTraceComplex = true,
+		bool bReturnFaceIndex = false);
+
+	// Sweep a box from Start to End. Query settings work as in LineTrace.
+	static bool BoxSweep(
+		UWorld* World,
+		AActor* ActorToIgnore,
+		const FVector& Start,
+		const FVector& End,
+		const FQuat& Rotation,
+		const FVector& HalfExtent,
+		FHitResult& HitOut,
+		ECollisionChannel CollisionChannel = ECC_Pawn,
+		bool ReturnPhysMat = false,
+		bool bEnableDebugDraw = false,
+		bool bTraceComplex = true,
+		bool bReturnFaceIndex = false);
+
+	// Request an asynchronous line trace from Start to End. Must be called from the game thread. The
+	// trace runs at the end of the frame; use QueryAsyncLineTrace next frame to get the result. Query
+	// settings work as in LineTrace.
+	static FTraceHandle AsyncLineTrace(
+		UWorld* World,
+		AActor* ActorToIgnore,
+		const FVector& Start,
+		const FVector& End,
+		ECollisionChannel CollisionChannel = ECC_Pawn,
+		bool ReturnPhysMat = false,
+		bool bTraceComplex = true,
+		bool bReturnFaceIndex = false);
+
+	// Get the result of a trace requested with AsyncLineTrace. Returns false if the result is not
+	// available (yet, or anymore -- results only live for one frame). If the trace completed but hit nothing,
+	// returns true and HitOut is reset.
+	static bool QueryAsyncLineTrace(
+		UWorld* World,
+		const FTraceHandle& Handle,
+		FHitResult& HitOut);
+
+	// Builds the query params used by the functions above
+	static FCollisionQueryParams MakeQueryParams(
+		const FName& TraceTag,
+		AActor* ActorToIgnore,
+		bool ReturnPhysMat,
+		bool bTraceComplex,
+		bool bReturnFaceIndex);
 };
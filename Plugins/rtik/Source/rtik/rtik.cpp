@@ -2,8 +2,30 @@
 
 #include "rtik.h"
 #include "Modules/ModuleManager.h"
+#include "IK/GroundHeightField.h"
+#include "IK/GroundSampleHash.h"
+#include "IK/GroundProvider.h"
+#include "IK/CrowdSolver.h"
+#include "IK/GroundQueryService.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, rtik, "rtik" );
+class FRTIKModule : public FDefaultGameModuleImpl
+{
+public:
 
-DEFINE_LOG_CATEGORY(LogRTIK)
+	virtual void StartupModule() override
+	{
+		// Ground caches must be told about level streaming and world cleanup
+		FIKGroundHeightField::RegisterLevelDelegates();
+		FIKGroundSampleHash::RegisterDelegates();
+		FIKLandscapeGroundProvider::RegisterDelegates();
+		FIKBakedGroundProvider::RegisterDelegates();
+
+		// Batched ground queries and deferred crowd solves are run at the end of each world tick
+		FIKGroundQueryService::RegisterDelegates();
+		FIKCrowdSolver::RegisterDelegates();
+	}
+};
 
+IMPLEMENT_PRIMARY_GAME_MODULE( FRTIKModule, rtik, "rtik" );
+
+DEFINE_LOG_CATEGORY(LogRTIK)
@@ -0,0 +1,251 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtikEditor.h"
+#include "IKBakeFootHeightCommandlet.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/AnimCurveTypes.h"
+#include "Engine/SkeletalMesh.h"
+#include "BonePose.h"
+#include "AssetRegistryModule.h"
+#include "Misc/PackageName.h"
+
+const TCHAR* UIKBakeFootHeightCommandlet::CurvePrefix       = TEXT("IKFootHeight_");
+const TCHAR* UIKBakeFootHeightCommandlet::WeightCurvePrefix = TEXT("IKFootHeightWeight_");
+
+UIKBakeFootHeightCommandlet::UIKBakeFootHeightCommandlet()
+{
+	IsClient       = false;
+	IsEditor       = true;
+	IsServer       = false;
+	LogToConsole   = true;
+	ShowErrorCount = true;
+}
+
+int32 UIKBakeFootHeightCommandlet::Main(const FString& Params)
+{
+	FString FootParam;
+	if (!FParse::Value(*Params, TEXT("Foot="), FootParam))
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("No feet given. Usage: -run=IKBakeFootHeight -Foot=foot_l+foot_r -Path=/Game/Anims"));
+		return 1;
+	}
+
+	TArray<FString> FootNames;
+	FootParam.ParseIntoArray(FootNames, TEXT("+"), true);
+
+	TArray<FName> FootBones;
+	for (const FString& FootName : FootNames)
+	{
+		FootBones.Add(FName(*FootName));
+	}
+
+	// Gather animations, listed directly or by path
+	TArray<FString> AnimNames;
+	FString AnimParam;
+	if (FParse::Value(*Params, TEXT("Anim="), AnimParam))
+	{
+		AnimParam.ParseIntoArray(AnimNames, TEXT("+"), true);
+	}
+
+	FString PathParam;
+	if (FParse::Value(*Params, TEXT("Path="), PathParam))
+	{
+		IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+		AssetRegistry.SearchAllAssets(true);
+
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssetsByPath(FName(*PathParam), Assets, true);
+		for (const FAssetData& Asset : Assets)
+		{
+			if (Asset.AssetClass == UAnimSequence::StaticClass()->GetFName())
+			{
+				AnimNames.AddUnique(Asset.ObjectPath.ToString());
+			}
+		}
+	}
+
+	if (AnimNames.Num() == 0)
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("No animations given. Use -Anim=/Game/Anims/Walk+/Game/Anims/Run or -Path=/Game/Anims"));
+		return 1;
+	}
+
+	// Optional; otherwise each skeleton's preview mesh is used
+	USkeletalMesh* Mesh = nullptr;
+	FString MeshParam;
+	if (FParse::Value(*Params, TEXT("Mesh="), MeshParam))
+	{
+		Mesh = LoadObject<USkeletalMesh>(nullptr, *MeshParam);
+		if (Mesh == nullptr)
+		{
+			UE_LOG(LogRTIKEditor, Error, TEXT("Could not load skeletal mesh %s"), *MeshParam);
+			return 1;
+		}
+	}
+
+	int32 NumFailed = 0;
+	for (const FString& AnimName : AnimNames)
+	{
+		UAnimSequence* Sequence = LoadObject<UAnimSequence>(nullptr, *AnimName);
+		if (Sequence == nullptr)
+		{
+			UE_LOG(LogRTIKEditor, Error, TEXT("Could not load animation %s"), *AnimName);
+			++NumFailed;
+			continue;
+		}
+
+		if (!BakeSequence(Sequence, FootBones, Mesh))
+		{
+			++NumFailed;
+		}
+	}
+
+	CollectGarbage(RF_NoFlags);
+
+	return NumFailed == 0 ? 0 : 1;
+}
+
+bool UIKBakeFootHeightCommandlet::BakeSequence(UAnimSequence* Sequence, const TArray<FName>& FootBones, USkeletalMesh* Mesh)
+{
+	USkeleton* Skeleton = Sequence->GetSkeleton();
+	if (Skeleton == nullptr)
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("Animation %s has no skeleton"), *Sequence->GetPathName());
+		return false;
+	}
+
+	// Foot heights in an additive animation are meaningless
+	if (Sequence->IsValidAdditive())
+	{
+		UE_LOG(LogRTIKEditor, Display, TEXT("Skipping additive animation %s"), *Sequence->GetPathName());
+		return true;
+	}
+
+	USkeletalMesh* BakeMesh = Mesh != nullptr ? Mesh : Skeleton->GetPreviewMesh(true);
+	if (BakeMesh == nullptr || BakeMesh->Skeleton != Skeleton)
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("No mesh using skeleton %s to bake %s with. Set a preview mesh, or use -Mesh="),
+			*Skeleton->GetName(), *Sequence->GetPathName());
+		return false;
+	}
+
+	// The pose is evaluated for the mesh, as the anim instance would: bones without an animation track take the mesh's 
+	// reference pose, and the skeleton's translation retargeting applies
+	const FReferenceSkeleton& RefSkeleton = BakeMesh->RefSkeleton;
+	TArray<FBoneIndexType> RequiredBones;
+	RequiredBones.Reserve(RefSkeleton.GetNum());
+	for (int32 i = 0; i < RefSkeleton.GetNum(); ++i)
+	{
+		RequiredBones.Add(i);
+	}
+	FBoneContainer BoneContainer(RequiredBones, FCurveEvaluationOption(false), *BakeMesh);
+
+	TArray<FCompactPoseBoneIndex> FootIndices;
+	TArray<SmartName::UID_Type> HeightCurveUIDs;
+	TArray<SmartName::UID_Type> WeightCurveUIDs;
+	for (const FName& FootBone : FootBones)
+	{
+		int32 FootIndex = RefSkeleton.FindBoneIndex(FootBone);
+		if (FootIndex == INDEX_NONE)
+		{
+			UE_LOG(LogRTIKEditor, Warning, TEXT("Mesh %s has no bone %s; not baked into %s"), 
+				*BakeMesh->GetName(), *FootBone.ToString(), *Sequence->GetPathName());
+			continue;
+		}
+
+		FootIndices.Add(BoneContainer.MakeCompactPoseIndex(FMeshPoseBoneIndex(FootIndex)));
+		HeightCurveUIDs.Add(ResetCurve(Sequence, FName(*(FString(CurvePrefix) + FootBone.ToString()))));
+		WeightCurveUIDs.Add(ResetCurve(Sequence, FName(*(FString(WeightCurvePrefix) + FootBone.ToString()))));
+	}
+
+	int32 NumBaked = FootIndices.Num();
+	if (NumBaked == 0)
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("No feet baked into %s"), *Sequence->GetPathName());
+		return false;
+	}
+
+	// Adding and deleting curves moves the others around, so they're only looked up once all of them are in place
+	TArray<FFloatCurve*> HeightCurves;
+	TArray<FFloatCurve*> WeightCurves;
+	for (int32 i = 0; i < NumBaked; ++i)
+	{
+		HeightCurves.Add(FindFloatCurve(Sequence, HeightCurveUIDs[i]));
+		WeightCurves.Add(FindFloatCurve(Sequence, WeightCurveUIDs[i]));
+	}
+
+	// Measured the same way as the leg IK node measures the base pose: foot Z minus root Z, in component space.
+	// The weight is always 1; blended with unbaked animations, it drops below 1 along with the height.
+	int32 NumKeys = FMath::Max(Sequence->GetRawNumberOfFrames(), 1);
+	for (int32 Key = 0; Key < NumKeys; ++Key)
+	{
+		float Time = NumKeys > 1 ? Sequence->SequenceLength * Key / (NumKeys - 1) : 0.0f;
+
+		FCompactPose Pose;
+		Pose.SetBoneContainer(&BoneContainer);
+		FBlendedCurve PoseCurve;
+		PoseCurve.InitFrom(BoneContainer);
+		Sequence->GetAnimationPose(Pose, PoseCurve, FAnimExtractContext(Time));
+
+		FCSPose<FCompactPose> CSPose;
+		CSPose.InitPose(Pose);
+		FVector RootCS = CSPose.GetComponentSpaceTransform(FCompactPoseBoneIndex(0)).GetLocation();
+
+		for (int32 i = 0; i < NumBaked; ++i)
+		{
+			FVector FootCS = CSPose.GetComponentSpaceTransform(FootIndices[i]).GetLocation();
+			HeightCurves[i]->UpdateOrAddKey(FootCS.Z - RootCS.Z, Time);
+			WeightCurves[i]->UpdateOrAddKey(1.0f, Time);
+		}
+	}
+
+	Sequence->MarkRawDataAsModified();
+	Sequence->PostEditChange();
+
+	// New curve names are added to the skeleton, so it's saved too
+	TArray<UObject*> Assets({ Sequence, Skeleton });
+	bool bSaved = true;
+	for (UObject* Asset : Assets)
+	{
+		UPackage* Package = Asset->GetOutermost();
+		if (Asset == Skeleton && !Package->IsDirty())
+		{
+			continue;
+		}
+
+		FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+		if (!UPackage::SavePackage(Package, Asset, RF_Standalone, *Filename, GError, nullptr, false, true, SAVE_NoError))
+		{
+			UE_LOG(LogRTIKEditor, Error, TEXT("Could not save %s"), *Package->GetName());
+			bSaved = false;
+		}
+	}
+
+	if (bSaved)
+	{
+		UE_LOG(LogRTIKEditor, Display, TEXT("Baked %d foot height curves into %s"), NumBaked, *Sequence->GetPathName());
+	}
+
+	return bSaved;
+}
+
+SmartName::UID_Type UIKBakeFootHeightCommandlet::ResetCurve(UAnimSequence* Sequence, const FName& Name)
+{
+	FSmartName CurveName;
+	Sequence->GetSkeleton()->AddSmartNameAndModify(USkeleton::AnimCurveMappingName, Name, CurveName);
+
+	// Replace the curve from any earlier bake
+	Sequence->RawCurveData.DeleteCurveData(CurveName, ERawCurveTrackTypes::RCT_Float);
+	Sequence->RawCurveData.AddCurveData(CurveName);
+
+	return CurveName.UID;
+}
+
+FFloatCurve* UIKBakeFootHeightCommandlet::FindFloatCurve(UAnimSequence* Sequence, SmartName::UID_Type CurveUID)
+{
+	FFloatCurve* Curve = static_cast<FFloatCurve*>(
+		Sequence->RawCurveData.GetCurveData(CurveUID, ERawCurveTrackTypes::RCT_Float));
+	check(Curve != nullptr);
+
+	return Curve;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtikEditor.h"
+#include "IKBakeGroundCommandlet.h"
+#include "IK/BakedGround.h"
+#include "EngineUtils.h"
+#include "Misc/PackageName.h"
+
+UIKBakeGroundCommandlet::UIKBakeGroundCommandlet()
+{
+	IsClient       = false;
+	IsEditor       = true;
+	IsServer       = false;
+	LogToConsole   = true;
+	ShowErrorCount = true;
+}
+
+int32 UIKBakeGroundCommandlet::Main(const FString& Params)
+{
+	FString MapParam;
+	if (!FParse::Value(*Params, TEXT("Map="), MapParam))
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("No maps given. Usage: -run=IKBakeGround -Map=/Game/Maps/MapA+/Game/Maps/MapB"));
+		return 1;
+	}
+
+	TArray<FString> MapNames;
+	MapParam.ParseIntoArray(MapNames, TEXT("+"), true);
+
+	int32 NumFailed = 0;
+	for (const FString& MapName : MapNames)
+	{
+		if (!BakeMap(MapName))
+		{
+			++NumFailed;
+		}
+	}
+
+	return NumFailed == 0 ? 0 : 1;
+}
+
+bool UIKBakeGroundCommandlet::BakeMap(const FString& MapName)
+{
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World     = Package != nullptr ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (World == nullptr)
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("Could not load map %s"), *MapName);
+		return false;
+	}
+
+	// Register components and create a physics scene, so the bake can trace against the level
+	World->WorldType = EWorldType::Editor;
+	World->AddToRoot();
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+			.ShouldSimulatePhysics(false)
+			.EnableTraceCollision(true)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.AllowAudioPlayback(false)
+			.CreatePhysicsScene(true));
+	}
+	World->UpdateWorldComponents(true, false);
+
+	int32 NumVolumes = 0;
+	for (TActorIterator<AIKBakedGroundVolume> It(World); It; ++It)
+	{
+		It->BakeGround();
+		++NumVolumes;
+	}
+
+	bool bSaved = true;
+	if (NumVolumes == 0)
+	{
+		UE_LOG(LogRTIKEditor, Warning, TEXT("Map %s has no IK baked ground volumes"), *MapName);
+	}
+	else
+	{
+		FString Filename = FPackageName::LongPackageNameToFilename(MapName, FPackageName::GetMapPackageExtension());
+		bSaved = UPackage::SavePackage(Package, World, RF_NoFlags, *Filename, GError, nullptr, false, true, SAVE_NoError);
+		if (bSaved)
+		{
+			UE_LOG(LogRTIKEditor, Display, TEXT("Baked %d IK ground volumes in %s"), NumVolumes, *MapName);
+		}
+		else
+		{
+			UE_LOG(LogRTIKEditor, Error, TEXT("Could not save map %s"), *MapName);
+		}
+	}
+
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	CollectGarbage(RF_NoFlags);
+
+	return bSaved;
+}
@@ -0,0 +1,171 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtikEditor.h"
+#include "IKTuneSolverCommandlet.h"
+#include "IK/SolverTuning.h"
+#include "IK/AnimNode_RangeLimitedFabrik.h"
+#include "IK/AnimNode_HumanoidLegIK.h"
+#include "Animation/AnimBlueprint.h"
+#include "EdGraph/EdGraph.h"
+#include "Kismet2/BlueprintEditorUtils.h"
+#include "Kismet2/KismetEditorUtilities.h"
+#include "Misc/PackageName.h"
+
+// Graph nodes keep their runtime node in a property named Node
+template<typename NodeType>
+static NodeType* GetRuntimeNode(UEdGraphNode* GraphNode)
+{
+	UStructProperty* NodeProperty = FindField<UStructProperty>(GraphNode->GetClass(), TEXT("Node"));
+	if (NodeProperty == nullptr || NodeProperty->Struct != NodeType::StaticStruct())
+	{
+		return nullptr;
+	}
+
+	return NodeProperty->ContainerPtrToValuePtr<NodeType>(GraphNode);
+}
+
+// Copies the tuned settings into Node if it uses one of Recordings. Returns true if Node was changed.
+template<typename NodeType>
+static bool ApplyTuning(UEdGraphNode* GraphNode, NodeType& Node, const TArray<UIKSolverRecording*>& Recordings)
+{
+	if (!Recordings.Contains(Node.SolverRecording))
+	{
+		return false;
+	}
+
+	GraphNode->Modify();
+	Node.Precision     = Node.SolverRecording->TunedPrecision;
+	Node.MaxIterations = Node.SolverRecording->TunedMaxIterations;
+	return true;
+}
+
+UIKTuneSolverCommandlet::UIKTuneSolverCommandlet()
+{
+	IsClient       = false;
+	IsEditor       = true;
+	IsServer       = false;
+	LogToConsole   = true;
+	ShowErrorCount = true;
+}
+
+int32 UIKTuneSolverCommandlet::Main(const FString& Params)
+{
+	FString RecordingParam;
+	if (!FParse::Value(*Params, TEXT("Recording="), RecordingParam))
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("No recordings given. Usage: -run=IKTuneSolver -Recording=/Game/IK/LegRecording -AnimBlueprint=/Game/ABP_Hero"));
+		return 1;
+	}
+
+	TArray<FString> RecordingNames;
+	RecordingParam.ParseIntoArray(RecordingNames, TEXT("+"), true);
+
+	int32 NumFailed = 0;
+	TArray<UIKSolverRecording*> TunedRecordings;
+	for (const FString& RecordingName : RecordingNames)
+	{
+		UIKSolverRecording* Recording = LoadObject<UIKSolverRecording>(nullptr, *RecordingName);
+		if (Recording == nullptr)
+		{
+			UE_LOG(LogRTIKEditor, Error, TEXT("Could not load solver recording %s"), *RecordingName);
+			++NumFailed;
+			continue;
+		}
+
+		if (!Recording->Tune())
+		{
+			UE_LOG(LogRTIKEditor, Error, TEXT("Could not tune %s (%d recorded solves)"), *RecordingName, Recording->Problems.Num());
+			++NumFailed;
+			continue;
+		}
+
+		UE_LOG(LogRTIKEditor, Display, TEXT("Tuned %s over %d solves: Precision %f, MaxIterations %d"), 
+			*RecordingName, Recording->Problems.Num(), Recording->TunedPrecision, Recording->TunedMaxIterations);
+
+		if (!SaveAsset(Recording))
+		{
+			++NumFailed;
+		}
+
+		Recording->AddToRoot();
+		TunedRecordings.Add(Recording);
+	}
+
+	FString BlueprintParam;
+	if (TunedRecordings.Num() > 0 && FParse::Value(*Params, TEXT("AnimBlueprint="), BlueprintParam))
+	{
+		TArray<FString> BlueprintNames;
+		BlueprintParam.ParseIntoArray(BlueprintNames, TEXT("+"), true);
+
+		for (const FString& BlueprintName : BlueprintNames)
+		{
+			if (!ApplyToBlueprint(BlueprintName, TunedRecordings))
+			{
+				++NumFailed;
+			}
+		}
+	}
+
+	for (UIKSolverRecording* Recording : TunedRecordings)
+	{
+		Recording->RemoveFromRoot();
+	}
+	CollectGarbage(RF_NoFlags);
+
+	return NumFailed == 0 ? 0 : 1;
+}
+
+bool UIKTuneSolverCommandlet::ApplyToBlueprint(const FString& BlueprintName, const TArray<UIKSolverRecording*>& Recordings)
+{
+	UAnimBlueprint* Blueprint = LoadObject<UAnimBlueprint>(nullptr, *BlueprintName);
+	if (Blueprint == nullptr)
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("Could not load anim blueprint %s"), *BlueprintName);
+		return false;
+	}
+
+	TArray<UEdGraph*> Graphs;
+	Blueprint->GetAllGraphs(Graphs);
+
+	int32 NumNodes = 0;
+	for (UEdGraph* Graph : Graphs)
+	{
+		for (UEdGraphNode* GraphNode : Graph->Nodes)
+		{
+			if (FAnimNode_RangeLimitedFabrik* FabrikNode = GetRuntimeNode<FAnimNode_RangeLimitedFabrik>(GraphNode))
+			{
+				NumNodes += ApplyTuning(GraphNode, *FabrikNode, Recordings) ? 1 : 0;
+			}
+			else if (FAnimNode_HumanoidLegIK* LegNode = GetRuntimeNode<FAnimNode_HumanoidLegIK>(GraphNode))
+			{
+				NumNodes += ApplyTuning(GraphNode, *LegNode, Recordings) ? 1 : 0;
+			}
+		}
+	}
+
+	if (NumNodes == 0)
+	{
+		UE_LOG(LogRTIKEditor, Warning, TEXT("No nodes in %s use the given solver recordings"), *BlueprintName);
+		return true;
+	}
+
+	FBlueprintEditorUtils::MarkBlueprintAsModified(Blueprint);
+	FKismetEditorUtilities::CompileBlueprint(Blueprint);
+
+	UE_LOG(LogRTIKEditor, Display, TEXT("Applied tuned solver settings to %d nodes in %s"), NumNodes, *BlueprintName);
+	return SaveAsset(Blueprint);
+}
+
+bool UIKTuneSolverCommandlet::SaveAsset(UObject* Asset)
+{
+	UPackage* Package = Asset->GetOutermost();
+	FString Filename  = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+
+	if (!UPackage::SavePackage(Package, Asset, RF_Standalone, *Filename, GError, nullptr, false, true, SAVE_NoError))
+	{
+		UE_LOG(LogRTIKEditor, Error, TEXT("Could not save %s"), *Package->GetName());
+		return false;
+	}
+
+	return true;
+}
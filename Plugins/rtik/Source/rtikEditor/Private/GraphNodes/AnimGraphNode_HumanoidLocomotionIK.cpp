@@ -0,0 +1,24 @@
+// Copyright (c) Henry Cooney 2017
+
+#include "rtikEditor.h"
+#include "AnimGraphNode_HumanoidLocomotionIK.h"
+
+FText UAnimGraphNode_HumanoidLocomotionIK::GetNodeTitle(ENodeTitleType::Type TitleType) const
+{
+	return FText::FromString(FString("IK Humanoid Locomotion"));
+}
+
+FLinearColor UAnimGraphNode_HumanoidLocomotionIK::GetNodeTitleColor() const
+{
+	return FLinearColor(0, 1, 1, 1);
+}
+
+FString UAnimGraphNode_HumanoidLocomotionIK::GetNodeCategory() const
+{
+	return FString("IK Nodes");
+}
+
+FText UAnimGraphNode_HumanoidLocomotionIK::GetControllerDescription() const
+{
+	return FText::FromString(FString("Pelvis adjustment, leg IK, knee correction and foot rotation for both legs, in one node"));
+}
@@ -0,0 +1,63 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "Animation/SmartName.h"
+#include "IKBakeFootHeightCommandlet.generated.h"
+
+class UAnimSequence;
+class USkeletalMesh;
+struct FFloatCurve;
+
+/*
+* Bakes each foot's height above the root bone into curves in the given animations, and saves them. Leg IK nodes 
+* with FootHeightCurveName set read the curve, instead of evaluating the base pose to measure the foot height.
+*
+* Usage: UE4Editor-Cmd.exe <Project> -run=IKBakeFootHeight -Foot=foot_l+foot_r -Path=/Game/Characters/Anims
+*        UE4Editor-Cmd.exe <Project> -run=IKBakeFootHeight -Foot=foot_l+foot_r -Anim=/Game/Anims/Walk+/Game/Anims/Run
+*        Add -Mesh=/Game/Characters/Mesh to bake against a mesh other than the skeleton's preview mesh.
+*
+* Feet are the bones at the tip of each leg's shin (the leg chain's shin bone). Two curves are baked for each foot:
+* IKFootHeight_<bone> holds the height, and IKFootHeightWeight_<bone> is always 1. When baked and unbaked animations
+* blend, both curves are scaled down by the baked animations' weight, so the leg IK node only trusts the height
+* while the weight is about 1.
+*
+* Heights are measured on the mesh's pose, with the mesh's reference pose for untracked bones and the skeleton's
+* translation retargeting, as at runtime. Bake against the mesh the leg IK runs on; meshes with different proportions
+* sharing the skeleton need their own bake. Curves from an earlier bake are replaced. Additive animations are 
+* skipped. Re-run the bake whenever the animations change.
+*/
+UCLASS()
+class RTIKEDITOR_API UIKBakeFootHeightCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	// Prefix of baked height curve names; the rest of the name is the foot bone name
+	static const TCHAR* CurvePrefix;
+
+	// Prefix of baked weight curve names; the rest of the name is the foot bone name
+	static const TCHAR* WeightCurvePrefix;
+
+	UIKBakeFootHeightCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End UCommandlet interface
+
+protected:
+
+	// Bakes curves for each foot into one animation, measured on Mesh (or the skeleton's preview mesh, if null). 
+	// Returns false if the animation couldn't be baked or saved.
+	bool BakeSequence(UAnimSequence* Sequence, const TArray<FName>& FootBones, USkeletalMesh* Mesh);
+
+	// Adds a float curve to the animation (and its name to the skeleton), replacing any curve of the same name.
+	// Returns the curve's UID; look the curve up with FindFloatCurve once all curves have been added, since adding
+	// or deleting curves moves the others.
+	static SmartName::UID_Type ResetCurve(UAnimSequence* Sequence, const FName& Name);
+
+	// The animation's float curve with CurveUID, which must exist
+	static FFloatCurve* FindFloatCurve(UAnimSequence* Sequence, SmartName::UID_Type CurveUID);
+};
@@ -0,0 +1,33 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "IKBakeGroundCommandlet.generated.h"
+
+/*
+* Bakes ground data for every IK baked ground volume in the given maps, and saves the maps.
+*
+* Usage: UE4Editor-Cmd.exe <Project> -run=IKBakeGround -Map=/Game/Maps/Arena1+/Game/Maps/Arena2
+*
+* Each map is loaded on its own; streaming sublevels are not loaded, so list every sublevel which contains
+* a volume. Geometry in other sublevels is not seen by the bake.
+*/
+UCLASS()
+class RTIKEDITOR_API UIKBakeGroundCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UIKBakeGroundCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End UCommandlet interface
+
+protected:
+
+	// Bakes all volumes in one map. Returns false if the map couldn't be loaded or saved.
+	bool BakeMap(const FString& MapName);
+};
@@ -0,0 +1,42 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "IKTuneSolverCommandlet.generated.h"
+
+class UIKSolverRecording;
+class UAnimBlueprint;
+
+/*
+* Tunes solver recordings (see UIKSolverRecording), and writes the tuned Precision and MaxIterations back to every 
+* Range Limited FABRIK and Humanoid Leg IK node using them in the given anim blueprints. Recordings and blueprints 
+* are saved.
+*
+* Usage: UE4Editor-Cmd.exe <Project> -run=IKTuneSolver -Recording=/Game/IK/LegRecording+/Game/IK/ArmRecording 
+*            -AnimBlueprint=/Game/Characters/ABP_Hero
+*
+* Without -AnimBlueprint, only the recordings are tuned; copy the results from them by hand.
+*/
+UCLASS()
+class RTIKEDITOR_API UIKTuneSolverCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UIKTuneSolverCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End UCommandlet interface
+
+protected:
+
+	// Copies tuned settings to the nodes in one anim blueprint which use any of Recordings, then compiles and saves 
+	// the blueprint if any were changed. Returns false if it couldn't be loaded or saved.
+	bool ApplyToBlueprint(const FString& BlueprintName, const TArray<UIKSolverRecording*>& Recordings);
+
+	// Saves the package containing Asset. Returns false on failure.
+	static bool SaveAsset(UObject* Asset);
+};
@@ -0,0 +1,27 @@
+// Copyright (c) Henry Cooney 2017
+
+#pragma once
+
+#include "AnimGraphNode_SkeletalControlBase.h"
+#include "IK/AnimNode_HumanoidLocomotionIK.h"
+#include "AnimGraphNode_HumanoidLocomotionIK.generated.h"
+
+UCLASS()
+class RTIKEDITOR_API UAnimGraphNode_HumanoidLocomotionIK : public UAnimGraphNode_SkeletalControlBase
+{
+	GENERATED_BODY()
+	
+public:
+
+	FText GetNodeTitle(ENodeTitleType::Type TitleType) const override;
+	FLinearColor GetNodeTitleColor() const override;
+	FString GetNodeCategory() const override;
+	virtual const FAnimNode_SkeletalControlBase* GetNode() const override { return &Node; }
+
+protected:
+	virtual FText GetControllerDescription() const;
+protected:
+	UPROPERTY(EditAnywhere, Category = Settings)
+	FAnimNode_HumanoidLocomotionIK Node;
+	
+};
@@ -11,7 +11,7 @@ public class rtikEditor : ModuleRules
 
         PublicDependencyModuleNames.AddRange(new string[] { "rtik", "Core", "CoreUObject", "Engine", "InputCore" , "UnrealEd" });
 
-        PrivateDependencyModuleNames.AddRange(new string[] { "EditorStyle", "AnimGraph", "BlueprintGraph", "PropertyEditor", "Slate", "SlateCore" });
+        PrivateDependencyModuleNames.AddRange(new string[] { "EditorStyle", "AnimGraph", "BlueprintGraph", "PropertyEditor", "Slate", "SlateCore", "AssetRegistry" });
 
         // PublicIncludePaths.AddRange(new string[] { "rtikEditor/Public", "rtikEditor/Public/GraphNodes" });
 